@@ -1,23 +1,444 @@
 #include <iostream>
 #include <string>
 #include <algorithm>
+#include <utility>
 #include <vector>
 #include <list>
+#include <span>
+#include <new>
+#include <thread>
+#include <chrono>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+#include <cstdio>
+#include <cerrno>
+#include <unordered_map>
+#include <map>
+#include <deque>
+#include <random>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <latch>
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <fstream>
+#include <type_traits>
+#include <limits>
+#include <bit>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
 
 #define MAXVEX 10
 
 using Status = int32_t;
 
+// 用户ID类型：默认 32 位；用户ID超过 2^31 时以 -DINVITE_UID_64=1 编译为 64 位
+#ifndef INVITE_UID_64
+#define INVITE_UID_64 0
+#endif
+#if INVITE_UID_64
+using Uid = int64_t;
+#else
+using Uid = int32_t;
+#endif
+const Uid NO_UID = -1;      // 无效用户ID：根用户的邀请者、查找失败时的返回值
+
 //using KeyType = int32_t;                        // 键类型
 //using DataType = int32_t;                       // 值类型
 
-const int32_t ORDER = 7;                        // B+树的阶（非根内结点的最小子树个数）
-const int32_t MINNUM_KEY = ORDER - 1;           // 最小键值个数
-const int32_t MAXNUM_KEY = 2 * ORDER - 1;       // 最大键值个数
-const int32_t MINNUM_CHILD = MINNUM_KEY + 1;    // 最小子树个数
-const int32_t MAXNUM_CHILD = MAXNUM_KEY + 1;    // 最大子树个数
-const int32_t MINNUM_LEAF = MINNUM_KEY;         // 最小叶子结点键值个数
-const int32_t MAXNUM_LEAF = MAXNUM_KEY;         // 最大叶子结点键值个数
+const int32_t ORDER = 7;                        // B+树的默认阶（非根内结点的最小子树个数）
+
+// 由阶决定的结点容量：B+树及其结点以阶为模板参数，容量均为编译期常量，可按键值、数据大小为每种树单独选择
+template<int32_t Order>
+struct NodeCapacity {
+    static_assert(Order >= 2 && 2 * Order - 1 <= INT16_MAX, "B+树的阶超出范围");
+
+    static constexpr int32_t MINNUM_KEY = Order - 1;            // 最小键值个数
+    static constexpr int32_t MAXNUM_KEY = 2 * Order - 1;        // 最大键值个数
+    static constexpr int32_t MINNUM_CHILD = MINNUM_KEY + 1;     // 最小子树个数
+    static constexpr int32_t MAXNUM_CHILD = MAXNUM_KEY + 1;     // 最大子树个数
+    static constexpr int32_t MINNUM_LEAF = MINNUM_KEY;          // 最小叶子结点键值个数
+    static constexpr int32_t MAXNUM_LEAF = MAXNUM_KEY;          // 最大叶子结点键值个数
+};
+
+// 键值策略：Sentinel 为不小于任何有效键值的填充值（静态索引补齐结点用）；非算术键值类型需特化
+template<typename KeyType>
+struct KeyTraits {
+    static constexpr KeyType Sentinel() {
+        return std::numeric_limits<KeyType>::max();
+    }
+};
+
+// 分配器为一次堆分配实际占用的字节数（含块头与对齐）；非 glibc 环境按 16 字节对齐估算
+inline size_t AllocatedSize(const void *p, size_t requested) {
+    if (p == nullptr) {
+        return 0;
+    }
+#if defined(__GLIBC__)
+    (void) requested;
+    return malloc_usable_size(const_cast<void *>(p)) + sizeof(size_t);
+#else
+    return (requested + sizeof(size_t) + 15) & ~(size_t) 15;
+#endif
+}
+
+/*
+.	热点路径埋点 Instrumentation
+.	编译时以 -DINVITE_INSTRUMENT=1 启用：按操作记录次数与延迟直方图，统计 B+ 树分裂、合并等结构调整次数。
+.	每个线程写自己的计数槽（无锁、无共享缓存行），读取时合并所有线程（含已退出线程）的数据。
+.	未启用时埋点宏展开为空语句，热点路径上没有任何额外指令。
+*/
+#ifndef INVITE_INSTRUMENT
+#define INVITE_INSTRUMENT 0
+#endif
+
+// 埋点操作
+enum INSTRUMENT_OP {
+    OP_ADD_INVITE, OP_LOCATE, OP_SELECT, OP_INSERT_EDGE, OP_ANCESTORS, OP_DOWNLINE, OP_NTH_LEVEL, OP_MULTI_FIND, OP_NUM
+};
+
+// B+树结构调整事件
+enum INSTRUMENT_EVENT {
+    EVENT_SPLIT, EVENT_MERGE, EVENT_BORROW, EVENT_REDISTRIBUTE, EVENT_NUM
+};
+
+// 延迟直方图（HDR 风格对数-线性分桶）：每个 2 的幂区间再等分 16 个子桶，相对误差不超过 1/16
+class LatencyHistogram {
+public:
+    static constexpr int32_t SUB_BITS = 4;
+    static constexpr int32_t SUB_COUNT = 1 << SUB_BITS;
+    static constexpr int32_t BUCKET_NUM = (64 - SUB_BITS + 1) * SUB_COUNT;
+
+    // 数值所在的桶
+    static int32_t BucketOf(uint64_t value) {
+        if (value < (uint64_t) SUB_COUNT) {
+            return (int32_t) value;
+        }
+        int32_t shift = 63 - __builtin_clzll(value) - SUB_BITS;
+        return (shift + 1) * SUB_COUNT + (int32_t) ((value >> shift) - SUB_COUNT);
+    }
+
+    // 桶内的最大值
+    static uint64_t BucketUpper(int32_t bucket) {
+        if (bucket < SUB_COUNT) {
+            return (uint64_t) bucket;
+        }
+        int32_t shift = bucket / SUB_COUNT - 1;
+        uint64_t lower = (uint64_t) (bucket % SUB_COUNT + SUB_COUNT) << shift;
+        return lower + (((uint64_t) 1 << shift) - 1);
+    }
+
+    void Add(int32_t bucket, uint64_t n) {
+        this->counts[bucket] += n;
+        this->count += n;
+    }
+
+    void Merge(const LatencyHistogram &other) {
+        for (int32_t i = 0; i < BUCKET_NUM; i++) {
+            this->counts[i] += other.counts[i];
+        }
+        this->count += other.count;
+        this->sum += other.sum;
+        this->max = std::max(this->max, other.max);
+    }
+
+    // 分位数（p 取 0~1），返回所在桶的最大值，不超过记录到的最大值
+    uint64_t Percentile(double p) const {
+        if (this->count == 0) {
+            return 0;
+        }
+        uint64_t rank = std::max<uint64_t>(1, (uint64_t) (p * (double) this->count + 0.5));
+        uint64_t seen = 0;
+        for (int32_t i = 0; i < BUCKET_NUM; i++) {
+            seen += this->counts[i];
+            if (seen >= rank) {
+                return std::min(BucketUpper(i), this->max);
+            }
+        }
+        return this->max;
+    }
+
+    double Mean() const {
+        return this->count > 0 ? (double) this->sum / (double) this->count : 0.0;
+    }
+
+    uint64_t count = 0;     // 样本个数
+    uint64_t sum = 0;       // 样本总和
+    uint64_t max = 0;       // 最大样本
+    uint64_t counts[BUCKET_NUM] = {};
+};
+
+// 埋点数据：线程本地记录，读取时合并
+class Instrumentation {
+public:
+    // 一项操作的合并结果：全部调用，及期间发生过 B+ 树结构调整的调用
+    struct OpStats {
+        LatencyHistogram all;
+        LatencyHistogram restructured;
+    };
+
+    // 合并后的快照
+    struct Snapshot {
+        bool enabled = INVITE_INSTRUMENT != 0;
+        int32_t threads = 0;
+        OpStats ops[OP_NUM];
+        uint64_t events[EVENT_NUM] = {};
+
+        // 文本输出：每项操作的次数、平均值与分位数（微秒），以及触发结构调整的调用
+        void PrintText(std::ostream &out) const {
+            if (!this->enabled) {
+                out << "埋点未启用（编译时加 -DINVITE_INSTRUMENT=1）" << std::endl;
+                return;
+            }
+            char line[256];
+            out << "埋点统计（" << this->threads << " 个线程，单位 us）：" << std::endl;
+            for (int32_t op = 0; op < OP_NUM; op++) {
+                const LatencyHistogram &all = this->ops[op].all;
+                const LatencyHistogram &restructured = this->ops[op].restructured;
+                if (all.count == 0) {
+                    continue;
+                }
+                snprintf(line, sizeof(line),
+                         "  %-22s %10lu 次  avg %8.3f  p50 %8.3f  p99 %8.3f  p999 %9.3f  max %10.3f  |  调整 %8lu 次  p99 %9.3f",
+                         OpName((INSTRUMENT_OP) op), (unsigned long) all.count, all.Mean() / 1000.0,
+                         all.Percentile(0.5) / 1000.0, all.Percentile(0.99) / 1000.0, all.Percentile(0.999) / 1000.0,
+                         all.max / 1000.0, (unsigned long) restructured.count, restructured.Percentile(0.99) / 1000.0);
+                out << line << std::endl;
+            }
+            out << "  结构调整：";
+            for (int32_t e = 0; e < EVENT_NUM; e++) {
+                out << (e > 0 ? "，" : "") << EventName((INSTRUMENT_EVENT) e) << " " << this->events[e];
+            }
+            out << std::endl;
+        }
+
+        // JSON 输出：延迟单位为纳秒
+        void PrintJson(std::ostream &out) const {
+            auto printHistogram = [&](const LatencyHistogram &h) {
+                out << "{\"count\":" << h.count << ",\"mean_ns\":" << (uint64_t) h.Mean() << ",\"p50_ns\":"
+                    << h.Percentile(0.5) << ",\"p90_ns\":" << h.Percentile(0.9) << ",\"p99_ns\":" << h.Percentile(0.99)
+                    << ",\"p999_ns\":" << h.Percentile(0.999) << ",\"max_ns\":" << h.max << "}";
+            };
+            out << "{\"enabled\":" << (this->enabled ? "true" : "false") << ",\"threads\":" << this->threads
+                << ",\"ops\":{";
+            for (int32_t op = 0; op < OP_NUM; op++) {
+                out << (op > 0 ? "," : "") << "\"" << OpName((INSTRUMENT_OP) op) << "\":{\"all\":";
+                printHistogram(this->ops[op].all);
+                out << ",\"restructured\":";
+                printHistogram(this->ops[op].restructured);
+                out << "}";
+            }
+            out << "},\"events\":{";
+            for (int32_t e = 0; e < EVENT_NUM; e++) {
+                out << (e > 0 ? "," : "") << "\"" << EventName((INSTRUMENT_EVENT) e) << "\":" << this->events[e];
+            }
+            out << "}}" << std::endl;
+        }
+    };
+
+    static const char *OpName(INSTRUMENT_OP op) {
+        static const char *names[OP_NUM] = { "addInviteRelationship", "_Locate", "select", "_InsertEdge",
+                                             "GetAncestors", "GetDownline", "GetNthLevel", "multiFind" };
+        return names[op];
+    }
+
+    static const char *EventName(INSTRUMENT_EVENT event) {
+        static const char *names[EVENT_NUM] = { "split", "merge", "borrow", "redistribute" };
+        return names[event];
+    }
+
+    // 记录一次操作的延迟（纳秒）
+    static void Record(INSTRUMENT_OP op, uint64_t nanoseconds, bool restructured) {
+        ThreadSlot &slot = _Local();
+        int32_t bucket = LatencyHistogram::BucketOf(nanoseconds);
+        _Record(slot.ops[op][0], bucket, nanoseconds);
+        if (restructured) {
+            _Record(slot.ops[op][1], bucket, nanoseconds);
+        }
+    }
+
+    // 记录一次结构调整
+    static void Count(INSTRUMENT_EVENT event) {
+        ThreadSlot &slot = _Local();
+        _Increment(slot.events[event], 1);
+        _Increment(slot.eventTotal, 1);
+    }
+
+    // 当前线程累计的结构调整次数，用于判断一次操作期间是否发生过调整
+    static uint64_t LocalEvents() {
+        return _Local().eventTotal.load(std::memory_order_relaxed);
+    }
+
+    // 合并所有线程的数据
+    static Snapshot Collect() {
+        Snapshot snapshot;
+        std::lock_guard<std::mutex> lock(_Mutex());
+        for (const std::unique_ptr<ThreadSlot> &slot : _Slots()) {
+            snapshot.threads++;
+            for (int32_t op = 0; op < OP_NUM; op++) {
+                _Load(slot->ops[op][0], snapshot.ops[op].all);
+                _Load(slot->ops[op][1], snapshot.ops[op].restructured);
+            }
+            for (int32_t e = 0; e < EVENT_NUM; e++) {
+                snapshot.events[e] += slot->events[e].load(std::memory_order_relaxed);
+            }
+        }
+        return snapshot;
+    }
+
+    // 清零所有线程的数据（与写入并发时可能丢失少量样本）
+    static void Reset() {
+        std::lock_guard<std::mutex> lock(_Mutex());
+        for (const std::unique_ptr<ThreadSlot> &slot : _Slots()) {
+            for (int32_t op = 0; op < OP_NUM; op++) {
+                for (Cells &cells : slot->ops[op]) {
+                    for (std::atomic<uint64_t> &c : cells.counts) {
+                        c.store(0, std::memory_order_relaxed);
+                    }
+                    cells.sum.store(0, std::memory_order_relaxed);
+                    cells.max.store(0, std::memory_order_relaxed);
+                }
+            }
+            for (std::atomic<uint64_t> &c : slot->events) {
+                c.store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+
+private:
+    // 一个直方图的线程本地计数：只有所属线程写入，读取线程用 relaxed 原子读
+    struct Cells {
+        std::atomic<uint64_t> counts[LatencyHistogram::BUCKET_NUM] = {};
+        std::atomic<uint64_t> sum = 0;
+        std::atomic<uint64_t> max = 0;
+    };
+
+    struct ThreadSlot {
+        Cells ops[OP_NUM][2];
+        std::atomic<uint64_t> events[EVENT_NUM] = {};
+        std::atomic<uint64_t> eventTotal = 0;
+    };
+
+    // 单写者递增：普通读写即可，无需原子读-改-写指令
+    static void _Increment(std::atomic<uint64_t> &c, uint64_t n) {
+        c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    static void _Record(Cells &cells, int32_t bucket, uint64_t value) {
+        _Increment(cells.counts[bucket], 1);
+        _Increment(cells.sum, value);
+        if (value > cells.max.load(std::memory_order_relaxed)) {
+            cells.max.store(value, std::memory_order_relaxed);
+        }
+    }
+
+    static void _Load(const Cells &cells, LatencyHistogram &result) {
+        for (int32_t i = 0; i < LatencyHistogram::BUCKET_NUM; i++) {
+            uint64_t n = cells.counts[i].load(std::memory_order_relaxed);
+            if (n > 0) {
+                result.Add(i, n);
+            }
+        }
+        result.sum += cells.sum.load(std::memory_order_relaxed);
+        result.max = std::max(result.max, cells.max.load(std::memory_order_relaxed));
+    }
+
+    // 当前线程的计数槽：首次使用时登记，线程退出后仍保留以便合并
+    static ThreadSlot &_Local() {
+        thread_local ThreadSlot *slot = nullptr;
+        if (slot == nullptr) {
+            std::unique_ptr<ThreadSlot> created(new ThreadSlot());
+            slot = created.get();
+            std::lock_guard<std::mutex> lock(_Mutex());
+            _Slots().push_back(std::move(created));
+        }
+        return *slot;
+    }
+
+    static std::mutex &_Mutex() {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    static std::vector<std::unique_ptr<ThreadSlot>> &_Slots() {
+        static std::vector<std::unique_ptr<ThreadSlot>> slots;
+        return slots;
+    }
+};
+
+// 作用域计时：析构时记录延迟，并比较前后的结构调整次数
+class ScopedOpTimer {
+public:
+    explicit ScopedOpTimer(INSTRUMENT_OP op)
+            : op(op), events(Instrumentation::LocalEvents()), start(std::chrono::steady_clock::now()) {
+    }
+
+    ~ScopedOpTimer() {
+        uint64_t nanoseconds = (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - this->start).count();
+        Instrumentation::Record(this->op, nanoseconds, Instrumentation::LocalEvents() != this->events);
+    }
+
+    ScopedOpTimer(const ScopedOpTimer &) = delete;
+    ScopedOpTimer &operator=(const ScopedOpTimer &) = delete;
+
+private:
+    INSTRUMENT_OP op;
+    uint64_t events;
+    std::chrono::steady_clock::time_point start;
+};
+
+#define INSTRUMENT_CONCAT_(a, b) a##b
+#define INSTRUMENT_CONCAT(a, b) INSTRUMENT_CONCAT_(a, b)
+#if INVITE_INSTRUMENT
+#define INSTRUMENT_SCOPE(op) ScopedOpTimer INSTRUMENT_CONCAT(instrumentScope, __LINE__)(op)
+#define INSTRUMENT_EVENT(event) Instrumentation::Count(event)
+#else
+#define INSTRUMENT_SCOPE(op) ((void) 0)
+#define INSTRUMENT_EVENT(event) ((void) 0)
+#endif
+
+// 软件预取：编译时以 -DBPLUS_PREFETCH=0 关闭，便于对比
+#ifndef BPLUS_PREFETCH
+#define BPLUS_PREFETCH 1
+#endif
+
+const int32_t CACHE_LINE = 64;
+const int32_t MULTI_FIND_GROUP = 16;    // 批量查找时同步下降的键值个数，受限于可同时进行的缓存未命中数
+
+// 预取对象的前 bytes 字节（最多 8 个缓存行），只发出请求，不等待数据
+inline void PrefetchObject(const void *p, size_t bytes) {
+#if BPLUS_PREFETCH && defined(__GNUC__)
+    size_t lines = std::min<size_t>((bytes + CACHE_LINE - 1) / CACHE_LINE, 8);
+    for (size_t i = 0; i < lines; i++) {
+        __builtin_prefetch((const char *) p + i * CACHE_LINE);
+    }
+#else
+    (void) p;
+    (void) bytes;
+#endif
+}
 
 // 结点类型：内结点、叶子结点
 enum NODE_TYPE {
@@ -30,9 +451,11 @@ enum SIBLING_DIRECTION {
 };
 
 // 结点基类
-template<typename KeyType>
+template<typename KeyType, int32_t Order = ORDER>
 class BaseNode {
 public:
+    using Capacity = NodeCapacity<Order>;
+
     BaseNode() {
         setType(LEAF);
         setKeyNum(0);
@@ -42,13 +465,13 @@ public:
         setKeyNum(0);
     }
 
-    NODE_TYPE getType() const { return m_Type; }
+    NODE_TYPE getType() const { return (NODE_TYPE) m_Type; }
 
-    void setType(NODE_TYPE type) { m_Type = type; }
+    void setType(NODE_TYPE type) { m_Type = (uint8_t) type; }
 
     int32_t getKeyNum() const { return m_KeyNum; }
 
-    void setKeyNum(int32_t n) { m_KeyNum = n; }
+    void setKeyNum(int32_t n) { m_KeyNum = (int16_t) n; }
 
     KeyType getKeyValue(int32_t i) const { return m_KeyValues[i]; }
 
@@ -71,100 +494,123 @@ public:
         return left;
     }
 
+    // 不大于 key 的键值个数，即内结点中 key 所在子树的下标：逐个比较，无分支，只读取键值，不触及孩子指针
+    int32_t countNotGreater(KeyType key) const {
+        int32_t n = 0;
+        for (int32_t i = 0; i < m_KeyNum; ++i) {
+            n += !(key < m_KeyValues[i]);
+        }
+        return n;
+    }
+
+    // 小于 key 的键值个数，即叶子结点中第一个不小于 key 的键值下标
+    int32_t countLess(KeyType key) const {
+        int32_t n = 0;
+        for (int32_t i = 0; i < m_KeyNum; ++i) {
+            n += m_KeyValues[i] < key;
+        }
+        return n;
+    }
+
     // 纯虚函数，定义接口
     virtual void removeKey(int32_t keyIndex, int32_t childIndex) = 0;  // 从结点中移除键值
     virtual void split(BaseNode *parentNode, int32_t childIndex) = 0; // 分裂结点
     virtual void mergeChild(BaseNode *parentNode, BaseNode *childNode, int32_t keyIndex) = 0;  // 合并结点
+    virtual void redistribute(BaseNode *siblingNode, BaseNode *parentNode, int32_t keyIndex) = 0;  // 与右兄弟结点平分键值
     virtual void clear() = 0; // 清空结点，同时会清空结点所包含的子树结点
     virtual void
     borrowFrom(BaseNode *destNode, BaseNode *parentNode, int32_t keyIndex, SIBLING_DIRECTION d) = 0; // 从兄弟结点中借一个键值
     virtual int32_t getChildIndex(KeyType key, int32_t keyIndex) const = 0;  // 根据键值获取孩子结点指针下标
 protected:
-    NODE_TYPE m_Type;
-    int32_t m_KeyNum;
-    KeyType m_KeyValues[MAXNUM_KEY];
+    // 结点头尽量紧凑：虚表指针、类型与键值个数共 12 字节，键值紧随其后，下降时先比较键值，再读取位于其后的孩子指针。
+    // 注：7 阶、int32_t 键值时结点头与 13 个键值共 64 字节，但结点由 new 分配（16 字节对齐），通常跨两个缓存行；
+    // 顶点表的 16 阶（31 个键值，共 136 字节）占三个缓存行
+    uint8_t m_Type;
+    int16_t m_KeyNum;
+    KeyType m_KeyValues[Capacity::MAXNUM_KEY];
 };
 
 // 内结点
-template<typename KeyType>
-class InternalNode : public BaseNode<KeyType> {
+template<typename KeyType, int32_t Order = ORDER>
+class InternalNode : public BaseNode<KeyType, Order> {
 public:
-    InternalNode() : BaseNode<KeyType>() {
-        BaseNode<KeyType>::setType(INTERNAL);
+    using Capacity = NodeCapacity<Order>;
+
+    InternalNode() : BaseNode<KeyType, Order>() {
+        BaseNode<KeyType, Order>::setType(INTERNAL);
     }
 
     virtual ~InternalNode() {
 
     }
 
-    BaseNode<KeyType> *getChild(int32_t i) const { return m_Childs[i]; }
+    BaseNode<KeyType, Order> *getChild(int32_t i) const { return m_Childs[i]; }
 
-    void setChild(int32_t i, BaseNode<KeyType> *child) { m_Childs[i] = child; }
+    void setChild(int32_t i, BaseNode<KeyType, Order> *child) { m_Childs[i] = child; }
 
-    void insert(int32_t keyIndex, int32_t childIndex, KeyType key, BaseNode<KeyType> *childNode) {
-        int32_t i;
-        for (i = BaseNode<KeyType>::getKeyNum(); i > keyIndex; --i)//将父节点中的childIndex后的所有关键字的值和子树指针向后移一位
-        {
-            setChild(i + 1, m_Childs[i]);
-            this->setKeyValue(i, BaseNode<KeyType>::m_KeyValues[i - 1]);
-        }
-        if (i == childIndex) {
-            setChild(i + 1, m_Childs[i]);
-        }
+    // 取 key 所在的孩子，并预取该孩子结点，与其键值、孩子指针所在的缓存行同时加载
+    BaseNode<KeyType, Order> *descend(KeyType key) const {
+        BaseNode<KeyType, Order> *pChild = m_Childs[BaseNode<KeyType, Order>::countNotGreater(key)];
+        PrefetchObject(pChild, sizeof(InternalNode));
+        return pChild;
+    }
+
+    void insert(int32_t keyIndex, int32_t childIndex, KeyType key, BaseNode<KeyType, Order> *childNode) {
+        KeyType *keys = BaseNode<KeyType, Order>::m_KeyValues;
+        int32_t keyNum = BaseNode<KeyType, Order>::getKeyNum();
+        // 将 keyIndex 后的所有关键字和 childIndex 后的所有子树指针整体向后移一位
+        std::copy_backward(keys + keyIndex, keys + keyNum, keys + keyNum + 1);
+        std::copy_backward(m_Childs + childIndex, m_Childs + keyNum + 1, m_Childs + keyNum + 2);
         setChild(childIndex, childNode);
         this->setKeyValue(keyIndex, key);
-        this->setKeyNum(BaseNode<KeyType>::m_KeyNum + 1);
+        this->setKeyNum(BaseNode<KeyType, Order>::m_KeyNum + 1);
     }
 
-    virtual void split(BaseNode<KeyType> *parentNode, int32_t childIndex) {
+    virtual void split(BaseNode<KeyType, Order> *parentNode, int32_t childIndex) {
         InternalNode *newNode = new InternalNode();   //分裂后的右节点
-        newNode->setKeyNum(MINNUM_KEY);
-        int32_t i;
-        // 拷贝关键字的值
-        for (i = 0; i < MINNUM_KEY; ++i) {
-            newNode->setKeyValue(i, BaseNode<KeyType>::m_KeyValues[i + MINNUM_CHILD]);
-        }
-
-        // 拷贝孩子节点指针
-        for (i = 0; i < MINNUM_CHILD; ++i) {
-            newNode->setChild(i, m_Childs[i + MINNUM_CHILD]);
-        }
-
-        BaseNode<KeyType>::setKeyNum(MINNUM_KEY);  //更新左子树的关键字个数
-        ((InternalNode *) parentNode)->insert(childIndex, childIndex + 1, BaseNode<KeyType>::m_KeyValues[MINNUM_KEY], newNode);
+        newNode->setKeyNum(Capacity::MINNUM_KEY);
+        // 拷贝关键字的值与孩子节点指针
+        std::copy(BaseNode<KeyType, Order>::m_KeyValues + Capacity::MINNUM_CHILD, BaseNode<KeyType, Order>::m_KeyValues + Capacity::MAXNUM_KEY,
+                  newNode->m_KeyValues);
+        std::copy(m_Childs + Capacity::MINNUM_CHILD, m_Childs + Capacity::MAXNUM_CHILD, newNode->m_Childs);
+
+        BaseNode<KeyType, Order>::setKeyNum(Capacity::MINNUM_KEY);  //更新左子树的关键字个数
+        ((InternalNode *) parentNode)->insert(childIndex, childIndex + 1, BaseNode<KeyType, Order>::m_KeyValues[Capacity::MINNUM_KEY], newNode);
     }
 
-    virtual void mergeChild(BaseNode<KeyType> *parentNode, BaseNode<KeyType> *childNode, int32_t keyIndex) {
-        // 合并数据
-        insert(MINNUM_KEY, MINNUM_KEY + 1, parentNode->getKeyValue(keyIndex),
-               ((InternalNode *) childNode)->getChild(0));
-        int32_t i;
-        for (i = 1; i <= childNode->getKeyNum(); ++i) {
-            insert(MINNUM_KEY + i, MINNUM_KEY + i + 1, childNode->getKeyValue(i - 1),
-                   ((InternalNode *) childNode)->getChild(i));
-        }
-        //父节点删除index的key
+    virtual void mergeChild(BaseNode<KeyType, Order> *parentNode, BaseNode<KeyType, Order> *childNode, int32_t keyIndex) {
+        // 合并数据：父结点的分隔键下移，右结点的键值与孩子指针整体追加到末尾
+        InternalNode *pChild = (InternalNode *) childNode;
+        KeyType *keys = BaseNode<KeyType, Order>::m_KeyValues;
+        int32_t keyNum = BaseNode<KeyType, Order>::getKeyNum();
+        int32_t childKeyNum = pChild->getKeyNum();
+        keys[keyNum] = parentNode->getKeyValue(keyIndex);
+        std::copy(pChild->m_KeyValues, pChild->m_KeyValues + childKeyNum, keys + keyNum + 1);
+        std::copy(pChild->m_Childs, pChild->m_Childs + childKeyNum + 1, m_Childs + keyNum + 1);
+        BaseNode<KeyType, Order>::setKeyNum(keyNum + 1 + childKeyNum);
+        //父节点删除index的key，并释放被合并的结点（须在移除前取得，移除后孩子指针已前移）
         parentNode->removeKey(keyIndex, keyIndex + 1);
-        delete ((InternalNode *) parentNode)->getChild(keyIndex + 1);
+        delete childNode;
     }
 
     virtual void removeKey(int32_t keyIndex, int32_t childIndex) {
-        for (int32_t i = 0; i < BaseNode<KeyType>::getKeyNum() - keyIndex - 1; ++i) {
-            this->setKeyValue(keyIndex + i, BaseNode<KeyType>::getKeyValue(keyIndex + i + 1));
-            setChild(childIndex + i, getChild(childIndex + i + 1));
-        }
-        this->setKeyNum(BaseNode<KeyType>::getKeyNum() - 1);
+        // 键值与孩子指针分别前移：childIndex 可能等于 keyIndex（移除最左孩子）或 keyIndex + 1
+        KeyType *keys = BaseNode<KeyType, Order>::m_KeyValues;
+        int32_t keyNum = BaseNode<KeyType, Order>::getKeyNum();
+        std::copy(keys + keyIndex + 1, keys + keyNum, keys + keyIndex);
+        std::copy(m_Childs + childIndex + 1, m_Childs + keyNum + 1, m_Childs + childIndex);
+        this->setKeyNum(keyNum - 1);
     }
 
     virtual void clear() {
-        for (int32_t i = 0; i <= BaseNode<KeyType>::m_KeyNum; ++i) {
+        for (int32_t i = 0; i <= BaseNode<KeyType, Order>::m_KeyNum; ++i) {
             m_Childs[i]->clear();
             delete m_Childs[i];
             m_Childs[i] = nullptr;
         }
     }
 
-    virtual void borrowFrom(BaseNode<KeyType> *siblingNode, BaseNode<KeyType> *parentNode, int32_t keyIndex, SIBLING_DIRECTION d) {
+    virtual void borrowFrom(BaseNode<KeyType, Order> *siblingNode, BaseNode<KeyType, Order> *parentNode, int32_t keyIndex, SIBLING_DIRECTION d) {
         switch (d) {
             case LEFT:  // 从左兄弟结点借
             {
@@ -176,7 +622,7 @@ public:
                 break;
             case RIGHT:  // 从右兄弟结点借
             {
-                insert(BaseNode<KeyType>::getKeyNum(), BaseNode<KeyType>::getKeyNum() + 1, parentNode->getKeyValue(keyIndex),
+                insert(BaseNode<KeyType, Order>::getKeyNum(), BaseNode<KeyType, Order>::getKeyNum() + 1, parentNode->getKeyValue(keyIndex),
                        ((InternalNode *) siblingNode)->getChild(0));
                 parentNode->setKeyValue(keyIndex, siblingNode->getKeyValue(0));
                 siblingNode->removeKey(0, 0);
@@ -187,8 +633,39 @@ public:
         }
     }
 
+    virtual void redistribute(BaseNode<KeyType, Order> *siblingNode, BaseNode<KeyType, Order> *parentNode, int32_t keyIndex) {
+        // 键值序列为 左结点键值、分隔键、右结点键值，平分后中间的键值上移为新的分隔键
+        InternalNode *pRight = (InternalNode *) siblingNode;
+        KeyType *leftKeys = BaseNode<KeyType, Order>::m_KeyValues, *rightKeys = pRight->m_KeyValues;
+        int32_t leftNum = BaseNode<KeyType, Order>::getKeyNum(), rightNum = pRight->getKeyNum();
+        int32_t newLeftNum = (leftNum + rightNum) / 2;
+        KeyType separator = parentNode->getKeyValue(keyIndex);
+        if (leftNum > newLeftNum) {
+            // 左结点尾部移到右结点头部
+            int32_t m = leftNum - newLeftNum;
+            std::copy_backward(rightKeys, rightKeys + rightNum, rightKeys + rightNum + m);
+            std::copy_backward(pRight->m_Childs, pRight->m_Childs + rightNum + 1, pRight->m_Childs + rightNum + 1 + m);
+            rightKeys[m - 1] = separator;
+            std::copy(leftKeys + newLeftNum + 1, leftKeys + leftNum, rightKeys);
+            std::copy(m_Childs + newLeftNum + 1, m_Childs + leftNum + 1, pRight->m_Childs);
+            parentNode->setKeyValue(keyIndex, leftKeys[newLeftNum]);
+        } else if (leftNum < newLeftNum) {
+            // 右结点头部移到左结点尾部
+            int32_t m = newLeftNum - leftNum;
+            leftKeys[leftNum] = separator;
+            std::copy(rightKeys, rightKeys + m - 1, leftKeys + leftNum + 1);
+            std::copy(pRight->m_Childs, pRight->m_Childs + m, m_Childs + leftNum + 1);
+            parentNode->setKeyValue(keyIndex, rightKeys[m - 1]);
+            std::copy(rightKeys + m, rightKeys + rightNum, rightKeys);
+            std::copy(pRight->m_Childs + m, pRight->m_Childs + rightNum + 1, pRight->m_Childs);
+        }
+        BaseNode<KeyType, Order>::setKeyNum(newLeftNum);
+        pRight->setKeyNum(leftNum + rightNum - newLeftNum);
+    }
+
     virtual int32_t getChildIndex(KeyType key, int32_t keyIndex) const {
-        if (key == BaseNode<KeyType>::getKeyValue(keyIndex)) {
+        // 键值不小于分隔键（含大于所有键值的情况）时进入右侧子树
+        if (key >= BaseNode<KeyType, Order>::getKeyValue(keyIndex)) {
             return keyIndex + 1;
         } else {
             return keyIndex;
@@ -196,15 +673,17 @@ public:
     }
 
 private:
-    BaseNode<KeyType> *m_Childs[MAXNUM_CHILD];
+    BaseNode<KeyType, Order> *m_Childs[Capacity::MAXNUM_CHILD];
 };
 
 // 叶子结点
-template<typename KeyType, typename DataType>
-class LeafNode : public BaseNode<KeyType> {
+template<typename KeyType, typename DataType, int32_t Order = ORDER>
+class LeafNode : public BaseNode<KeyType, Order> {
 public:
-    LeafNode() : BaseNode<KeyType>() {
-        BaseNode<KeyType>::setType(LEAF);
+    using Capacity = NodeCapacity<Order>;
+
+    LeafNode() : BaseNode<KeyType, Order>() {
+        BaseNode<KeyType, Order>::setType(LEAF);
         setLeftSibling(nullptr);
         setRightSibling(nullptr);
     }
@@ -221,56 +700,126 @@ public:
 
     void setRightSibling(LeafNode *node) { m_RightSibling = node; }
 
-    DataType getData(int32_t i) const { return m_Datas[i]; }
+    const DataType &getData(int32_t i) const { return m_Datas[i]; }
+
+    DataType &getData(int32_t i) { return m_Datas[i]; }
 
     void setData(int32_t i, const DataType &data) { m_Datas[i] = data; }
 
+    void setData(int32_t i, DataType &&data) { m_Datas[i] = std::move(data); }
+
     void insert(KeyType key, const DataType &data) {
-        int32_t i;
-        for (i = BaseNode<KeyType>::m_KeyNum; i >= 1 && BaseNode<KeyType>::m_KeyValues[i - 1] > key; --i) {
-            this->setKeyValue(i, BaseNode<KeyType>::m_KeyValues[i - 1]);
-            setData(i, m_Datas[i - 1]);
+        emplace(key, data);
+    }
+
+    void insert(KeyType key, DataType &&data) {
+        emplace(key, std::move(data));
+    }
+
+    // 插入键值，数据由 args 构造；其后的数据依次移动（而非复制）腾出位置，返回新数据的引用
+    // 参数恰为一个 DataType 时直接复制或移动赋值到位，不构造临时对象，因此 args 不能引用本结点中的数据
+    template<typename... Args>
+    DataType &emplace(KeyType key, Args &&... args) {
+        KeyType *keys = BaseNode<KeyType, Order>::m_KeyValues;
+        int32_t keyNum = BaseNode<KeyType, Order>::m_KeyNum;
+        int32_t i = (int32_t) (std::upper_bound(keys, keys + keyNum, key) - keys);
+        std::copy_backward(keys + i, keys + keyNum, keys + keyNum + 1);
+        std::move_backward(m_Datas + i, m_Datas + keyNum, m_Datas + keyNum + 1);
+        this->setKeyValue(i, key);
+        if constexpr (sizeof...(Args) == 1 && (std::is_same_v<std::remove_cvref_t<Args>, DataType> && ...)) {
+            m_Datas[i] = (std::forward<Args>(args), ...);
+        } else {
+            m_Datas[i] = DataType(std::forward<Args>(args)...);
+        }
+        this->setKeyNum(keyNum + 1);
+        return m_Datas[i];
+    }
+
+    // 将下标 i 处的键值改为 key 并移动到有序位置，数据随之移动；key 不能已存在于结点中
+    void moveKey(int32_t i, KeyType key) {
+        DataType data = std::move(m_Datas[i]);
+        for (; i + 1 < BaseNode<KeyType, Order>::m_KeyNum && BaseNode<KeyType, Order>::m_KeyValues[i + 1] < key; ++i) {
+            this->setKeyValue(i, BaseNode<KeyType, Order>::m_KeyValues[i + 1]);
+            setData(i, std::move(m_Datas[i + 1]));
+        }
+        for (; i > 0 && BaseNode<KeyType, Order>::m_KeyValues[i - 1] > key; --i) {
+            this->setKeyValue(i, BaseNode<KeyType, Order>::m_KeyValues[i - 1]);
+            setData(i, std::move(m_Datas[i - 1]));
         }
         this->setKeyValue(i, key);
-        setData(i, data);
-        this->setKeyNum(BaseNode<KeyType>::m_KeyNum + 1);
+        setData(i, std::move(data));
     }
 
-    virtual void split(BaseNode<KeyType> *parentNode, int32_t childIndex) {
+    virtual void split(BaseNode<KeyType, Order> *parentNode, int32_t childIndex) {
         LeafNode *newNode = new LeafNode();//分裂后的右节点
-        BaseNode<KeyType>::setKeyNum(MINNUM_LEAF);
-        newNode->setKeyNum(MINNUM_LEAF + 1);
+        BaseNode<KeyType, Order>::setKeyNum(Capacity::MINNUM_LEAF);
+        newNode->setKeyNum(Capacity::MINNUM_LEAF + 1);
         newNode->setRightSibling(getRightSibling());
+        if (getRightSibling() != nullptr) {
+            getRightSibling()->setLeftSibling(newNode);
+        }
         setRightSibling(newNode);
         newNode->setLeftSibling(this);
-        int32_t i;
-        for (i = 0; i < MINNUM_LEAF + 1; ++i)// 拷贝关键字的值
-        {
-            newNode->setKeyValue(i, BaseNode<KeyType>::m_KeyValues[i + MINNUM_LEAF]);
-        }
-        for (i = 0; i < MINNUM_LEAF + 1; ++i)// 拷贝数据
-        {
-            newNode->setData(i, m_Datas[i + MINNUM_LEAF]);
-        }
-        ((InternalNode<KeyType> *) parentNode)->insert(childIndex, childIndex + 1, BaseNode<KeyType>::m_KeyValues[MINNUM_LEAF], newNode);
+        // 拷贝关键字的值与数据
+        std::copy(BaseNode<KeyType, Order>::m_KeyValues + Capacity::MINNUM_LEAF, BaseNode<KeyType, Order>::m_KeyValues + Capacity::MAXNUM_LEAF,
+                  newNode->m_KeyValues);
+        std::move(m_Datas + Capacity::MINNUM_LEAF, m_Datas + Capacity::MAXNUM_LEAF, newNode->m_Datas);
+        ((InternalNode<KeyType, Order> *) parentNode)->insert(childIndex, childIndex + 1, BaseNode<KeyType, Order>::m_KeyValues[Capacity::MINNUM_LEAF], newNode);
     }
 
-    virtual void mergeChild(BaseNode<KeyType> *parentNode, BaseNode<KeyType> *childNode, int32_t keyIndex) {
-        // 合并数据
-        for (int32_t i = 0; i < childNode->getKeyNum(); ++i) {
-            insert(childNode->getKeyValue(i), ((LeafNode *) childNode)->getData(i));
-        }
+    virtual void mergeChild(BaseNode<KeyType, Order> *parentNode, BaseNode<KeyType, Order> *childNode, int32_t keyIndex) {
+        // 合并数据：右结点的键值均大于本结点，整体追加到末尾
+        LeafNode *pChild = (LeafNode *) childNode;
+        int32_t keyNum = BaseNode<KeyType, Order>::getKeyNum();
+        std::copy(pChild->m_KeyValues, pChild->m_KeyValues + pChild->getKeyNum(), BaseNode<KeyType, Order>::m_KeyValues + keyNum);
+        std::move(pChild->m_Datas, pChild->m_Datas + pChild->getKeyNum(), m_Datas + keyNum);
+        BaseNode<KeyType, Order>::setKeyNum(keyNum + pChild->getKeyNum());
         setRightSibling(((LeafNode *) childNode)->getRightSibling());
-        //父节点删除index的key，
+        if (getRightSibling() != nullptr) {
+            getRightSibling()->setLeftSibling(this);
+        }
+        //父节点删除index的key，并释放被合并的结点
         parentNode->removeKey(keyIndex, keyIndex + 1);
+        delete childNode;
     }
 
     virtual void removeKey(int32_t keyIndex, int32_t childIndex) {
-        for (int32_t i = keyIndex; i < BaseNode<KeyType>::getKeyNum() - 1; ++i) {
-            this->setKeyValue(i, BaseNode<KeyType>::getKeyValue(i + 1));
-            setData(i, getData(i + 1));
+        KeyType *keys = BaseNode<KeyType, Order>::m_KeyValues;
+        int32_t keyNum = BaseNode<KeyType, Order>::getKeyNum();
+        std::copy(keys + keyIndex + 1, keys + keyNum, keys + keyIndex);
+        std::move(m_Datas + keyIndex + 1, m_Datas + keyNum, m_Datas + keyIndex);
+        if constexpr (!std::is_trivially_copyable_v<DataType>) {
+            m_Datas[keyNum - 1] = DataType();   // 释放空出位置上数据持有的资源
+        }
+        this->setKeyNum(keyNum - 1);
+    }
+
+    // 移除在有序键值区间 [first, last) 中出现的所有键值，剩余键值整体前移，返回移除个数
+    int32_t removeKeys(const KeyType *first, const KeyType *last) {
+        KeyType *keys = BaseNode<KeyType, Order>::m_KeyValues;
+        int32_t keyNum = BaseNode<KeyType, Order>::getKeyNum();
+        int32_t w = 0;
+        for (int32_t r = 0; r < keyNum; ++r) {
+            while (first != last && *first < keys[r]) {
+                ++first;
+            }
+            if (first != last && *first == keys[r]) {
+                ++first;
+                continue;
+            }
+            if (w != r) {
+                keys[w] = keys[r];
+                m_Datas[w] = std::move(m_Datas[r]);
+            }
+            ++w;
+        }
+        if constexpr (!std::is_trivially_copyable_v<DataType>) {
+            for (int32_t i = w; i < keyNum; ++i) {
+                m_Datas[i] = DataType();    // 释放空出位置上数据持有的资源
+            }
         }
-        this->setKeyNum(BaseNode<KeyType>::getKeyNum() - 1);
+        this->setKeyNum(w);
+        return keyNum - w;
     }
 
     virtual void clear() {
@@ -281,19 +830,19 @@ public:
 //        }
     }
 
-    virtual void borrowFrom(BaseNode<KeyType> *siblingNode, BaseNode<KeyType> *parentNode, int32_t keyIndex, SIBLING_DIRECTION d) {
+    virtual void borrowFrom(BaseNode<KeyType, Order> *siblingNode, BaseNode<KeyType, Order> *parentNode, int32_t keyIndex, SIBLING_DIRECTION d) {
         switch (d) {
             case LEFT:  // 从左兄弟结点借
             {
                 insert(siblingNode->getKeyValue(siblingNode->getKeyNum() - 1),
-                       ((LeafNode *) siblingNode)->getData(siblingNode->getKeyNum() - 1));
+                       std::move(((LeafNode *) siblingNode)->getData(siblingNode->getKeyNum() - 1)));
                 siblingNode->removeKey(siblingNode->getKeyNum() - 1, siblingNode->getKeyNum() - 1);
-                parentNode->setKeyValue(keyIndex, BaseNode<KeyType>::getKeyValue(0));
+                parentNode->setKeyValue(keyIndex, BaseNode<KeyType, Order>::getKeyValue(0));
             }
                 break;
             case RIGHT:  // 从右兄弟结点借
             {
-                insert(siblingNode->getKeyValue(0), ((LeafNode *) siblingNode)->getData(0));
+                insert(siblingNode->getKeyValue(0), std::move(((LeafNode *) siblingNode)->getData(0)));
                 siblingNode->removeKey(0, 0);
                 parentNode->setKeyValue(keyIndex, siblingNode->getKeyValue(0));
             }
@@ -303,6 +852,31 @@ public:
         }
     }
 
+    virtual void redistribute(BaseNode<KeyType, Order> *siblingNode, BaseNode<KeyType, Order> *parentNode, int32_t keyIndex) {
+        LeafNode *pRight = (LeafNode *) siblingNode;
+        KeyType *leftKeys = BaseNode<KeyType, Order>::m_KeyValues, *rightKeys = pRight->m_KeyValues;
+        int32_t leftNum = BaseNode<KeyType, Order>::getKeyNum(), rightNum = pRight->getKeyNum();
+        int32_t newLeftNum = (leftNum + rightNum) / 2;
+        if (leftNum > newLeftNum) {
+            // 左结点尾部移到右结点头部
+            int32_t m = leftNum - newLeftNum;
+            std::copy_backward(rightKeys, rightKeys + rightNum, rightKeys + rightNum + m);
+            std::move_backward(pRight->m_Datas, pRight->m_Datas + rightNum, pRight->m_Datas + rightNum + m);
+            std::copy(leftKeys + newLeftNum, leftKeys + leftNum, rightKeys);
+            std::move(m_Datas + newLeftNum, m_Datas + leftNum, pRight->m_Datas);
+        } else if (leftNum < newLeftNum) {
+            // 右结点头部移到左结点尾部
+            int32_t m = newLeftNum - leftNum;
+            std::copy(rightKeys, rightKeys + m, leftKeys + leftNum);
+            std::move(pRight->m_Datas, pRight->m_Datas + m, m_Datas + leftNum);
+            std::copy(rightKeys + m, rightKeys + rightNum, rightKeys);
+            std::move(pRight->m_Datas + m, pRight->m_Datas + rightNum, pRight->m_Datas);
+        }
+        BaseNode<KeyType, Order>::setKeyNum(newLeftNum);
+        pRight->setKeyNum(leftNum + rightNum - newLeftNum);
+        parentNode->setKeyValue(keyIndex, rightKeys[0]);
+    }
+
     virtual int32_t getChildIndex(KeyType key, int32_t keyIndex) const {
         return keyIndex;
     }
@@ -310,7 +884,7 @@ public:
 private:
     LeafNode *m_LeftSibling;
     LeafNode *m_RightSibling;
-    DataType m_Datas[MAXNUM_LEAF];
+    DataType m_Datas[Capacity::MAXNUM_LEAF];
 };
 
 // 比较操作符：<、<=、=、>=、>、<>
@@ -318,17 +892,57 @@ enum COMPARE_OPERATOR {
     LT, LE, EQ, BE, BT, BETWEEN
 };
 
-const int32_t INVALID_INDEX = -1;
-
-template<typename KeyType, typename DataType>
+template<typename KeyType, typename DataType, int32_t Order = ORDER>
 struct SelectResult {
     int32_t keyIndex;
-    LeafNode<KeyType, DataType> *targetNode;
+    LeafNode<KeyType, DataType, Order> *targetNode;
 };
 
-template<typename KeyType, typename DataType>
+// B+树内存统计，可汇总多棵树
+struct TreeStats {
+    int64_t trees = 0;              // 树的个数
+    int64_t internalNodes = 0;      // 内结点个数
+    int64_t leafNodes = 0;          // 叶子结点个数
+    int64_t internalKeys = 0;       // 内结点中的键值个数
+    int64_t leafKeys = 0;           // 叶子结点中的键值个数
+    int64_t internalSlots = 0;      // 内结点的键值容量之和（各树的阶可以不同）
+    int64_t leafSlots = 0;          // 叶子结点的键值容量之和
+    int32_t height = 0;             // 树高（汇总时为最大值）
+    int64_t nodeBytes = 0;          // 结点对象字节数
+    int64_t allocatedBytes = 0;     // 分配器实际占用字节数（含块头与对齐）
+
+    // 叶子结点填充率
+    double LeafFill() const {
+        return this->leafNodes > 0 ? (double) this->leafKeys / (double) this->leafSlots : 0.0;
+    }
+
+    // 内结点填充率
+    double InternalFill() const {
+        return this->internalNodes > 0 ? (double) this->internalKeys / (double) this->internalSlots : 0.0;
+    }
+
+    // 汇总另一棵树的统计；sign 为 -1 时撤销（树高无法撤销，由调用方另行维护）
+    void Merge(const TreeStats &other, int32_t sign = 1) {
+        this->trees += sign * other.trees;
+        this->internalNodes += sign * other.internalNodes;
+        this->leafNodes += sign * other.leafNodes;
+        this->internalKeys += sign * other.internalKeys;
+        this->leafKeys += sign * other.leafKeys;
+        this->internalSlots += sign * other.internalSlots;
+        this->leafSlots += sign * other.leafSlots;
+        if (sign > 0) {
+            this->height = std::max(this->height, other.height);
+        }
+        this->nodeBytes += sign * other.nodeBytes;
+        this->allocatedBytes += sign * other.allocatedBytes;
+    }
+};
+
+template<typename KeyType, typename DataType, int32_t Order = ORDER>
 class BPlusTree {
 public:
+    using Capacity = NodeCapacity<Order>;
+
     BPlusTree() {
         m_Root = nullptr;
         m_DataHead = nullptr;
@@ -339,184 +953,305 @@ public:
     }
 
     bool insert(KeyType key, const DataType &data) {
-        // 找到可以插入的叶子结点，否则创建新的叶子结点
-        if (m_Root == nullptr) {
-            m_Root = new LeafNode<KeyType, DataType>();
-            m_DataHead = (LeafNode<KeyType, DataType> *) m_Root;
-            m_MaxKey = key;
-        }
+        emplace(key, data);
+        return true;
+    }
 
-        if (m_Root->getKeyNum() >= MAXNUM_KEY) // 根结点已满，分裂
-        {
-            InternalNode<KeyType> *newNode = new InternalNode<KeyType>();  //创建新的根节点
-            newNode->setChild(0, m_Root);
-            m_Root->split(newNode, 0);    // 叶子结点分裂
-            m_Root = newNode;  //更新根节点指针
-        }
+    bool insert(KeyType key, DataType &&data) {
+        emplace(key, std::move(data));
+        return true;
+    }
 
-        if (key > m_MaxKey)  // 更新最大键值
-        {
-            m_MaxKey = key;
-        }
+    // 插入键值，数据先由 args 构造为局部对象，再移动赋值到叶子结点的空位；返回新数据的引用（在下一次插入或删除前有效）
+    // args 可能引用树中的数据（如 emplace(k2, *find(k1))），下降途中的分裂与叶子内的移位会移走它：先复制再移动
+    template<typename... Args>
+    DataType &emplace(KeyType key, Args &&... args) {
+        DataType value(std::forward<Args>(args)...);
+        return *insertValue(key, value, false);
+    }
 
-        recursive_insert(m_Root, key, data);
-        return true;
+    // 键值不存在时插入并返回新数据的指针；已存在时不插入、返回 nullptr（下降途中的预先分裂保留，不影响树的正确性）
+    template<typename... Args>
+    DataType *tryEmplace(KeyType key, Args &&... args) {
+        DataType value(std::forward<Args>(args)...);
+        return insertValue(key, value, true);
     }
 
     bool remove(KeyType key) {
-        if (!search(key))  //不存在
-        {
+        return erase(key);
+    }
+
+    // 删除键值：一次自顶向下遍历，沿途预先调整达到下限的结点，removed 非空时返回被删除的数据
+    bool erase(KeyType key, DataType *removed = nullptr) {
+        if (m_Root == nullptr) {
             return false;
         }
 
         if (m_Root->getKeyNum() == 1)//特殊情况处理
         {
             if (m_Root->getType() == LEAF) {
+                if (m_Root->getKeyValue(0) != key) {
+                    return false;
+                }
+                if (removed != nullptr) {
+                    *removed = std::move(((LeafNode<KeyType, DataType, Order> *) m_Root)->getData(0));
+                }
                 clear();
                 return true;
-            } else {
-                BaseNode<KeyType> *pChild1 = ((InternalNode<KeyType> *) m_Root)->getChild(0);
-                BaseNode<KeyType> *pChild2 = ((InternalNode<KeyType> *) m_Root)->getChild(1);
-                if (pChild1->getKeyNum() == MINNUM_KEY && pChild2->getKeyNum() == MINNUM_KEY) {
-                    pChild1->mergeChild(m_Root, pChild2, 0);
-                    delete m_Root;
-                    m_Root = pChild1;
-                }
             }
         }
 
-        recursive_remove(m_Root, key);
+        ErasePath path;
+        LeafNode<KeyType, DataType, Order> *pLeaf = eraseDescend(key, path);
+        int32_t keyIndex = pLeaf->getKeyIndex(key);
+        if (keyIndex >= pLeaf->getKeyNum() || pLeaf->getKeyValue(keyIndex) != key) {
+            return false;
+        }
+        eraseAt(pLeaf, keyIndex, path, removed);
         return true;
     }
 
+    // 批量删除：keys 须升序，一次遍历删除所有键值，每个受影响的结点只在其孩子处理完后调整一次，返回删除个数
+    int32_t eraseSorted(std::span<const KeyType> keys) {
+        if (m_Root == nullptr || keys.empty()) {
+            return 0;
+        }
+        int32_t removedNum = recursive_erase_sorted(m_Root, keys.data(), keys.data() + keys.size());
+        if (removedNum == 0) {
+            return 0;
+        }
+        m_KeyNum -= removedNum;
+
+        // 根结点只剩一个孩子时降低树高
+        while (m_Root->getType() != LEAF && m_Root->getKeyNum() == 0) {
+            BaseNode<KeyType, Order> *pOldRoot = m_Root;
+            m_Root = ((InternalNode<KeyType, Order> *) m_Root)->getChild(0);
+            countNode(pOldRoot, -1);
+            delete pOldRoot;
+        }
+        if (m_Root->getKeyNum() == 0) {
+            clear();
+        }
+        return removedNum;
+    }
+
+    // 修改键值，数据不变；新键值已存在或旧键值不存在时返回 false
     bool update(KeyType oldKey, KeyType newKey) {
-        if (search(newKey)) // 检查更新后的键是否已经存在
-        {
+        if (m_Root == nullptr || oldKey == newKey) {
             return false;
-        } else {
-            int32_t dataValue;
-            remove(oldKey, dataValue);
-            if (dataValue == INVALID_INDEX) {
+        }
+
+        // 1.按删除的方式下降到旧键值所在叶子结点（沿途预先调整），同时记录叶子结点的键值范围 [lower, upper)
+        ErasePath path;
+        LeafNode<KeyType, DataType, Order> *pLeaf = eraseDescend(oldKey, path);
+        int32_t oldIndex = pLeaf->getKeyIndex(oldKey);
+        if (oldIndex >= pLeaf->getKeyNum() || pLeaf->getKeyValue(oldIndex) != oldKey) {
+            return false;
+        }
+
+        // 2.新键值仍落在同一叶子结点：在结点内移动
+        if ((!path.hasLower || newKey >= path.lower) && (!path.hasUpper || newKey < path.upper)) {
+            int32_t newIndex = pLeaf->getKeyIndex(newKey);
+            if (newIndex < pLeaf->getKeyNum() && pLeaf->getKeyValue(newIndex) == newKey) {
                 return false;
-            } else {
-                return insert(newKey, dataValue);
             }
+            pLeaf->moveKey(oldIndex, newKey);
+            if (path.pHolder != nullptr) {
+                path.pHolder->setKeyValue(path.holderIndex, pLeaf->getKeyValue(0));
+            }
+            return true;
+        }
+
+        // 3.跨叶子结点：就地删除旧键值（结点已预先调整，不会低于下限），再一次下降插入新键值；
+        //   新键值已存在时以旧键值插回（仅失败时多一次下降）
+        DataType data;
+        eraseAt(pLeaf, oldIndex, path, &data);
+        if (insertValue(newKey, data, true) != nullptr) {
+            return true;
         }
+        insertValue(oldKey, data, false);
+        return false;
     }
 
     // 定值查询，compareOperator可以是LT(<)、LE(<=)、EQ(=)、BE(>=)、BT(>)
     std::vector<DataType> select(KeyType compareKey, COMPARE_OPERATOR compareOpeartor) {
+        INSTRUMENT_SCOPE(OP_SELECT);
         std::vector<DataType> results;
-        if (m_Root != nullptr) {
-            if (compareKey > m_MaxKey) {   // 比较键值大于B+树中最大的键值
-                if (compareOpeartor == LE || compareOpeartor == LT) {
-                    for (LeafNode<KeyType, DataType> *itr = m_DataHead; itr != nullptr; itr = itr->getRightSibling()) {
-                        for (int32_t i = 0; i < itr->getKeyNum(); ++i) {
-                            results.push_back(itr->getData(i));
-                        }
-                    }
-                }
-            } else if (compareKey < m_DataHead->getKeyValue(0)) {   // 比较键值小于B+树中最小的键值
-                if (compareOpeartor == BE || compareOpeartor == BT) {
-                    for (LeafNode<KeyType, DataType> *itr = m_DataHead; itr != nullptr; itr = itr->getRightSibling()) {
-                        for (int32_t i = 0; i < itr->getKeyNum(); ++i) {
-                            results.push_back(itr->getData(i));
+        if (m_Root == nullptr) {
+            return results;
+        }
+        switch (compareOpeartor) {
+            case LT:
+            case LE: {
+                scanLeaves(m_Root, nullptr, &compareKey, [&](LeafNode<KeyType, DataType, Order> *pLeaf) {
+                    for (int32_t i = 0; i < pLeaf->getKeyNum(); ++i) {
+                        KeyType key = pLeaf->getKeyValue(i);
+                        if (key > compareKey || (compareOpeartor == LT && key == compareKey)) {
+                            return false;
                         }
+                        results.push_back(pLeaf->getData(i));
                     }
+                    return true;
+                });
+            }
+                break;
+            case EQ: {
+                DataType *data = find(compareKey);
+                if (data != nullptr) {
+                    results.push_back(*data);
                 }
-            } else {  // 比较键值在B+树中
-                SelectResult<KeyType, DataType> result;
-                search(compareKey, result);
-                switch (compareOpeartor) {
-                    case LT:
-                    case LE: {
-                        LeafNode<KeyType, DataType> *itr = m_DataHead;
-                        int32_t i;
-                        while (itr != result.targetNode) {
-                            for (i = 0; i < itr->getKeyNum(); ++i) {
-                                results.push_back(itr->getData(i));
-                            }
-                            itr = itr->getRightSibling();
-                        }
-                        for (i = 0; i < result.keyIndex; ++i) {
-                            results.push_back(itr->getData(i));
-                        }
-                        if (itr->getKeyValue(i) < compareKey ||
-                            (compareOpeartor == LE && compareKey == itr->getKeyValue(i))) {
-                            results.push_back(itr->getData(i));
-                        }
-                    }
-                        break;
-                    case EQ: {
-                        if (result.targetNode->getKeyValue(result.keyIndex) == compareKey) {
-                            results.push_back(result.targetNode->getData(result.keyIndex));
-                        }
-                    }
-                        break;
-                    case BE:
-                    case BT: {
-                        LeafNode<KeyType, DataType> *itr = result.targetNode;
-                        if (compareKey < itr->getKeyValue(result.keyIndex) ||
-                            (compareOpeartor == BE && compareKey == itr->getKeyValue(result.keyIndex))
-                                ) {
-                            results.push_back(itr->getData(result.keyIndex));
-                        }
-                        int32_t i;
-                        for (i = result.keyIndex + 1; i < itr->getKeyNum(); ++i) {
-                            results.push_back(itr->getData(i));
-                        }
-                        itr = itr->getRightSibling();
-                        while (itr != nullptr) {
-                            for (i = 0; i < itr->getKeyNum(); ++i) {
-                                results.push_back(itr->getData(i));
-                            }
-                            itr = itr->getRightSibling();
+            }
+                break;
+            case BE:
+            case BT: {
+                scanLeaves(m_Root, &compareKey, nullptr, [&](LeafNode<KeyType, DataType, Order> *pLeaf) {
+                    for (int32_t i = 0; i < pLeaf->getKeyNum(); ++i) {
+                        KeyType key = pLeaf->getKeyValue(i);
+                        if (key > compareKey || (compareOpeartor == BE && key == compareKey)) {
+                            results.push_back(pLeaf->getData(i));
                         }
                     }
-                        break;
-                    default:  // 范围查询
-                        break;
-                }
+                    return true;
+                });
             }
+                break;
+            default:  // 范围查询
+                break;
         }
-
         return results;
     }
 
-    // 范围查询，BETWEEN
-    void select(KeyType smallKey, KeyType largeKey, std::vector<DataType>& Result) {
-        std::vector<DataType> results;
-        if (smallKey <= largeKey) {
-            SelectResult<KeyType, DataType> start, end;
-            search(smallKey, start);
-            search(largeKey, end);
-            LeafNode<KeyType, DataType> *itr = start.targetNode;
-            int32_t i = start.keyIndex;
-            if (itr->getKeyValue(i) < smallKey) {
-                ++i;
+    // 范围查询，BETWEEN：结果追加到 results
+    void select(KeyType smallKey, KeyType largeKey, std::vector<DataType>& results) {
+        INSTRUMENT_SCOPE(OP_SELECT);
+        forEach(smallKey, largeKey, [&](KeyType, const DataType &data) {
+            results.push_back(data);
+        });
+    }
+
+    // 查找是否存在
+    bool search(KeyType key) {
+        if (m_Root == nullptr) {
+            return false;
+        }
+        LeafNode<KeyType, DataType, Order> *pLeaf = findLeaf(key);
+        int32_t keyIndex = pLeaf->countLess(key);
+        return keyIndex < pLeaf->getKeyNum() && key == pLeaf->getKeyValue(keyIndex);
+    }
+
+    // 按键值升序访问每个键值对
+    template<typename Visitor>
+    void forEach(Visitor &&visit) {
+        if (m_Root != nullptr) {
+            scanLeaves(m_Root, nullptr, nullptr, [&](LeafNode<KeyType, DataType, Order> *pLeaf) {
+                for (int32_t i = 0; i < pLeaf->getKeyNum(); ++i) {
+                    visit(pLeaf->getKeyValue(i), pLeaf->getData(i));
+                }
+                return true;
+            });
+        }
+    }
+
+    template<typename Visitor>
+    void forEach(Visitor &&visit) const {
+        if (m_Root != nullptr) {
+            scanLeaves(m_Root, nullptr, nullptr, [&](const LeafNode<KeyType, DataType, Order> *pLeaf) {
+                for (int32_t i = 0; i < pLeaf->getKeyNum(); ++i) {
+                    visit(pLeaf->getKeyValue(i), pLeaf->getData(i));
+                }
+                return true;
+            });
+        }
+    }
+
+    // 按键值升序访问 [smallKey, largeKey] 中的键值对：数据以引用传给 visit，不复制
+    template<typename Visitor>
+    void forEach(KeyType smallKey, KeyType largeKey, Visitor &&visit) {
+        if (m_Root == nullptr || smallKey > largeKey) {
+            return;
+        }
+        scanLeaves(m_Root, &smallKey, &largeKey, [&](LeafNode<KeyType, DataType, Order> *pLeaf) {
+            for (int32_t i = pLeaf->countLess(smallKey); i < pLeaf->getKeyNum(); ++i) {
+                if (pLeaf->getKeyValue(i) > largeKey) {
+                    return false;
+                }
+                visit(pLeaf->getKeyValue(i), pLeaf->getData(i));
             }
+            return true;
+        });
+    }
 
-            if (end.targetNode->getKeyValue(end.keyIndex) > largeKey) {
-                --end.keyIndex;
+    // 内存统计：结点个数、键值个数与分配字节数随分配、释放维护，只沿最左路径求树高，代价与树高成正比
+    TreeStats stats() const {
+        TreeStats result;
+        result.trees = 1;
+        if (m_Root == nullptr) {
+            return result;
+        }
+        for (const BaseNode<KeyType, Order> *pNode = m_Root; ; pNode = ((const InternalNode<KeyType, Order> *) pNode)->getChild(0)) {
+            result.height++;
+            if (pNode->getType() == LEAF) {
+                break;
             }
+        }
+        result.leafNodes = m_LeafNum;
+        result.internalNodes = m_InternalNum;
+        result.leafKeys = m_KeyNum;
+        result.internalKeys = m_LeafNum - 1;   // 除根外每个结点恰为一个内结点的孩子：键值数 = 孩子数 - 内结点数
+        result.leafSlots = m_LeafNum * Capacity::MAXNUM_LEAF;
+        result.internalSlots = m_InternalNum * Capacity::MAXNUM_KEY;
+        result.nodeBytes = m_LeafNum * (int64_t) sizeof(LeafNode<KeyType, DataType, Order>) +
+                           m_InternalNum * (int64_t) sizeof(InternalNode<KeyType, Order>);
+        result.allocatedBytes = m_AllocatedBytes;
+        return result;
+    }
+
+    // 查找键值对应的数据，返回指向叶子结点中数据的指针，不存在时返回 nullptr
+    // 注：指针在下一次插入或删除前有效
+    DataType *find(KeyType key) {
+        if (m_Root == nullptr) {
+            return nullptr;
+        }
+        SelectResult<KeyType, DataType, Order> result;
+        search(key, result);
+        if (result.keyIndex < result.targetNode->getKeyNum() && result.targetNode->getKeyValue(result.keyIndex) == key) {
+            return &result.targetNode->getData(result.keyIndex);
+        }
+        return nullptr;
+    }
 
-            while (itr != end.targetNode) {
-                for (; i < itr->getKeyNum(); ++i) {
-                    results.push_back(itr->getData(i));
+    // 批量查找：results[i] 为 keys[i] 对应数据的指针，不存在时为 nullptr（指针在下一次插入或删除前有效）
+    // 每 MULTI_FIND_GROUP 个键值一组同步下降：每层先为组内全部键值选出孩子并预取，再进入下一层，
+    // 各次下降的缓存未命中相互重叠，而不是逐个等待
+    void multiFind(const KeyType *keys, int32_t n, DataType **results) {
+        INSTRUMENT_SCOPE(OP_MULTI_FIND);
+        if (m_Root == nullptr) {
+            std::fill(results, results + n, nullptr);
+            return;
+        }
+        BaseNode<KeyType, Order> *nodes[MULTI_FIND_GROUP];
+        for (int32_t base = 0; base < n; base += MULTI_FIND_GROUP) {
+            int32_t groupNum = std::min(MULTI_FIND_GROUP, n - base);
+            const KeyType *group = keys + base;
+            std::fill(nodes, nodes + groupNum, m_Root);
+            // 叶子结点都在同一层，组内结点同时到达叶子
+            while (nodes[0]->getType() != LEAF) {
+                for (int32_t i = 0; i < groupNum; ++i) {
+                    nodes[i] = ((const InternalNode<KeyType, Order> *) nodes[i])->descend(group[i]);
                 }
-                itr = itr->getRightSibling();
-                i = 0;
             }
-
-            for (; i <= end.keyIndex; ++i) {
-                results.push_back(itr->getData(i));
+            for (int32_t i = 0; i < groupNum; ++i) {
+                LeafNode<KeyType, DataType, Order> *pLeaf = (LeafNode<KeyType, DataType, Order> *) nodes[i];
+                int32_t keyIndex = pLeaf->countLess(group[i]);
+                results[base + i] = keyIndex < pLeaf->getKeyNum() && pLeaf->getKeyValue(keyIndex) == group[i] ?
+                                    &pLeaf->getData(keyIndex) : nullptr;
             }
         }
     }
 
-    // 查找是否存在
-    bool search(KeyType key) {
-        return recursive_search(m_Root, key);
+    void multiFind(const std::vector<KeyType> &keys, std::vector<DataType *> &results) {
+        results.resize(keys.size());
+        multiFind(keys.data(), (int32_t) keys.size(), results.data());
     }
 
     // 清空
@@ -527,6 +1262,10 @@ public:
             m_Root = nullptr;
             m_DataHead = nullptr;
         }
+        m_KeyNum = 0;
+        m_LeafNum = 0;
+        m_InternalNum = 0;
+        m_AllocatedBytes = 0;
     }
 
     // 打印树关键字
@@ -536,7 +1275,7 @@ public:
 
     // 打印数据
     void printData() const {
-        LeafNode<KeyType, DataType> *itr = m_DataHead;
+        LeafNode<KeyType, DataType, Order> *itr = m_DataHead;
 
         while (itr != nullptr) {
             for (int32_t i = 0; i < itr->getKeyNum(); ++i) {
@@ -548,86 +1287,222 @@ public:
     }
 
 private:
-    void recursive_insert(BaseNode<KeyType> *parentNode, KeyType key, const DataType &data) {
+    // 插入键值，成功时从 value 移动数据并返回新数据的指针；unique 为 true 且键值已存在时返回 nullptr，value 不变
+    DataType *insertValue(KeyType key, DataType &value, bool unique) {
+        // 找到可以插入的叶子结点，否则创建新的叶子结点
+        if (m_Root == nullptr) {
+            m_Root = new LeafNode<KeyType, DataType, Order>();
+            m_DataHead = (LeafNode<KeyType, DataType, Order> *) m_Root;
+            countNode(m_Root, 1);
+        }
+
+        if (m_Root->getKeyNum() >= Capacity::MAXNUM_KEY) // 根结点已满，分裂
+        {
+            InternalNode<KeyType, Order> *newNode = new InternalNode<KeyType, Order>();  //创建新的根节点
+            newNode->setChild(0, m_Root);
+            m_Root->split(newNode, 0);    // 叶子结点分裂
+            INSTRUMENT_EVENT(EVENT_SPLIT);
+            m_Root = newNode;  //更新根节点指针
+            countNode(newNode, 1);
+            countNode(newNode->getChild(1), 1);
+        }
+
+        DataType *data = recursive_insert(m_Root, key, value, unique);
+        m_KeyNum += data != nullptr;
+        return data;
+    }
+
+    // 删除路径：键值作为分隔键出现的内结点（删除后直接替换，无需再次查找），以及叶子结点的键值范围 [lower, upper)
+    struct ErasePath {
+        BaseNode<KeyType, Order> *pHolder = nullptr;
+        int32_t holderIndex = 0;
+        bool hasLower = false, hasUpper = false;
+        KeyType lower = KeyType(), upper = KeyType();
+    };
+
+    // 删除前的一次自顶向下遍历：根结点的两个孩子都达到下限时先合并，沿途预先调整达到下限的结点，返回 key 应在的叶子结点
+    // 根结点不能是只有一个键值的叶子结点（由调用方处理）
+    LeafNode<KeyType, DataType, Order> *eraseDescend(KeyType key, ErasePath &path) {
+        if (m_Root->getType() != LEAF && m_Root->getKeyNum() == 1) {
+            BaseNode<KeyType, Order> *pChild1 = ((InternalNode<KeyType, Order> *) m_Root)->getChild(0);
+            BaseNode<KeyType, Order> *pChild2 = ((InternalNode<KeyType, Order> *) m_Root)->getChild(1);
+            if (pChild1->getKeyNum() == Capacity::MINNUM_KEY && pChild2->getKeyNum() == Capacity::MINNUM_KEY) {
+                countNode(pChild2, -1);
+                pChild1->mergeChild(m_Root, pChild2, 0);
+                countNode(m_Root, -1);
+                delete m_Root;
+                m_Root = pChild1;
+            }
+        }
+
+        BaseNode<KeyType, Order> *pNode = m_Root;
+        while (pNode->getType() != LEAF) {
+            int32_t keyIndex = pNode->getKeyIndex(key);
+            BaseNode<KeyType, Order> *pChildNode = rebalanceChild(pNode, pNode->getChildIndex(key, keyIndex));
+            keyIndex = pNode->getKeyIndex(key);     // 调整可能改变了本结点的键值
+            int32_t childIndex = pNode->getChildIndex(key, keyIndex);
+            if (childIndex > 0) {
+                path.hasLower = true;
+                path.lower = pNode->getKeyValue(childIndex - 1);
+                if (path.lower == key) {
+                    path.pHolder = pNode;
+                    path.holderIndex = childIndex - 1;
+                }
+            }
+            if (childIndex < pNode->getKeyNum()) {
+                path.hasUpper = true;
+                path.upper = pNode->getKeyValue(childIndex);
+            }
+            pNode = pChildNode;
+        }
+        return (LeafNode<KeyType, DataType, Order> *) pNode;
+    }
+
+    // 从 eraseDescend 返回的叶子结点中删除下标 keyIndex 处的键值，removed 非空时返回被删除的数据
+    void eraseAt(LeafNode<KeyType, DataType, Order> *pLeaf, int32_t keyIndex, const ErasePath &path, DataType *removed) {
+        if (removed != nullptr) {
+            *removed = std::move(pLeaf->getData(keyIndex));
+        }
+        pLeaf->removeKey(keyIndex, keyIndex);  // 直接删除
+        m_KeyNum--;
+
+        // 键值同时是内结点中的分隔键，替换为叶子结点新的最小键值
+        if (path.pHolder != nullptr) {
+            path.pHolder->setKeyValue(path.holderIndex, pLeaf->getKeyValue(0));
+        }
+    }
+
+    DataType *recursive_insert(BaseNode<KeyType, Order> *parentNode, KeyType key, DataType &data, bool unique) {
         // 叶子结点，直接插入
         if (parentNode->getType() == LEAF) {
-            ((LeafNode<KeyType, DataType> *) parentNode)->insert(key, data);
+            LeafNode<KeyType, DataType, Order> *pLeaf = (LeafNode<KeyType, DataType, Order> *) parentNode;
+            if (unique) {
+                int32_t keyIndex = pLeaf->countNotGreater(key);
+                if (keyIndex > 0 && pLeaf->getKeyValue(keyIndex - 1) == key) {
+                    return nullptr;
+                }
+            }
+            return &pLeaf->emplace(key, std::move(data));
         } else {
             // 找到子结点
-            int32_t keyIndex = parentNode->getKeyIndex(key);
-            int32_t childIndex = parentNode->getChildIndex(key, keyIndex); // 孩子结点指针索引
-            BaseNode<KeyType> *childNode = ((InternalNode<KeyType> *) parentNode)->getChild(childIndex);
+            int32_t childIndex = parentNode->countNotGreater(key); // 孩子结点指针索引
+            BaseNode<KeyType, Order> *childNode = ((InternalNode<KeyType, Order> *) parentNode)->getChild(childIndex);
+            PrefetchObject(childNode, sizeof(InternalNode<KeyType, Order>));
 
             // 子结点已满，需进行分裂
-            if (childNode->getKeyNum() >= MAXNUM_LEAF) {
+            if (childNode->getKeyNum() >= Capacity::MAXNUM_LEAF) {
                 childNode->split(parentNode, childIndex);
+                countNode(((InternalNode<KeyType, Order> *) parentNode)->getChild(childIndex + 1), 1);
+                INSTRUMENT_EVENT(EVENT_SPLIT);
 
                 // 确定目标子结点
                 if (parentNode->getKeyValue(childIndex) <= key) {
-                    childNode = ((InternalNode<KeyType> *) parentNode)->getChild(childIndex + 1);
+                    childNode = ((InternalNode<KeyType, Order> *) parentNode)->getChild(childIndex + 1);
                 }
             }
-            recursive_insert(childNode, key, data);
+            return recursive_insert(childNode, key, data, unique);
         }
     }
 
-    void recursive_remove(BaseNode<KeyType> *parentNode, KeyType key) {
-        int32_t keyIndex = parentNode->getKeyIndex(key);
-        int32_t childIndex = parentNode->getChildIndex(key, keyIndex); // 孩子结点指针索引
+    int32_t recursive_erase_sorted(BaseNode<KeyType, Order> *pNode, const KeyType *first, const KeyType *last) {
+        if (pNode->getType() == LEAF) {
+            return ((LeafNode<KeyType, DataType, Order> *) pNode)->removeKeys(first, last);
+        }
 
-        // 找到目标叶子节点
-        if (parentNode->getType() == LEAF) {
-            if (key == m_MaxKey && keyIndex > 0) {
-                m_MaxKey = parentNode->getKeyValue(keyIndex - 1);
+        // 按分隔键将待删除键值划分到各个孩子
+        InternalNode<KeyType, Order> *pInternal = (InternalNode<KeyType, Order> *) pNode;
+        int32_t removedNum = 0;
+        for (int32_t i = 0; i <= pInternal->getKeyNum() && first != last; ++i) {
+            const KeyType *end = i < pInternal->getKeyNum() ? std::lower_bound(first, last, pInternal->getKeyValue(i)) : last;
+            if (first != end) {
+                removedNum += recursive_erase_sorted(pInternal->getChild(i), first, end);
             }
+            first = end;
+        }
+        if (removedNum > 0) {
+            fixUnderflow(pInternal);
+        }
+        return removedNum;
+    }
 
-            parentNode->removeKey(keyIndex, childIndex);  // 直接删除
-
-            // 如果键值在内部结点中存在，也要相应的替换内部结点
-            if (childIndex == 0 && m_Root->getType() != LEAF && parentNode != m_DataHead) {
-                changeKey(m_Root, key, parentNode->getKeyValue(0));
+    // 批量删除后调整：键值个数低于下限的孩子与相邻兄弟合并，合并后超出上限时改为平分
+    void fixUnderflow(InternalNode<KeyType, Order> *pNode) {
+        int32_t i = 0;
+        while (i <= pNode->getKeyNum() && pNode->getKeyNum() > 0) {
+            if (pNode->getChild(i)->getKeyNum() >= Capacity::MINNUM_KEY) {
+                ++i;
+                continue;
+            }
+            int32_t keyIndex = i > 0 ? i - 1 : 0;
+            BaseNode<KeyType, Order> *pLeft = pNode->getChild(keyIndex);
+            BaseNode<KeyType, Order> *pRight = pNode->getChild(keyIndex + 1);
+            int32_t total = pLeft->getKeyNum() + pRight->getKeyNum() + (pLeft->getType() == LEAF ? 0 : 1);
+            if (total <= Capacity::MAXNUM_KEY) {
+                countNode(pRight, -1);
+                pLeft->mergeChild(pNode, pRight, keyIndex);
+                INSTRUMENT_EVENT(EVENT_MERGE);
+            } else {
+                pLeft->redistribute(pRight, pNode, keyIndex);
+                INSTRUMENT_EVENT(EVENT_REDISTRIBUTE);
             }
-        } else {
-            // 内结点
-            BaseNode<KeyType> *pChildNode = ((InternalNode<KeyType> *) parentNode)->getChild(childIndex); //包含key的子树根节点
-
-            // 包含关键字达到下限值，进行相关操作
-            if (pChildNode->getKeyNum() == MINNUM_KEY) {
-                // 左兄弟节点
-                BaseNode<KeyType> *pLeft = childIndex > 0 ? ((InternalNode<KeyType> *) parentNode)->getChild(childIndex - 1)
-                                                          : nullptr;
-
-                // 右兄弟节点
-                BaseNode<KeyType> *pRight =
-                        childIndex < parentNode->getKeyNum() ? ((InternalNode<KeyType> *) parentNode)->getChild(childIndex + 1)
-                                                             : nullptr;
 
-                // 先考虑从兄弟结点中借
-                if (pLeft && pLeft->getKeyNum() > MINNUM_KEY) {
-                    // 左兄弟结点可借
-                    pChildNode->borrowFrom(pLeft, parentNode, childIndex - 1, LEFT);
-                } else if (pRight && pRight->getKeyNum() > MINNUM_KEY) {
-                    //右兄弟结点可借
-                    pChildNode->borrowFrom(pRight, parentNode, childIndex, RIGHT);
-                } else if (pLeft) {   //左右兄弟节点都不可借，考虑合并
-                    // 与左兄弟合并
-                    pLeft->mergeChild(parentNode, pChildNode, childIndex - 1);
-                    pChildNode = pLeft;
-                } else if (pRight) {
-                    //与右兄弟合并
-                    pChildNode->mergeChild(parentNode, pRight, childIndex);
+            // 只有一个孩子的内结点无法调整其孩子，合并或平分后在拼接处需再调整一次
+            if (pLeft->getType() != LEAF) {
+                fixUnderflow((InternalNode<KeyType, Order> *) pLeft);
+                if (total > Capacity::MAXNUM_KEY) {
+                    fixUnderflow((InternalNode<KeyType, Order> *) pRight);
                 }
             }
-            recursive_remove(pChildNode, key);
+            i = keyIndex;
+        }
+    }
+
+    // 删除前调整：孩子结点键值个数达到下限时，先向兄弟结点借或与兄弟结点合并，返回调整后包含键值的孩子结点
+    BaseNode<KeyType, Order> *rebalanceChild(BaseNode<KeyType, Order> *parentNode, int32_t childIndex) {
+        BaseNode<KeyType, Order> *pChildNode = ((InternalNode<KeyType, Order> *) parentNode)->getChild(childIndex);
+        if (pChildNode->getKeyNum() > Capacity::MINNUM_KEY) {
+            return pChildNode;
+        }
+
+        // 左兄弟节点
+        BaseNode<KeyType, Order> *pLeft = childIndex > 0 ? ((InternalNode<KeyType, Order> *) parentNode)->getChild(childIndex - 1)
+                                                  : nullptr;
+
+        // 右兄弟节点
+        BaseNode<KeyType, Order> *pRight =
+                childIndex < parentNode->getKeyNum() ? ((InternalNode<KeyType, Order> *) parentNode)->getChild(childIndex + 1)
+                                                     : nullptr;
+
+        // 先考虑从兄弟结点中借
+        if (pLeft && pLeft->getKeyNum() > Capacity::MINNUM_KEY) {
+            // 左兄弟结点可借
+            pChildNode->borrowFrom(pLeft, parentNode, childIndex - 1, LEFT);
+            INSTRUMENT_EVENT(EVENT_BORROW);
+        } else if (pRight && pRight->getKeyNum() > Capacity::MINNUM_KEY) {
+            //右兄弟结点可借
+            pChildNode->borrowFrom(pRight, parentNode, childIndex, RIGHT);
+            INSTRUMENT_EVENT(EVENT_BORROW);
+        } else if (pLeft) {   //左右兄弟节点都不可借，考虑合并
+            // 与左兄弟合并
+            countNode(pChildNode, -1);
+            pLeft->mergeChild(parentNode, pChildNode, childIndex - 1);
+            INSTRUMENT_EVENT(EVENT_MERGE);
+            pChildNode = pLeft;
+        } else if (pRight) {
+            //与右兄弟合并
+            countNode(pRight, -1);
+            pChildNode->mergeChild(parentNode, pRight, childIndex);
+            INSTRUMENT_EVENT(EVENT_MERGE);
         }
+        return pChildNode;
     }
 
-    void printInConcavo(BaseNode<KeyType> *pNode, int32_t count) const {
+    void printInConcavo(BaseNode<KeyType, Order> *pNode, int32_t count) const {
         if (pNode != nullptr) {
             int32_t i, j;
             for (i = 0; i < pNode->getKeyNum(); ++i) {
                 if (pNode->getType() != LEAF) {
-                    printInConcavo(((InternalNode<KeyType> *) pNode)->getChild(i), count - 2);
+                    printInConcavo(((InternalNode<KeyType, Order> *) pNode)->getChild(i), count - 2);
                 }
                 for (j = count; j >= 0; --j) {
                     std::cout << "-";
@@ -635,678 +1510,3724 @@ private:
                 std::cout << pNode->getKeyValue(i) << std::endl;
             }
             if (pNode->getType() != LEAF) {
-                printInConcavo(((InternalNode<KeyType> *) pNode)->getChild(i), count - 2);
+                printInConcavo(((InternalNode<KeyType, Order> *) pNode)->getChild(i), count - 2);
             }
         }
     }
 
-    bool recursive_search(BaseNode<KeyType> *pNode, KeyType key) const {
-        // 检测节点指针是否为空，或该节点是否为叶子节点
-        if (pNode == nullptr) {
-            return false;
-        } else {
-            int32_t keyIndex = pNode->getKeyIndex(key);
-            // 孩子结点指针索引
-            int32_t childIndex = pNode->getChildIndex(key, keyIndex);
-
-            if (keyIndex < pNode->getKeyNum() && key == pNode->getKeyValue(keyIndex)) {
-                return true;
-            } else {
-                // 检查该节点是否为叶子节点
-                if (pNode->getType() == LEAF) {
-                    return false;
-                } else {
-                    return recursive_search(((InternalNode<KeyType> *) pNode)->getChild(childIndex), key);
-                }
-            }
-        }
+    void search(KeyType key, SelectResult<KeyType, DataType, Order> &result) {
+        result.targetNode = findLeaf(key);
+        result.keyIndex = result.targetNode->getKeyIndex(key);
     }
 
-    void changeKey(BaseNode<KeyType> *pNode, KeyType oldKey, KeyType newKey) {
-        if (pNode != nullptr && pNode->getType() != LEAF) {
-            int32_t keyIndex = pNode->getKeyIndex(oldKey);
-            if (keyIndex < pNode->getKeyNum() && oldKey == pNode->getKeyValue(keyIndex))  // 找到
-            {
-                pNode->setKeyValue(keyIndex, newKey);
-            } else {  // 继续找
-                changeKey(((InternalNode<KeyType> *) pNode)->getChild(keyIndex), oldKey, newKey);
-            }
+    // 自顶向下定位 key 所在的叶子结点，每层预取下一层结点
+    LeafNode<KeyType, DataType, Order> *findLeaf(KeyType key) const {
+        BaseNode<KeyType, Order> *pNode = m_Root;
+        while (pNode->getType() != LEAF) {
+            pNode = ((const InternalNode<KeyType, Order> *) pNode)->descend(key);
         }
+        return (LeafNode<KeyType, DataType, Order> *) pNode;
     }
 
-    void search(KeyType key, SelectResult<KeyType, DataType> &result) {
-        recursive_search(m_Root, key, result);
-    }
-
-    void recursive_search(BaseNode<KeyType> *pNode, KeyType key, SelectResult<KeyType, DataType> &result) {
-        int32_t keyIndex = pNode->getKeyIndex(key);
-        int32_t childIndex = pNode->getChildIndex(key, keyIndex); // 孩子结点指针索引
+    // 按键值顺序访问与 [*lo, *hi] 相交的叶子结点（lo、hi 为空表示不限），visit(leaf) 返回 false 时停止
+    // 不沿兄弟指针逐个前进，而是经由父结点：进入叶子的父结点时，一次预取其后全部在范围内的叶子，
+    // 使多个叶子的加载重叠，而不是每个叶子等待一次内存访问
+    template<typename Fn>
+    bool scanLeaves(BaseNode<KeyType, Order> *pNode, const KeyType *lo, const KeyType *hi, Fn &&visit) const {
         if (pNode->getType() == LEAF) {
-            result.keyIndex = keyIndex;
-            result.targetNode = (LeafNode<KeyType, DataType> *) pNode;
-            return;
-        } else {
-            return recursive_search(((InternalNode<KeyType> *) pNode)->getChild(childIndex), key, result);
-        }
-    }
-
-    void remove(KeyType key, DataType &dataValue) {
-        // 不存在
-        if (!search(key)) {
-            dataValue = INVALID_INDEX;
-            return;
+            return visit((LeafNode<KeyType, DataType, Order> *) pNode);
         }
-
-        // 特殊情况处理
-        if (m_Root->getKeyNum() == 1) {
-            if (m_Root->getType() == LEAF) {
-                dataValue = ((LeafNode<KeyType, DataType> *) m_Root)->getData(0);
-                clear();
-                return;
-            } else {
-                BaseNode<KeyType> *pChild1 = ((InternalNode<KeyType> *) m_Root)->getChild(0);
-                BaseNode<KeyType> *pChild2 = ((InternalNode<KeyType> *) m_Root)->getChild(1);
-                if (pChild1->getKeyNum() == MINNUM_KEY && pChild2->getKeyNum() == MINNUM_KEY) {
-                    pChild1->mergeChild(m_Root, pChild2, 0);
-                    delete m_Root;
-                    m_Root = pChild1;
+        InternalNode<KeyType, Order> *pInternal = (InternalNode<KeyType, Order> *) pNode;
+        int32_t first = lo != nullptr ? pInternal->countNotGreater(*lo) : 0;
+        int32_t last = hi != nullptr ? pInternal->countNotGreater(*hi) : pInternal->getKeyNum();
+        for (int32_t i = first; i <= last; ++i) {
+            BaseNode<KeyType, Order> *pChild = pInternal->getChild(i);
+            if (i == first && pChild->getType() == LEAF) {
+                for (int32_t j = first + 1; j <= last; ++j) {
+                    PrefetchObject(pInternal->getChild(j), std::min<size_t>(sizeof(LeafNode<KeyType, DataType, Order>), 4 * CACHE_LINE));
                 }
             }
+            if (!scanLeaves(pChild, i == first ? lo : nullptr, i == last ? hi : nullptr, visit)) {
+                return false;
+            }
         }
-
-        recursive_remove(m_Root, key, dataValue);
+        return true;
     }
 
-    void recursive_remove(BaseNode<KeyType> *parentNode, KeyType key, DataType &dataValue) {
-        int32_t keyIndex = parentNode->getKeyIndex(key);
-        int32_t childIndex = parentNode->getChildIndex(key, keyIndex); // 孩子结点指针索引
-
-        // 找到目标叶子节点
-        if (parentNode->getType() == LEAF) {
-            if (key == m_MaxKey && keyIndex > 0) {
-                m_MaxKey = parentNode->getKeyValue(keyIndex - 1);
-            }
-
-            dataValue = ((LeafNode<KeyType, DataType> *) parentNode)->getData(keyIndex);
-            parentNode->removeKey(keyIndex, childIndex);  // 直接删除
-
-            // 如果键值在内部结点中存在，也要相应的替换内部结点
-            if (childIndex == 0 && m_Root->getType() != LEAF && parentNode != m_DataHead) {
-                changeKey(m_Root, key, parentNode->getKeyValue(0));
-            }
+    // 结点分配（sign = 1）或释放前（sign = -1）更新结点个数与分配器实际占用字节数
+    void countNode(const BaseNode<KeyType, Order> *pNode, int32_t sign) {
+        if (pNode->getType() == LEAF) {
+            m_LeafNum += sign;
+            m_AllocatedBytes += sign * (int64_t) AllocatedSize(pNode, sizeof(LeafNode<KeyType, DataType, Order>));
         } else {
-            // 内结点
-            BaseNode<KeyType> *pChildNode = ((InternalNode<KeyType> *) parentNode)->getChild(childIndex); //包含key的子树根节点
-
-            // 包含关键字达到下限值，进行相关操作
-            if (pChildNode->getKeyNum() == MINNUM_KEY) {
-                BaseNode<KeyType> *pLeft = childIndex > 0 ? ((InternalNode<KeyType> *) parentNode)->getChild(childIndex - 1)
-                                                          : nullptr;                       //左兄弟节点
-                BaseNode<KeyType> *pRight =
-                        childIndex < parentNode->getKeyNum() ? ((InternalNode<KeyType> *) parentNode)->getChild(childIndex + 1)
-                                                             : nullptr;//右兄弟节点
-                // 先考虑从兄弟结点中借
-                if (pLeft && pLeft->getKeyNum() > MINNUM_KEY) {
-                    // 左兄弟结点可借
-                    pChildNode->borrowFrom(pLeft, parentNode, childIndex - 1, LEFT);
-                } else if (pRight && pRight->getKeyNum() > MINNUM_KEY) {
-                    //右兄弟结点可借
-                    pChildNode->borrowFrom(pRight, parentNode, childIndex, RIGHT);
-                } else if (pLeft) {
-                    //左右兄弟节点都不可借，考虑合并           //与左兄弟合并
-                    pLeft->mergeChild(parentNode, pChildNode, childIndex - 1);
-                    pChildNode = pLeft;
-                } else if (pRight) {
-                    //与右兄弟合并
-                    pChildNode->mergeChild(parentNode, pRight, childIndex);
-                }
-            }
-            recursive_remove(pChildNode, key, dataValue);
+            m_InternalNum += sign;
+            m_AllocatedBytes += sign * (int64_t) AllocatedSize(pNode, sizeof(InternalNode<KeyType, Order>));
         }
     }
 
 private:
-    BaseNode<KeyType> *m_Root;
-    LeafNode<KeyType, DataType> *m_DataHead;
-    KeyType m_MaxKey;  // B+树中的最大键
+    BaseNode<KeyType, Order> *m_Root;
+    LeafNode<KeyType, DataType, Order> *m_DataHead;
+    int64_t m_KeyNum = 0;           // 键值个数
+    int64_t m_LeafNum = 0;          // 叶子结点个数
+    int64_t m_InternalNum = 0;      // 内结点个数
+    int64_t m_AllocatedBytes = 0;   // 结点在分配器中实际占用的字节数
 };
 
-template<typename ElemType>
-class ObjArrayList {
-private:
-    ElemType **arr;    // 指针的指针，一维列表指针
-    int32_t length;    // 列表长度
-    int32_t size;    // 列表大小
-    const int32_t DEFAULT_LENGTH = 10;    // 默认长度
-    const int32_t INCREMENT_STEP = 10;    // 增长步长
-
-    // 分配内存空间	0|malloc  1|realloc
-    /*
-    .	分配内存空间
-    .	参数：
-    .	int32_t size: 列表大小（元素个数）
-    .	int32_t type: 0|malloc  1|realloc
-    */
-    void _AllocSpace(int32_t isize = 0, int32_t type = 0) {
-        //新分配的内存起始地址索引
-        int32_t start = 0;
-        //临时对象数组指针
-        ElemType **p = nullptr;
-        //1.首次分配内存
-        if (type == 0) {
-            //this->arr = (ElemType **)malloc(size * sizeof(ElemType *));
-            this->arr = new ElemType *[isize];    //参考指针数组，保持 new 与 delete 配对
-        }
-            //2.重新分配内存
-        else if (type == 1) {
-            //this->arr = (ElemType **)realloc(this->arr, size * sizeof(ElemType *));
-            //将原对象数组元素赋值到新数组中，并删除原数组
-            p = this->arr;
-            this->arr = new ElemType *[isize];
-            //1.迁移。注此时 this->size 还是原来的大小
-            for (int32_t i = 0; i < this->size; i++) {
-                this->arr[i] = p[i];
-            }
-            //2.销毁原数组
-            delete[] p;
-            //空位起始地址
-            start = this->length;
-        }
-        //3.初始化新分配内存元素为 nullptr
-        for (int32_t i = start; i < isize; i++) {
-            *(this->arr + i) = nullptr;
-        }
-    }
-
-    // 判断列表是否满
-    bool _IsFull() {
-        return this->length == this->size;
-    }
+/*
+.	页式 B+ 树 Paged B+ Tree
+.	存储结构：
+.		1.文件由定长页（PAGE_SIZE 字节）组成，第 0 页为文件头（根页、最左叶子页、键值个数、树高），其余为结点页；
+.		2.结点页：页头（类型、键值个数、右兄弟页号）之后为键值数组，内结点随后为孩子页号数组，叶子结点随后为数据数组；
+.		3.孩子、兄弟之间以页号相连，页号 0 表示空。
+.	缓冲池：
+.		固定个数的页框，页表将页号映射到页框；使用中的页被钉住（pin），淘汰按 CLOCK 算法跳过被钉住及最近访问过的页，
+.		脏页在淘汰或 Flush 时写回。一次查找最多读取树高个页，上层结点常驻缓冲池时通常只读一个叶子页。
+.	限制：键值与数据须为平凡可复制类型；只支持插入与查询（不支持删除）。
+*/
+const int32_t PAGE_SIZE = 4096;
+using PageID = uint32_t;
+const PageID INVALID_PAGE = 0;      // 第 0 页为文件头，不会作为结点页
 
+class BufferPool {
 public:
-    // 无参构造
-    ObjArrayList() {
-        _AllocSpace(this->DEFAULT_LENGTH, 0);    // 申请指针列表表空间：默认大小
-        this->length = 0;
-        this->size = this->DEFAULT_LENGTH;
+    // 缓冲池统计
+    struct Stats {
+        uint64_t hits = 0;          // 命中
+        uint64_t misses = 0;        // 未命中
+        uint64_t reads = 0;         // 读页次数
+        uint64_t writes = 0;        // 写页次数
+        uint64_t evictions = 0;     // 淘汰次数
+    };
+
+    explicit BufferPool(int32_t frameNum) {
+        this->frames.resize(std::max(frameNum, 8));
+        this->pages.reset(new char[this->frames.size() * PAGE_SIZE]);
     }
 
-    // 有参构造
-    ObjArrayList(int32_t m) {
-        _AllocSpace(m, 0);    //申请指针列表表空间：m 大小
-        this->length = 0;
-        this->size = m;
+    ~BufferPool() {
+        Close();
     }
 
+    BufferPool(const BufferPool &) = delete;
+    BufferPool &operator=(const BufferPool &) = delete;
 
-    // 析构函数
-    ~ObjArrayList() {
-        if (this->arr == nullptr) {
-            return;
+    // 打开页文件，truncate 为 true 时清空
+    bool Open(const char *path, bool truncate) {
+        Close();
+        this->iFd = ::open(path, O_RDWR | O_CREAT | (truncate ? O_TRUNC : 0), 0644);
+        if (this->iFd < 0) {
+            return false;
         }
-        for (int32_t i = 0; i < this->size; i++) {
-            delete *(this->arr + i);
+        struct stat st;
+        if (fstat(this->iFd, &st) != 0) {
+            Close();
+            return false;
         }
-        delete[] this->arr;
+        this->iPageNum = (PageID) (st.st_size / PAGE_SIZE);
+        return true;
     }
 
-    // 获取列表长度
-    int32_t Length() {
-        return this->length;
+    // 写回全部脏页并关闭文件
+    bool Close() {
+        if (this->iFd < 0) {
+            return true;
+        }
+        bool ok = FlushAll();
+        ::close(this->iFd);
+        this->iFd = -1;
+        for (Frame &frame : this->frames) {
+            frame = Frame();
+        }
+        this->pageTable.clear();
+        return ok;
     }
 
-    // 获取列表大小
-    int32_t Size() {
-        return this->size;
+    // 取页并钉住，用完须 Unpin；页不存在、读失败或所有页框都被钉住时返回 nullptr
+    char *Fetch(PageID id) {
+        auto itr = this->pageTable.find(id);
+        if (itr != this->pageTable.end()) {
+            Frame &frame = this->frames[itr->second];
+            frame.pinCount++;
+            frame.referenced = true;
+            this->stats.hits++;
+            return _Data(itr->second);
+        }
+        this->stats.misses++;
+        if (id >= this->iPageNum) {
+            return nullptr;
+        }
+        int32_t index = _Victim();
+        if (index == -1) {
+            return nullptr;
+        }
+        char *data = _Data(index);
+        if (pread(this->iFd, data, PAGE_SIZE, (off_t) id * PAGE_SIZE) != PAGE_SIZE) {
+            return nullptr;
+        }
+        this->stats.reads++;
+        _Bind(index, id);
+        return data;
     }
 
-    // 顺序增加一个元素
-    void Add(ElemType *e) {
-        // 重新分配空间大小
-        int32_t resize = 0;
-        if (_IsFull()) {
-            // 顺序增加一个默认步长大小的内存空间
-            resize = this->size + this->INCREMENT_STEP;
-            _AllocSpace(resize, 1);
-            this->size = resize;
-        }
-        *(this->arr + this->length) = e;
-        this->length++;
+    // 在文件末尾分配新页（清零、钉住、标记为脏）
+    char *Allocate(PageID &id) {
+        int32_t index = _Victim();
+        if (index == -1) {
+            return nullptr;
+        }
+        id = this->iPageNum++;
+        char *data = _Data(index);
+        memset(data, 0, PAGE_SIZE);
+        _Bind(index, id);
+        this->frames[index].dirty = true;
+        return data;
     }
 
-    // 指定位置增加一个元素
-    void Add(int32_t i, ElemType *e) {
-        // 重新分配空间大小
-        int32_t resize = 0;
-        ElemType *p = nullptr;
-        // 1.位置 i 在已有列表长度内
-        if (i <= this->length - 1) {
-            // 若 i 位置已有元素，先销毁原数据内存，再添加新元素
-            p = *(this->arr + i);
-            if (p != nullptr)
-                delete p;
-            *(this->arr + i) = e;
-        }
-            // 2.位置 i 在已有列表长度外，但还在列表大小范围内
-        else if (i <= this->size - 1) {
-            *(this->arr + i) = e;
-            this->length = i + 1;
-        }
-            // 3.位置 i 在超出列表大小，需重新分配内存
-        else {
-            // 按 内存增长步长的整数倍， 增加一段新内存
-            resize = ((i + 1) / this->INCREMENT_STEP + 1) * this->INCREMENT_STEP;
-            _AllocSpace(resize, 1);
-            this->size = resize;
-            *(this->arr + i) = e;
-            this->length = i + 1;
+    // 解除钉住，dirty 为 true 时标记为脏页
+    void Unpin(PageID id, bool dirty) {
+        auto itr = this->pageTable.find(id);
+        if (itr != this->pageTable.end()) {
+            Frame &frame = this->frames[itr->second];
+            frame.pinCount--;
+            frame.dirty = frame.dirty || dirty;
         }
     }
 
-    // 获取指定位置元素
-    ElemType *Get(int32_t i) {
-        return *(this->arr + i);
+    // 写回全部脏页
+    bool FlushAll() {
+        bool ok = true;
+        for (int32_t i = 0; i < (int32_t) this->frames.size(); i++) {
+            ok = _WriteBack(i) && ok;
+        }
+        return ok;
     }
 
-    friend std::ostream &operator<<(std::ostream &out, ObjArrayList<ElemType> *list) {
-        // 友元函数：重载输出操作符
-        std::cout << "The List is : ";
-        for (int32_t i = 0; i < list->Length(); i++) {
-            std::cout << i << "_";
-            if (list->Get(i) != nullptr)
-                std::cout << list->Get(i);
-            else
-                std::cout << "(nullptr) ";
-            if (i != list->Length() - 1)
-                std::cout << ",";
-            if (i % 10 == 9)
-                std::cout << std::endl;
-        }
-        return out;
+    PageID GetPageNum() const {
+        return this->iPageNum;
     }
-};
 
-// 链队列 类模板定义
-template<typename ElemType>
-class LinkQueue {
-    // 链队列
-    struct Node {
-        ElemType *data;
-        Node *next;
-    };
-private:
-    Node *front;    // 队头指针
-    Node *rear;    // 队尾指针
-public:
-    // 无参构造
-    LinkQueue() {
-        // 1.建立头结点
-        Node *p = new Node;
-        p->next = nullptr;
-        // 2.队头队尾指针指向头结点
-        this->rear = p;
-        this->front = this->rear;
+    int32_t GetFrameNum() const {
+        return (int32_t) this->frames.size();
     }
 
-    // 析构函数：销毁链队
-    ~LinkQueue() {
-        // 注：采用链头删除法
-        Node *p;
-        // 从front 头结点遍历到链尾
-        int32_t i = 0;
-        // 条件：尾结点 next == nullptr
-        while (this->front != nullptr) {
-            p = this->front;
-            this->front = this->front->next;
-            delete p;
-            i++;
-        }
+    const Stats &GetStats() const {
+        return this->stats;
+    }
 
-        std::cout << "共销毁结点：" << i - 1 << "个。" << std::endl;    //计数时，去除头结点
+    void ResetStats() {
+        this->stats = Stats();
     }
 
+private:
+    struct Frame {
+        PageID id = INVALID_PAGE;
+        int32_t pinCount = 0;
+        bool used = false;
+        bool dirty = false;
+        bool referenced = false;
+    };
 
-    // 入队
-    void EnQueue(ElemType *e) {
-        // 1.建立入队结点
-        Node *p = new Node;
-        p->data = e;
-        p->next = nullptr;
-        this->rear->next = p;
-        // 2.队尾指针后移至入队结点
-        this->rear = p;
+    int32_t iFd = -1;
+    PageID iPageNum = 0;
+    std::vector<Frame> frames;
+    std::unique_ptr<char[]> pages;
+    std::unordered_map<PageID, int32_t> pageTable;
+    int32_t iClockHand = 0;
+    Stats stats;
+
+    char *_Data(int32_t index) {
+        return this->pages.get() + (size_t) index * PAGE_SIZE;
     }
 
-    // 出队
-    ElemType *DeQueue() {
-        // 1.空队列判断
-        if (this->front == this->rear) {
-            std::cout << "空队列！不可出队。" << std::endl;
-            return nullptr;
+    void _Bind(int32_t index, PageID id) {
+        Frame &frame = this->frames[index];
+        frame.id = id;
+        frame.used = true;
+        frame.pinCount = 1;
+        frame.dirty = false;
+        frame.referenced = true;
+        this->pageTable[id] = index;
+    }
+
+    bool _WriteBack(int32_t index) {
+        Frame &frame = this->frames[index];
+        if (!frame.used || !frame.dirty) {
+            return true;
         }
-        // 2.非空队时，取队头元素结点
-        Node *p = this->front->next;
-        ElemType *e = p->data;
-        // 3.移除队头元素结点
-        this->front->next = p->next;
-        delete p;
-        // 4.若头结点 next 域为空，即无元素结点，此时将 rear = front
-        if (this->front->next == nullptr) {
-            this->rear = this->front;
+        if (pwrite(this->iFd, _Data(index), PAGE_SIZE, (off_t) frame.id * PAGE_SIZE) != PAGE_SIZE) {
+            return false;
         }
-        return e;
+        this->stats.writes++;
+        frame.dirty = false;
+        return true;
     }
 
-    // 获取队头元素
-    ElemType *GetHead() {
-        // 1.空队列判断
-        if (this->front == this->rear) {
-            std::cout << "空队列！无队头。" << std::endl;
-            return nullptr;
+    // CLOCK：跳过被钉住的页，最近访问过的页清除访问位后再给一次机会；返回空出的页框，失败时返回 -1
+    int32_t _Victim() {
+        int32_t frameNum = (int32_t) this->frames.size();
+        for (int32_t step = 0; step < 2 * frameNum; step++) {
+            int32_t index = this->iClockHand;
+            this->iClockHand = (this->iClockHand + 1) % frameNum;
+            Frame &frame = this->frames[index];
+            if (!frame.used) {
+                return index;
+            }
+            if (frame.pinCount > 0) {
+                continue;
+            }
+            if (frame.referenced) {
+                frame.referenced = false;
+                continue;
+            }
+            if (!_WriteBack(index)) {
+                return -1;
+            }
+            this->pageTable.erase(frame.id);
+            frame = Frame();
+            this->stats.evictions++;
+            return index;
         }
-        // 2.非空队时，取队头元素结点
-        return this->front->next->data;
-
+        return -1;
     }
+};
 
-    // 获取队尾元素
-    ElemType *GetLast() {
-        // 1.空队列判断
-        if (this->front == this->rear) {
-            std::cout << "空队列！无队尾。" << std::endl;
-            return nullptr;
-        }
-        // 2.非空队时，取队尾元素结点
-        return this->rear->data;
+// 页式 B+ 树文件头（第 0 页）：关闭或 flush 时写回
+struct PagedTreeHeader {
+    uint64_t magic = 0x3145455254424950ull;     // "PIBTREE1"
+    uint32_t keySize = 0;                       // 键值字节数
+    uint32_t dataSize = 0;                      // 数据字节数
+    PageID root = INVALID_PAGE;                 // 根页
+    PageID firstLeaf = INVALID_PAGE;            // 最左叶子页（叶子分裂只向右产生新页，建树后不变）
+    int32_t height = 0;                         // 树高
+    int64_t keyNum = 0;                         // 键值个数
+};
 
-    }
+// 结点页头
+struct PageNodeHeader {
+    uint16_t type;          // 结点类型
+    uint16_t keyNum;        // 键值个数
+    PageID next;            // 叶子结点的右兄弟页号
 };
 
-// 链栈 类模板定义
-template<typename ElemType>
-class LinkStack {
-    // 链栈结点
-    struct LSNode {
-        ElemType *data;    // 数据元素
-        LSNode *next;    // 指针域
-    };
-private:
-    LSNode *top;    // 链栈头指针（栈顶指针）
-public:
-    // 无参构造
-    LinkStack() { this->top = nullptr; }
+template<typename KeyType, typename DataType>
+class PagedBPlusTree {
+    static_assert(std::is_trivially_copyable_v<KeyType> && std::is_trivially_copyable_v<DataType>,
+                  "PagedBPlusTree 的键值与数据须为平凡可复制类型");
+    static_assert(alignof(KeyType) <= 8 && alignof(DataType) <= 8, "页内按 8 字节对齐");
 
-    // 析构函数：销毁链栈
-    ~LinkStack() {
-        LSNode *p = this->top, *q;
-        while (p != nullptr) {
-            q = p->next;
-            std::cout << "删除：" << p << std::endl;
-            delete p->data;
-            delete p;
-            p = q;
-        }
+    static constexpr size_t _Align(size_t n, size_t a) {
+        return (n + a - 1) / a * a;
     }
 
-    // 入栈
-    void Push(ElemType *e) {
-        LSNode *p = new LSNode();
-        p->data = e;
-        p->next = this->top;
-        this->top = p;
+public:
+    // 每页容量与页内偏移
+    static constexpr int32_t LEAF_CAPACITY = (int32_t) ((PAGE_SIZE - sizeof(PageNodeHeader) - alignof(DataType)) /
+                                                        (sizeof(KeyType) + sizeof(DataType)));
+    static constexpr int32_t INTERNAL_CAPACITY = (int32_t) ((PAGE_SIZE - sizeof(PageNodeHeader) - 2 * sizeof(PageID)) /
+                                                            (sizeof(KeyType) + sizeof(PageID)));
+    static constexpr size_t LEAF_DATA_OFFSET = _Align(sizeof(PageNodeHeader) + LEAF_CAPACITY * sizeof(KeyType),
+                                                      alignof(DataType));
+    static constexpr size_t INTERNAL_CHILD_OFFSET = _Align(sizeof(PageNodeHeader) + INTERNAL_CAPACITY * sizeof(KeyType),
+                                                           alignof(PageID));
+    static_assert(LEAF_CAPACITY >= 3 && INTERNAL_CAPACITY >= 3, "页太小");
+    static_assert(LEAF_DATA_OFFSET + LEAF_CAPACITY * sizeof(DataType) <= (size_t) PAGE_SIZE);
+    static_assert(INTERNAL_CHILD_OFFSET + (INTERNAL_CAPACITY + 1) * sizeof(PageID) <= (size_t) PAGE_SIZE);
+
+    // frameNum：缓冲池页框个数（至少 8 个）
+    explicit PagedBPlusTree(int32_t frameNum = 1024) : pool(frameNum) {
     }
 
+    ~PagedBPlusTree() {
+        close();
+    }
 
-    // 出栈
-    ElemType *Pop() {
-        if (this->top == nullptr) {
-            std::cout << "栈空！" << std::endl;
-            return nullptr;
+    // 打开页文件：create 为 true 时新建（清空原有内容），否则读取文件头并校验键值、数据大小
+    bool open(const char *path, bool create) {
+        close();
+        if (!this->pool.Open(path, create)) {
+            return false;
         }
-        LSNode *p = this->top;
-        ElemType *e = this->top->data;
-        this->top = this->top->next;
-        delete p;
-        return e;
+        if (this->pool.GetPageNum() == 0) {
+            PageID headerID;
+            char *page = this->pool.Allocate(headerID);
+            if (page == nullptr) {
+                this->pool.Close();
+                return false;
+            }
+            this->header = PagedTreeHeader();
+            this->header.keySize = sizeof(KeyType);
+            this->header.dataSize = sizeof(DataType);
+            memcpy(page, &this->header, sizeof(PagedTreeHeader));
+            this->pool.Unpin(headerID, true);
+        } else {
+            char *page = this->pool.Fetch(0);
+            if (page == nullptr) {
+                this->pool.Close();
+                return false;
+            }
+            memcpy(&this->header, page, sizeof(PagedTreeHeader));
+            this->pool.Unpin(0, false);
+            if (this->header.magic != PagedTreeHeader().magic || this->header.keySize != sizeof(KeyType) ||
+                this->header.dataSize != sizeof(DataType)) {
+                this->pool.Close();
+                return false;
+            }
+        }
+        this->bOpen = true;
+        return true;
     }
 
-    // 获取栈顶元素
-    ElemType *GetTop() {
-        if (this->top == nullptr) {
-            std::cout << "栈空！" << std::endl;
-            return nullptr;
+    // 写回文件头与全部脏页
+    bool flush() {
+        if (!this->bOpen) {
+            return false;
         }
-        return this->top->data;
+        char *page = this->pool.Fetch(0);
+        if (page == nullptr) {
+            return false;
+        }
+        memcpy(page, &this->header, sizeof(PagedTreeHeader));
+        this->pool.Unpin(0, true);
+        return this->pool.FlushAll();
     }
 
-    bool Empty() {
-        return this->top == nullptr;
+    bool close() {
+        if (!this->bOpen) {
+            return true;
+        }
+        bool ok = flush();
+        this->bOpen = false;
+        return this->pool.Close() && ok;
     }
-};
-
-/*
-.	图（邻接表实现） Graph Adjacency List
-.	相关术语：
-.		顶点 Vertex ； 边 Edge ；
-.		有向图 Digraph ；
-.	存储结构：
-.		1.顶点表采用B+树结构。
-.		2.边表采用B+树结构。
-*/
-class GraphAdjList {
-private:
-    // 边表结点
-    using EdgeNode = struct EdgeNode {
-        int32_t adjVex; // 邻接顶点所在表中下标ID
-//        EdgeNode *next; // 指向下一条边
 
-        static bool cmp(const EdgeNode &A, const EdgeNode &B){
-            return A.adjVex < B.adjVex; // 降序
+    // 插入：自顶向下，沿途预先分裂已满的结点；未打开或读写失败时返回 false
+    bool insert(KeyType key, const DataType &data) {
+        if (!this->bOpen) {
+            return false;
         }
-    };
-
-    // 顶点表结点
-    using VertexNode = struct VertexNode {
-        int32_t id; // 顶点ID
-        int32_t preID;  // 前向节点
-        BPlusTree<int32_t, EdgeNode> *pEdgeTable; // 指向边表
-
-        static bool cmp(const VertexNode &A, const VertexNode &B){
-            return A.id < B.id; // 降序
+        Page node(this->pool);
+        if (this->header.root == INVALID_PAGE) {
+            if (!node.Create(LEAF)) {
+                return false;
+            }
+            this->header.root = this->header.firstLeaf = node.id;
+            this->header.height = 1;
+        } else if (!node.Load(this->header.root)) {
+            return false;
         }
-    };
-
-public:
-    // 边数据，注：供外部初始化边数据使用
-    using EdgeData = struct EdgeData {
-        int32_t Tail;    // 边（弧）尾
-        int32_t Head;    // 边（弧）头
-    };
 
-public:
-    void addInviteRelationship(int32_t preID, int32_t newID) {
-        if (_addVexSet(preID, newID)) {
-            EdgeData * edge = new GraphAdjList::EdgeData{ preID, newID };
-            ObjArrayList<EdgeData> * edgesList = new ObjArrayList<EdgeData>();
-            edgesList->Add(edge);
-            _AddEdge(edgesList);
+        if (node.IsFull()) {    // 根结点已满，分裂
+            Page newRoot(this->pool);
+            if (!newRoot.Create(INTERNAL)) {
+                return false;
+            }
+            newRoot.Children()[0] = node.id;
+            if (!_Split(newRoot, 0, node)) {
+                return false;
+            }
+            this->header.root = newRoot.id;
+            this->header.height++;
+            node = std::move(newRoot);
         }
-    }
-
-
-private:
-    static const int32_t _MAX_VERTEX_NUM = 10;          // 支持最大顶点数
-
-    BPlusTree<int32_t, VertexNode> vexs;                // 顶点表
-    BPlusTree<int32_t, bool> vexs_visited;              // 顶点访问标记数组：0|未访问 1|已访问
 
-    int32_t iVexNum; // 顶点个数
-    int32_t iEdgeNum; // 边数
+        while (node.Type() == INTERNAL) {
+            int32_t childIndex = node.UpperBound(key);
+            Page child(this->pool);
+            if (!child.Load(node.Children()[childIndex])) {
+                return false;
+            }
+            // 子结点已满，先分裂再确定目标子结点
+            if (child.IsFull()) {
+                if (!_Split(node, childIndex, child)) {
+                    return false;
+                }
+                if (!(key < node.Keys()[childIndex]) && !child.Load(node.Children()[childIndex + 1])) {
+                    return false;
+                }
+            }
+            node = std::move(child);
+        }
 
-    // 创建顶点集合
-    bool _addVexSet(int32_t preID, int32_t newID) {
-        // 顶点是否存在
-        if (_Locate(preID) != -1) {
-            VertexNode vertexNode = { newID, preID, nullptr };
+        int32_t i = node.UpperBound(key);
+        int32_t keyNum = node.KeyNum();
+        std::copy_backward(node.Keys() + i, node.Keys() + keyNum, node.Keys() + keyNum + 1);
+        std::copy_backward(node.Data() + i, node.Data() + keyNum, node.Data() + keyNum + 1);
+        node.Keys()[i] = key;
+        node.Data()[i] = data;
+        node.SetKeyNum(keyNum + 1);
+        this->header.keyNum++;
+        return true;
+    }
 
-            this->vexs.insert(newID, vertexNode);
+    // 查找是否存在
+    bool search(KeyType key) {
+        DataType data;
+        return find(key, data);
+    }
 
-            this->iVexNum++;
+    // 点查询：存在时将数据写入 data
+    bool find(KeyType key, DataType &data) {
+        Page leaf(this->pool);
+        int32_t i;
+        if (!_SeekLeaf(key, leaf, i) || leaf.id == INVALID_PAGE || !(leaf.Keys()[i] == key)) {
+            return false;
+        }
+        data = leaf.Data()[i];
+        return true;
+    }
 
-            return true;
+    // 定值查询，compareOperator可以是LT(<)、LE(<=)、EQ(=)、BE(>=)、BT(>)
+    std::vector<DataType> select(KeyType compareKey, COMPARE_OPERATOR compareOpeartor) {
+        std::vector<DataType> results;
+        if (!this->bOpen || this->header.root == INVALID_PAGE) {
+            return results;
+        }
+        switch (compareOpeartor) {
+            case LT:
+            case LE:
+                _Scan(this->header.firstLeaf, 0, [&](const KeyType &key, const DataType &data) {
+                    if (compareKey < key || (compareOpeartor == LT && !(key < compareKey))) {
+                        return false;
+                    }
+                    results.push_back(data);
+                    return true;
+                });
+                break;
+            case EQ: {
+                DataType data;
+                if (find(compareKey, data)) {
+                    results.push_back(data);
+                }
+            }
+                break;
+            case BE:
+            case BT: {
+                Page leaf(this->pool);
+                int32_t i;
+                if (_SeekLeaf(compareKey, leaf, i) && leaf.id != INVALID_PAGE) {
+                    PageID start = leaf.id;
+                    leaf.Release();
+                    _Scan(start, i, [&](const KeyType &key, const DataType &data) {
+                        if (compareOpeartor == BE || compareKey < key) {
+                            results.push_back(data);
+                        }
+                        return true;
+                    });
+                }
+            }
+                break;
+            default:  // 范围查询
+                break;
         }
+        return results;
+    }
 
-        return false;
+    // 范围查询，BETWEEN：结果追加到 results
+    void select(KeyType smallKey, KeyType largeKey, std::vector<DataType> &results) {
+        Page leaf(this->pool);
+        int32_t i;
+        if (largeKey < smallKey || !_SeekLeaf(smallKey, leaf, i) || leaf.id == INVALID_PAGE) {
+            return;
+        }
+        PageID start = leaf.id;
+        leaf.Release();
+        _Scan(start, i, [&](const KeyType &key, const DataType &data) {
+            if (largeKey < key) {
+                return false;
+            }
+            results.push_back(data);
+            return true;
+        });
     }
 
-    // 创建边
-    void _AddEdge(ObjArrayList<EdgeData> *edgesList) {
-        // 初始化临时 边对象
-        EdgeData * edgeData = nullptr;
-        // 初始化 Tail Head 顶点下标索引
-        int32_t tail = 0, head = 0;
-        // 遍历边数据列表
-        for (int32_t i = 0; i < edgesList->Length(); i++) {
-            // 按序获取边（弧）
-            edgeData = edgesList->Get(i);
-            // 定位（或设置）边的两端顶点位置
-            tail = _Locate(edgeData->Tail);
-            head = _Locate(edgeData->Head);
-            // 插入边
-            _InsertEdge(tail, head);
+    // 按键值升序访问每个键值对
+    template<typename Visitor>
+    void forEach(Visitor &&visit) {
+        if (this->bOpen && this->header.root != INVALID_PAGE) {
+            _Scan(this->header.firstLeaf, 0, [&](const KeyType &key, const DataType &data) {
+                visit(key, data);
+                return true;
+            });
         }
+    }
 
+    int64_t size() const {
+        return this->header.keyNum;
     }
 
-    // 定位顶点元素位置
-    int32_t _Locate(int32_t vertex) {
-        if (this->vexs.search(vertex)) {
-            return vertex;
-        }
+    int32_t height() const {
+        return this->header.height;
+    }
 
-        // std::cout << std::endl << "顶点[" << vertex << "]不存在。" << std::endl;
-        return -1;
+    // 文件页数（含文件头）
+    PageID pageNum() const {
+        return this->pool.GetPageNum();
     }
 
-    // 插入边
-    void _InsertEdge(int32_t tail, int32_t head) {
-        // 边结点指针：初始化为 弧尾 指向的第一个边
-        auto vertexList = this->vexs.select(tail, EQ);
+    BufferPool &bufferPool() {
+        return this->pool;
+    }
 
-        if (vertexList.empty()) {
-            return;
+private:
+    // 钉住的结点页：析构或重新加载时解除钉住，修改过的页标记为脏页
+    class Page {
+    public:
+        explicit Page(BufferPool &pool) : pool(pool) {
         }
 
-        VertexNode vertexNode = vertexList[0];
-
-        if (vertexNode.pEdgeTable != nullptr) {
-            // 2.1.如果边存在，则跳过，不做插入
-            if (vertexNode.pEdgeTable->search(head)) {
-                return;
-            } else {
-                // 2.2.插入边
-                EdgeNode newEdge = { head };
+        ~Page() {
+            Release();
+        }
 
-                vertexNode.pEdgeTable->insert(tail, newEdge);
+        Page(const Page &) = delete;
+
+        Page &operator=(Page &&other) {
+            if (this != &other) {
+                Release();
+                this->id = other.id;
+                this->data = other.data;
+                this->dirty = other.dirty;
+                other.id = INVALID_PAGE;
+                other.data = nullptr;
+                other.dirty = false;
             }
-        } else {
-            // 3.1.边表不存在时，创建边表,插入边
-            EdgeNode newEdge = { head };
-            BPlusTree<int32_t, EdgeNode> *edges = new BPlusTree<int32_t, EdgeNode>; // 边表
+            return *this;
+        }
 
-            edges->insert(tail, newEdge);
+        bool Load(PageID pageID) {
+            Release();
+            this->data = this->pool.Fetch(pageID);
+            if (this->data == nullptr) {
+                return false;
+            }
+            this->id = pageID;
+            return true;
+        }
 
-            vertexNode.pEdgeTable = edges;
+        bool Create(NODE_TYPE type) {
+            Release();
+            this->data = this->pool.Allocate(this->id);
+            if (this->data == nullptr) {
+                this->id = INVALID_PAGE;
+                return false;
+            }
+            _Header()->type = (uint16_t) type;
+            this->dirty = true;
+            return true;
+        }
 
-            this->vexs.remove(vertexNode.id);
-            this->vexs.insert(vertexNode.id, vertexNode);
+        void Release() {
+            if (this->data != nullptr) {
+                this->pool.Unpin(this->id, this->dirty);
+            }
+            this->id = INVALID_PAGE;
+            this->data = nullptr;
+            this->dirty = false;
         }
 
-        // 4.边 计数
-        this->iEdgeNum++;
-    }
+        NODE_TYPE Type() {
+            return (NODE_TYPE) _Header()->type;
+        }
 
-    // 删除边
-    void _DeleteEdge(int32_t tail, int32_t head) {
-        // 边结点指针：初始化为 弧尾 指向的第一个边
-        auto vertexList = this->vexs.select(tail, EQ);
+        int32_t KeyNum() {
+            return _Header()->keyNum;
+        }
 
-        if (vertexList.empty()) {
-            return;
+        void SetKeyNum(int32_t keyNum) {
+            _Header()->keyNum = (uint16_t) keyNum;
+            this->dirty = true;
         }
 
-        VertexNode vertexNode = vertexList[0];
+        PageID Next() {
+            return _Header()->next;
+        }
 
-        // 初始化 前一边结点的指针
-        EdgeNode *q = nullptr;
+        void SetNext(PageID next) {
+            _Header()->next = next;
+            this->dirty = true;
+        }
 
-        // 1.查找边
-        if (vertexNode.pEdgeTable == nullptr) {
-            return;
+        KeyType *Keys() {
+            return reinterpret_cast<KeyType *>(this->data + sizeof(PageNodeHeader));
         }
 
-        // 若存不在该边，则结束
-        if (!vertexNode.pEdgeTable->search(head)) {
-            // 2.1.边不存在
-            std::cout << std::endl << "边[" << tail << "->" << head << "]不存在。"
-                      << std::endl;
-            return;
+        DataType *Data() {
+            return reinterpret_cast<DataType *>(this->data + LEAF_DATA_OFFSET);
         }
 
-        // 2.2.边存在，删除边
-        vertexNode.pEdgeTable->remove(head);
-    }
+        PageID *Children() {
+            return reinterpret_cast<PageID *>(this->data + INTERNAL_CHILD_OFFSET);
+        }
 
-    // 深度优先遍历 递归
-    void _DFS_R(int32_t index) {
-        // 1.访问顶点，并标记已访问
-        auto vertexList = this->vexs.select(index, EQ);
+        bool IsFull() {
+            return KeyNum() >= (Type() == LEAF ? LEAF_CAPACITY : INTERNAL_CAPACITY);
+        }
 
-        if (vertexList.empty()) {
-            return;
+        int32_t UpperBound(KeyType key) {
+            return (int32_t) (std::upper_bound(Keys(), Keys() + KeyNum(), key) - Keys());
         }
 
-        VertexNode vertexNode = vertexList[0];
+        int32_t LowerBound(KeyType key) {
+            return (int32_t) (std::lower_bound(Keys(), Keys() + KeyNum(), key) - Keys());
+        }
 
-        std::cout << vertexNode.id << " ";
-        this->vexs_visited.remove(vertexNode.id);
-        this->vexs_visited.insert(vertexNode.id, 1);
+        PageID id = INVALID_PAGE;
+        char *data = nullptr;
+        bool dirty = false;
 
-        // 2.遍历访问其相邻顶点
-        BPlusTree<int32_t, EdgeNode> *pEdges = vertexNode.pEdgeTable;
-        int32_t adjVex = 0;
+    private:
+        BufferPool &pool;
 
-        if (pEdges == nullptr) {
-            return;
+        PageNodeHeader *_Header() {
+            return reinterpret_cast<PageNodeHeader *>(this->data);
         }
+    };
 
-        auto edgeList = pEdges->select(0, BE);
+    BufferPool pool;
+    PagedTreeHeader header;
+    bool bOpen = false;
 
-        if (edgeList.empty()) {
-            return;
+    // 分裂已满的孩子结点：后一半移入新页，分隔键插入父结点
+    bool _Split(Page &parent, int32_t childIndex, Page &child) {
+        Page sibling(this->pool);
+        if (!sibling.Create(child.Type())) {
+            return false;
+        }
+        int32_t keyNum = child.KeyNum();
+        int32_t mid = keyNum / 2;
+        KeyType separator;
+        if (child.Type() == LEAF) {
+            std::copy(child.Keys() + mid, child.Keys() + keyNum, sibling.Keys());
+            std::copy(child.Data() + mid, child.Data() + keyNum, sibling.Data());
+            sibling.SetKeyNum(keyNum - mid);
+            sibling.SetNext(child.Next());
+            child.SetNext(sibling.id);
+            separator = sibling.Keys()[0];
+        } else {
+            separator = child.Keys()[mid];
+            std::copy(child.Keys() + mid + 1, child.Keys() + keyNum, sibling.Keys());
+            std::copy(child.Children() + mid + 1, child.Children() + keyNum + 1, sibling.Children());
+            sibling.SetKeyNum(keyNum - mid - 1);
         }
+        child.SetKeyNum(mid);
+
+        int32_t parentKeyNum = parent.KeyNum();
+        std::copy_backward(parent.Keys() + childIndex, parent.Keys() + parentKeyNum, parent.Keys() + parentKeyNum + 1);
+        std::copy_backward(parent.Children() + childIndex + 1, parent.Children() + parentKeyNum + 1,
+                           parent.Children() + parentKeyNum + 2);
+        parent.Keys()[childIndex] = separator;
+        parent.Children()[childIndex + 1] = sibling.id;
+        parent.SetKeyNum(parentKeyNum + 1);
+        return true;
+    }
 
-        for (auto edge : edgeList) {
-            adjVex = edge.adjVex;
-            // 当顶点未被访问过时，可访问
-            auto visited = this->vexs_visited.select(adjVex, EQ);
-            if (visited.empty()) {
-                continue;
+    // 定位第一个不小于 key 的键值：leaf 为所在叶子页、i 为页内下标，不存在时 leaf.id 为空；读失败时返回 false
+    bool _SeekLeaf(KeyType key, Page &leaf, int32_t &i) {
+        if (!this->bOpen || this->header.root == INVALID_PAGE) {
+            return true;
+        }
+        if (!leaf.Load(this->header.root)) {
+            return false;
+        }
+        while (leaf.Type() == INTERNAL) {
+            if (!leaf.Load(leaf.Children()[leaf.UpperBound(key)])) {
+                return false;
             }
+        }
+        i = leaf.LowerBound(key);
+        if (i == leaf.KeyNum()) {
+            PageID next = leaf.Next();
+            leaf.Release();
+            i = 0;
+            return next == INVALID_PAGE || leaf.Load(next);
+        }
+        return true;
+    }
 
-            if (visited[0] != true) {
-                _DFS_R(adjVex);
+    // 从叶子页 pageID 的第 i 个键值起顺序扫描，fn 返回 false 时停止
+    template<typename Fn>
+    bool _Scan(PageID pageID, int32_t i, Fn &&fn) {
+        Page leaf(this->pool);
+        while (pageID != INVALID_PAGE) {
+            if (!leaf.Load(pageID)) {
+                return false;
+            }
+            for (; i < leaf.KeyNum(); i++) {
+                if (!fn(leaf.Keys()[i], leaf.Data()[i])) {
+                    return true;
+                }
             }
+            pageID = leaf.Next();
+            i = 0;
         }
+        return true;
     }
+};
 
-//    // 深度优先遍历 非递归
-//    void _DFS(int32_t index) {
-//        // 1.访问第一个结点，并标记为 已访问
-//        auto vertexList = this->vexs.select(index, EQ);
-//
-//        if (vertexList.empty()) {
-//            return;
+// 按缓存行对齐的分配器：数组首元素位于缓存行起点，每个 CACHE_LINE 字节的块恰好占一个缓存行
+template<typename T>
+struct CacheAlignedAllocator {
+    using value_type = T;
+
+    CacheAlignedAllocator() = default;
+
+    template<typename U>
+    CacheAlignedAllocator(const CacheAlignedAllocator<U> &) {
+    }
+
+    T *allocate(size_t n) {
+        return (T *) ::operator new(n * sizeof(T), std::align_val_t(CACHE_LINE));
+    }
+
+    void deallocate(T *p, size_t) {
+        ::operator delete(p, std::align_val_t(CACHE_LINE));
+    }
+
+    bool operator==(const CacheAlignedAllocator &) const {
+        return true;
+    }
+};
+
+/*
+.	静态键值索引 Static Key Index（隐式 S+ 树）
+.	升序键值连续存储，每 NODE_KEYS 个（一个缓存行）为一个叶子块，末尾以最大值补齐；
+.	其上逐层建立隐式内结点：第 h 层结点 k 的第 j 个键值为其孩子 k * (NODE_KEYS + 1) + j 子树中的最大键值，
+.	孩子位置由下标计算，不存储指针。自顶向下每层只读一个缓存行，结点内以比较计数（SSE2 下为 SIMD 比较）选孩子，无分支。
+.	内结点约占键值的 1 / NODE_KEYS。构建后只读。
+*/
+template<typename KeyType>
+class StaticKeyIndex {
+public:
+    static constexpr int32_t NODE_KEYS = CACHE_LINE / sizeof(KeyType) > 0 ? (int32_t) (CACHE_LINE / sizeof(KeyType)) : 1;
+
+    // 追加键值，须严格升序
+    void Add(KeyType key) {
+        this->keys.push_back(key);
+    }
+
+    void Reserve(int64_t n) {
+        this->keys.reserve((size_t) n);
+    }
+
+    // 结束构建：补齐叶子块，由叶子层一次自底向上建立各层内结点
+    void Finish() {
+        this->iKeyNum = (int64_t) this->keys.size();
+        while (this->keys.size() % NODE_KEYS != 0) {
+            this->keys.push_back(KeyTraits<KeyType>::Sentinel());
+        }
+        this->keys.shrink_to_fit();
+
+        // 各层结点数：第 0 层为叶子块，直到只有一个结点
+        std::vector<int64_t> layerNodes = { (int64_t) this->keys.size() / NODE_KEYS };
+        while (layerNodes.back() > 1) {
+            layerNodes.push_back((layerNodes.back() + NODE_KEYS) / (NODE_KEYS + 1));
+        }
+        this->iHeight = (int32_t) layerNodes.size() - 1;
+
+        // 内结点自顶向下存储：根在最前
+        this->layerOffset.assign(this->iHeight + 1, 0);
+        int64_t offset = 0;
+        for (int32_t h = this->iHeight; h >= 1; h--) {
+            this->layerOffset[h] = offset;
+            offset += layerNodes[h] * NODE_KEYS;
+        }
+        this->nodes.assign((size_t) offset, KeyTraits<KeyType>::Sentinel());
+        int64_t span = NODE_KEYS;   // 第 h - 1 层一个结点覆盖的键值个数
+        for (int32_t h = 1; h <= this->iHeight; h++) {
+            KeyType *layer = this->nodes.data() + this->layerOffset[h];
+            for (int64_t k = 0; k < layerNodes[h]; k++) {
+                for (int32_t j = 0; j < NODE_KEYS; j++) {
+                    int64_t child = k * (NODE_KEYS + 1) + j;
+                    if (child < layerNodes[h - 1]) {
+                        layer[k * NODE_KEYS + j] = this->keys[std::min(this->iKeyNum, (child + 1) * span) - 1];
+                    }
+                }
+            }
+            span *= NODE_KEYS + 1;
+        }
+        this->nodes.shrink_to_fit();
+    }
+
+    // 第一个不小于 key 的键值位置，不存在时返回 Size()
+    int64_t LowerBound(KeyType key) const {
+        if (this->iKeyNum == 0 || this->keys[this->iKeyNum - 1] < key) {
+            return this->iKeyNum;
+        }
+        int64_t k = 0;
+        for (int32_t h = this->iHeight; h >= 1; h--) {
+            k = k * (NODE_KEYS + 1) + _Rank(this->nodes.data() + this->layerOffset[h] + k * NODE_KEYS, key);
+        }
+        return k * NODE_KEYS + _Rank(this->keys.data() + k * NODE_KEYS, key);
+    }
+
+    // 键值的位置，不存在时返回 -1
+    int64_t Find(KeyType key) const {
+        int64_t pos = LowerBound(key);
+        return pos < this->iKeyNum && this->keys[pos] == key ? pos : -1;
+    }
+
+    // 批量查找：positions[i] 为 keys[i] 的位置，不存在时为 -1
+    // 每 MULTI_FIND_GROUP 个键值一组同步下降，每层为组内全部键值选出孩子并预取，各次下降的缓存未命中相互重叠
+    void MultiFind(const KeyType *findKeys, int32_t n, int64_t *positions) const {
+        if (this->iKeyNum == 0) {
+            std::fill(positions, positions + n, -1);
+            return;
+        }
+        KeyType maxKey = this->keys[this->iKeyNum - 1];
+        KeyType probe[MULTI_FIND_GROUP];
+        int64_t nodeIndex[MULTI_FIND_GROUP];
+        for (int32_t base = 0; base < n; base += MULTI_FIND_GROUP) {
+            int32_t groupNum = std::min(MULTI_FIND_GROUP, n - base);
+            for (int32_t i = 0; i < groupNum; i++) {
+                // 大于最大键值的键值按最大键值下降，保证落在已有结点中，结果由最后的比较排除
+                probe[i] = std::min(findKeys[base + i], maxKey);
+                nodeIndex[i] = 0;
+            }
+            for (int32_t h = this->iHeight; h >= 1; h--) {
+                const KeyType *layer = this->nodes.data() + this->layerOffset[h];
+                const KeyType *next = h > 1 ? this->nodes.data() + this->layerOffset[h - 1] : this->keys.data();
+                for (int32_t i = 0; i < groupNum; i++) {
+                    int64_t k = nodeIndex[i] * (NODE_KEYS + 1) + _Rank(layer + nodeIndex[i] * NODE_KEYS, probe[i]);
+                    PrefetchObject(next + k * NODE_KEYS, CACHE_LINE);
+                    nodeIndex[i] = k;
+                }
+            }
+            for (int32_t i = 0; i < groupNum; i++) {
+                int64_t pos = nodeIndex[i] * NODE_KEYS + _Rank(this->keys.data() + nodeIndex[i] * NODE_KEYS, probe[i]);
+                positions[base + i] = this->keys[pos] == findKeys[base + i] ? pos : -1;
+            }
+        }
+    }
+
+    KeyType Key(int64_t pos) const {
+        return this->keys[pos];
+    }
+
+    int64_t Size() const {
+        return this->iKeyNum;
+    }
+
+    int32_t Height() const {
+        return this->iHeight;
+    }
+
+    // 占用的字节数：叶子层与内结点
+    size_t Bytes() const {
+        return sizeof(KeyType) * (this->keys.capacity() + this->nodes.capacity());
+    }
+
+    void Clear() {
+        std::vector<KeyType, CacheAlignedAllocator<KeyType>>().swap(this->keys);
+        std::vector<KeyType, CacheAlignedAllocator<KeyType>>().swap(this->nodes);
+        this->layerOffset.clear();
+        this->iKeyNum = 0;
+        this->iHeight = 0;
+    }
+
+private:
+    std::vector<KeyType, CacheAlignedAllocator<KeyType>> keys;     // 叶子层：升序键值，补齐到 NODE_KEYS 的整数倍
+    std::vector<KeyType, CacheAlignedAllocator<KeyType>> nodes;    // 内结点，自顶向下逐层存储
+    std::vector<int64_t> layerOffset;   // 第 h 层（h >= 1）内结点在 nodes 中的起始位置
+    int64_t iKeyNum = 0;                // 键值个数（不含补齐）
+    int32_t iHeight = 0;                // 内结点层数
+
+    // 结点中小于 key 的键值个数
+    static int32_t _Rank(const KeyType *node, KeyType key) {
+#if defined(__SSE2__)
+        if constexpr (std::is_same_v<KeyType, int32_t> && NODE_KEYS == 16) {
+            __m128i x = _mm_set1_epi32(key);
+            __m128i a = _mm_packs_epi32(_mm_cmplt_epi32(_mm_load_si128((const __m128i *) node), x),
+                                        _mm_cmplt_epi32(_mm_load_si128((const __m128i *) node + 1), x));
+            __m128i b = _mm_packs_epi32(_mm_cmplt_epi32(_mm_load_si128((const __m128i *) node + 2), x),
+                                        _mm_cmplt_epi32(_mm_load_si128((const __m128i *) node + 3), x));
+            return __builtin_popcount((uint32_t) _mm_movemask_epi8(_mm_packs_epi16(a, b)));
+        }
+#endif
+        int32_t n = 0;
+        for (int32_t i = 0; i < NODE_KEYS; i++) {
+            n += node[i] < key;
+        }
+        return n;
+    }
+};
+
+/*
+.	静态搜索树 Static Search Tree
+.	只读的键值 -> 数据索引：键值存于 StaticKeyIndex，数据按键值顺序连续存储在相同位置。
+.	由 BPlusTree 的叶子链一次遍历构建，查询接口与 BPlusTree 相同，适合快照与只读服务。
+*/
+template<typename KeyType, typename DataType>
+class StaticSearchTree {
+public:
+    // 由动态 B+ 树构建：沿叶子链升序遍历一次
+    template<int32_t Order>
+    void build(const BPlusTree<KeyType, DataType, Order> &tree) {
+        clear();
+        tree.forEach([&](KeyType key, const DataType &data) {
+            add(key, data);
+        });
+        finish();
+    }
+
+    // 逐个追加键值对（键值须严格升序），最后调用 finish
+    void add(KeyType key, const DataType &data) {
+        this->index.Add(key);
+        this->datas.push_back(data);
+    }
+
+    void add(KeyType key, DataType &&data) {
+        this->index.Add(key);
+        this->datas.push_back(std::move(data));
+    }
+
+    void finish() {
+        this->index.Finish();
+        this->datas.shrink_to_fit();
+    }
+
+    bool search(KeyType key) const {
+        return this->index.Find(key) != -1;
+    }
+
+    // 查找键值对应的数据，不存在时返回 nullptr
+    const DataType *find(KeyType key) const {
+        int64_t pos = this->index.Find(key);
+        return pos != -1 ? &this->datas[pos] : nullptr;
+    }
+
+    // 批量查找：results[i] 为 keys[i] 对应数据的指针，不存在时为 nullptr
+    void multiFind(const KeyType *keys, int32_t n, const DataType **results) const {
+        int64_t positions[MULTI_FIND_GROUP];
+        for (int32_t base = 0; base < n; base += MULTI_FIND_GROUP) {
+            int32_t groupNum = std::min(MULTI_FIND_GROUP, n - base);
+            this->index.MultiFind(keys + base, groupNum, positions);
+            for (int32_t i = 0; i < groupNum; i++) {
+                results[base + i] = positions[i] != -1 ? &this->datas[positions[i]] : nullptr;
+            }
+        }
+    }
+
+    // 定值查询，compareOperator可以是LT(<)、LE(<=)、EQ(=)、BE(>=)、BT(>)
+    std::vector<DataType> select(KeyType compareKey, COMPARE_OPERATOR compareOpeartor) const {
+        int64_t lower = this->index.LowerBound(compareKey);
+        int64_t upper = lower < size() && this->index.Key(lower) == compareKey ? lower + 1 : lower;
+        switch (compareOpeartor) {
+            case LT:
+                return _Slice(0, lower);
+            case LE:
+                return _Slice(0, upper);
+            case EQ:
+                return _Slice(lower, upper);
+            case BE:
+                return _Slice(lower, size());
+            case BT:
+                return _Slice(upper, size());
+            default:  // 范围查询
+                return {};
+        }
+    }
+
+    // 范围查询，BETWEEN：结果追加到 results
+    void select(KeyType smallKey, KeyType largeKey, std::vector<DataType> &results) const {
+        if (smallKey > largeKey) {
+            return;
+        }
+        int64_t lower = this->index.LowerBound(smallKey);
+        int64_t upper = this->index.LowerBound(largeKey);
+        if (upper < size() && this->index.Key(upper) == largeKey) {
+            upper++;
+        }
+        results.insert(results.end(), this->datas.begin() + lower, this->datas.begin() + upper);
+    }
+
+    // 按键值升序访问每个键值对
+    template<typename Visitor>
+    void forEach(Visitor &&visit) const {
+        for (int64_t i = 0; i < size(); i++) {
+            visit(this->index.Key(i), this->datas[i]);
+        }
+    }
+
+    int64_t size() const {
+        return this->index.Size();
+    }
+
+    // 树高（含叶子层）
+    int32_t height() const {
+        return this->index.Size() > 0 ? this->index.Height() + 1 : 0;
+    }
+
+    size_t bytes() const {
+        return this->index.Bytes() + sizeof(DataType) * this->datas.capacity();
+    }
+
+    void clear() {
+        this->index.Clear();
+        std::vector<DataType>().swap(this->datas);
+    }
+
+private:
+    StaticKeyIndex<KeyType> index;
+    std::vector<DataType> datas;    // 与键值位置一一对应的数据
+
+    std::vector<DataType> _Slice(int64_t begin, int64_t end) const {
+        return std::vector<DataType>(this->datas.begin() + begin, this->datas.begin() + end);
+    }
+};
+
+template<typename ElemType>
+class ObjArrayList {
+private:
+    ElemType *arr;    // 元素数组，元素按值存储
+    int32_t length;    // 列表长度
+    int32_t size;    // 列表大小
+    static constexpr int32_t DEFAULT_LENGTH = 10;    // 默认长度
+
+    /*
+    .	重新分配内存空间，元素逐个移动到新空间
+    .	参数：
+    .	int32_t isize: 新的列表大小（元素个数），不小于当前长度
+    */
+    void _AllocSpace(int32_t isize) {
+        ElemType *p = static_cast<ElemType *>(::operator new(sizeof(ElemType) * (size_t) isize));
+        for (int32_t i = 0; i < this->length; i++) {
+            new(p + i) ElemType(std::move(this->arr[i]));
+            this->arr[i].~ElemType();
+        }
+        ::operator delete(this->arr);
+        this->arr = p;
+        this->size = isize;
+    }
+
+    // 保证可容纳 n 个元素：按 2 倍几何增长，N 次追加的均摊复杂度为 O(N)
+    void _EnsureSpace(int32_t n) {
+        if (n > this->size) {
+            _AllocSpace(std::max(n, std::max(this->size * 2, DEFAULT_LENGTH)));
+        }
+    }
+
+    // 释放所有元素及内存
+    void _Release() {
+        Clear();
+        ::operator delete(this->arr);
+        this->arr = nullptr;
+        this->size = 0;
+    }
+
+public:
+    // 无参构造：首次添加元素时才分配内存
+    ObjArrayList() {
+        this->arr = nullptr;
+        this->length = 0;
+        this->size = 0;
+    }
+
+    // 有参构造：预留 m 个元素
+    explicit ObjArrayList(int32_t m) : ObjArrayList() {
+        Reserve(m);
+    }
+
+    ObjArrayList(const ObjArrayList &other) : ObjArrayList() {
+        Reserve(other.length);
+        for (int32_t i = 0; i < other.length; i++) {
+            Add(other.arr[i]);
+        }
+    }
+
+    ObjArrayList(ObjArrayList &&other) noexcept {
+        this->arr = other.arr;
+        this->length = other.length;
+        this->size = other.size;
+        other.arr = nullptr;
+        other.length = 0;
+        other.size = 0;
+    }
+
+    ObjArrayList &operator=(const ObjArrayList &other) {
+        if (this != &other) {
+            ObjArrayList copy(other);
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+
+    ObjArrayList &operator=(ObjArrayList &&other) noexcept {
+        if (this != &other) {
+            _Release();
+            std::swap(this->arr, other.arr);
+            std::swap(this->length, other.length);
+            std::swap(this->size, other.size);
+        }
+        return *this;
+    }
+
+    // 析构函数
+    ~ObjArrayList() {
+        _Release();
+    }
+
+    // 获取列表长度
+    int32_t Length() const {
+        return this->length;
+    }
+
+    // 获取列表大小
+    int32_t Size() const {
+        return this->size;
+    }
+
+    // 元素数组在分配器中实际占用的字节数
+    size_t AllocatedBytes() const {
+        return AllocatedSize(this->arr, sizeof(ElemType) * (size_t) this->size);
+    }
+
+    // 预留至少 n 个元素的空间
+    void Reserve(int32_t n) {
+        if (n > this->size) {
+            _AllocSpace(n);
+        }
+    }
+
+    // 顺序增加一个元素
+    void Add(const ElemType &e) {
+        Emplace(e);
+    }
+
+    void Add(ElemType &&e) {
+        Emplace(std::move(e));
+    }
+
+    // 在列表尾部原地构造一个元素
+    template<typename... Args>
+    ElemType &Emplace(Args &&... args) {
+        if (this->length == this->size) {
+            // 参数可能引用本列表中的元素，先构造再扩容
+            ElemType e(std::forward<Args>(args)...);
+            _EnsureSpace(this->length + 1);
+            return *new(this->arr + this->length++) ElemType(std::move(e));
+        }
+        ElemType *p = new(this->arr + this->length) ElemType(std::forward<Args>(args)...);
+        this->length++;
+        return *p;
+    }
+
+    // 指定位置设置一个元素，位置超出列表长度时中间补默认值
+    void Add(int32_t i, const ElemType &e) {
+        if (i < this->length) {
+            this->arr[i] = e;
+            return;
+        }
+        ElemType copy(e);       // e 可能引用本列表中的元素，先复制再扩容
+        _EnsureSpace(i + 1);
+        while (this->length < i) {
+            new(this->arr + this->length) ElemType();
+            this->length++;
+        }
+        Emplace(std::move(copy));
+    }
+
+    // 获取指定位置元素
+    ElemType &Get(int32_t i) {
+        return this->arr[i];
+    }
+
+    const ElemType &Get(int32_t i) const {
+        return this->arr[i];
+    }
+
+    // 在位置 i（0 <= i <= 长度）插入一个元素，其后元素依次后移
+    void Insert(int32_t i, const ElemType &e) {
+        Insert(i, ElemType(e));     // e 可能引用本列表中的元素，先复制再移动
+    }
+
+    void Insert(int32_t i, ElemType &&e) {
+        if (i == this->length) {
+            Add(std::move(e));
+            return;
+        }
+        ElemType value(std::move(e));
+        Emplace(std::move(this->arr[this->length - 1]));
+        for (int32_t j = this->length - 2; j > i; j--) {
+            this->arr[j] = std::move(this->arr[j - 1]);
+        }
+        this->arr[i] = std::move(value);
+    }
+
+    // 移除位置 i 的元素，其后元素依次前移
+    void RemoveAt(int32_t i) {
+        for (int32_t j = i; j < this->length - 1; j++) {
+            this->arr[j] = std::move(this->arr[j + 1]);
+        }
+        RemoveLast();
+    }
+
+    // 移除最后一个元素
+    void RemoveLast() {
+        this->length--;
+        this->arr[this->length].~ElemType();
+    }
+
+    // 清空元素，保留内存
+    void Clear() {
+        for (int32_t i = 0; i < this->length; i++) {
+            this->arr[i].~ElemType();
+        }
+        this->length = 0;
+    }
+
+    ElemType *begin() { return this->arr; }
+
+    ElemType *end() { return this->arr + this->length; }
+
+    const ElemType *begin() const { return this->arr; }
+
+    const ElemType *end() const { return this->arr + this->length; }
+
+    friend std::ostream &operator<<(std::ostream &out, const ObjArrayList<ElemType> &list) {
+        // 友元函数：重载输出操作符
+        out << "The List is : ";
+        for (int32_t i = 0; i < list.Length(); i++) {
+            out << i << "_" << list.Get(i);
+            if (i != list.Length() - 1)
+                out << ",";
+            if (i % 10 == 9)
+                out << std::endl;
+        }
+        return out;
+    }
+};
+
+// 循环队列 类模板定义：元素按值存储在连续的环形缓冲区中，容量按 2 倍增长
+template<typename ElemType>
+class ArrayQueue {
+private:
+    ElemType *arr;      // 环形缓冲区
+    int32_t front;      // 队头下标
+    int32_t length;     // 元素个数
+    int32_t size;       // 缓冲区大小（2 的幂）
+    static constexpr int32_t DEFAULT_LENGTH = 16;    // 默认大小
+
+    // 重新分配缓冲区，元素按队列顺序移动到新缓冲区开头
+    void _AllocSpace(int32_t isize) {
+        ElemType *p = static_cast<ElemType *>(::operator new(sizeof(ElemType) * (size_t) isize));
+        for (int32_t i = 0; i < this->length; i++) {
+            ElemType &e = this->arr[(this->front + i) & (this->size - 1)];
+            new(p + i) ElemType(std::move(e));
+            e.~ElemType();
+        }
+        ::operator delete(this->arr);
+        this->arr = p;
+        this->front = 0;
+        this->size = isize;
+    }
+
+    // 队尾空位下标
+    int32_t _RearIndex() const {
+        return (this->front + this->length) & (this->size - 1);
+    }
+
+public:
+    ArrayQueue() {
+        this->arr = nullptr;
+        this->front = 0;
+        this->length = 0;
+        this->size = 0;
+    }
+
+    ArrayQueue(const ArrayQueue &) = delete;
+
+    ArrayQueue &operator=(const ArrayQueue &) = delete;
+
+    ~ArrayQueue() {
+        Clear();
+        ::operator delete(this->arr);
+    }
+
+    // 预留至少 n 个元素的空间
+    void Reserve(int32_t n) {
+        if (n > this->size) {
+            int32_t isize = std::max(this->size, DEFAULT_LENGTH);
+            while (isize < n) {
+                isize *= 2;
+            }
+            _AllocSpace(isize);
+        }
+    }
+
+    // 入队
+    void EnQueue(const ElemType &e) {
+        Emplace(e);
+    }
+
+    void EnQueue(ElemType &&e) {
+        Emplace(std::move(e));
+    }
+
+    template<typename... Args>
+    void Emplace(Args &&... args) {
+        if (this->length == this->size) {
+            Reserve(this->size + 1);
+        }
+        new(this->arr + _RearIndex()) ElemType(std::forward<Args>(args)...);
+        this->length++;
+    }
+
+    // 出队：空队列时返回 false
+    bool DeQueue(ElemType &e) {
+        if (this->length == 0) {
+            return false;
+        }
+        e = std::move(this->arr[this->front]);
+        this->arr[this->front].~ElemType();
+        this->front = (this->front + 1) & (this->size - 1);
+        this->length--;
+        return true;
+    }
+
+    // 获取队头元素：空队列时返回 nullptr
+    ElemType *GetHead() {
+        return this->length == 0 ? nullptr : this->arr + this->front;
+    }
+
+    // 获取队尾元素：空队列时返回 nullptr
+    ElemType *GetLast() {
+        return this->length == 0 ? nullptr : this->arr + ((this->front + this->length - 1) & (this->size - 1));
+    }
+
+    bool Empty() const {
+        return this->length == 0;
+    }
+
+    int32_t Length() const {
+        return this->length;
+    }
+
+    // 清空元素，保留缓冲区
+    void Clear() {
+        for (int32_t i = 0; i < this->length; i++) {
+            this->arr[(this->front + i) & (this->size - 1)].~ElemType();
+        }
+        this->front = 0;
+        this->length = 0;
+    }
+};
+
+// 顺序栈 类模板定义：元素按值存储在连续数组中，容量按 2 倍增长
+template<typename ElemType>
+class ArrayStack {
+private:
+    ObjArrayList<ElemType> elems;   // 栈底在下标 0
+
+public:
+    // 预留至少 n 个元素的空间
+    void Reserve(int32_t n) {
+        this->elems.Reserve(n);
+    }
+
+    // 入栈
+    void Push(const ElemType &e) {
+        this->elems.Add(e);
+    }
+
+    void Push(ElemType &&e) {
+        this->elems.Add(std::move(e));
+    }
+
+    // 出栈：栈空时返回 false
+    bool Pop(ElemType &e) {
+        if (this->elems.Length() == 0) {
+            return false;
+        }
+        e = std::move(this->elems.Get(this->elems.Length() - 1));
+        this->elems.RemoveLast();
+        return true;
+    }
+
+    // 获取栈顶元素：栈空时返回 nullptr
+    ElemType *GetTop() {
+        return this->elems.Length() == 0 ? nullptr : &this->elems.Get(this->elems.Length() - 1);
+    }
+
+    bool Empty() const {
+        return this->elems.Length() == 0;
+    }
+
+    int32_t Length() const {
+        return this->elems.Length();
+    }
+
+    void Clear() {
+        this->elems.Clear();
+    }
+};
+
+// 链队列 类模板定义
+template<typename ElemType>
+class LinkQueue {
+    // 链队列
+    struct Node {
+        ElemType *data;
+        Node *next;
+    };
+private:
+    Node *front;    // 队头指针
+    Node *rear;    // 队尾指针
+public:
+    // 无参构造
+    LinkQueue() {
+        // 1.建立头结点
+        Node *p = new Node;
+        p->next = nullptr;
+        // 2.队头队尾指针指向头结点
+        this->rear = p;
+        this->front = this->rear;
+    }
+
+    // 析构函数：销毁链队
+    ~LinkQueue() {
+        // 注：采用链头删除法
+        Node *p;
+        // 从front 头结点遍历到链尾
+        // 条件：尾结点 next == nullptr
+        while (this->front != nullptr) {
+            p = this->front;
+            this->front = this->front->next;
+            delete p;
+        }
+    }
+
+
+    // 入队
+    void EnQueue(ElemType *e) {
+        // 1.建立入队结点
+        Node *p = new Node;
+        p->data = e;
+        p->next = nullptr;
+        this->rear->next = p;
+        // 2.队尾指针后移至入队结点
+        this->rear = p;
+    }
+
+    // 出队
+    ElemType *DeQueue() {
+        // 1.空队列判断
+        if (this->front == this->rear) {
+            return nullptr;
+        }
+        // 2.非空队时，取队头元素结点
+        Node *p = this->front->next;
+        ElemType *e = p->data;
+        // 3.移除队头元素结点
+        this->front->next = p->next;
+        delete p;
+        // 4.若头结点 next 域为空，即无元素结点，此时将 rear = front
+        if (this->front->next == nullptr) {
+            this->rear = this->front;
+        }
+        return e;
+    }
+
+    // 获取队头元素
+    ElemType *GetHead() {
+        // 1.空队列判断
+        if (this->front == this->rear) {
+            return nullptr;
+        }
+        // 2.非空队时，取队头元素结点
+        return this->front->next->data;
+
+    }
+
+    // 获取队尾元素
+    ElemType *GetLast() {
+        // 1.空队列判断
+        if (this->front == this->rear) {
+            return nullptr;
+        }
+        // 2.非空队时，取队尾元素结点
+        return this->rear->data;
+
+    }
+};
+
+// 链栈 类模板定义
+template<typename ElemType>
+class LinkStack {
+    // 链栈结点
+    struct LSNode {
+        ElemType *data;    // 数据元素
+        LSNode *next;    // 指针域
+    };
+private:
+    LSNode *top;    // 链栈头指针（栈顶指针）
+public:
+    // 无参构造
+    LinkStack() { this->top = nullptr; }
+
+    // 析构函数：销毁链栈
+    ~LinkStack() {
+        LSNode *p = this->top, *q;
+        while (p != nullptr) {
+            q = p->next;
+            delete p->data;
+            delete p;
+            p = q;
+        }
+    }
+
+    // 入栈
+    void Push(ElemType *e) {
+        LSNode *p = new LSNode();
+        p->data = e;
+        p->next = this->top;
+        this->top = p;
+    }
+
+
+    // 出栈
+    ElemType *Pop() {
+        if (this->top == nullptr) {
+            return nullptr;
+        }
+        LSNode *p = this->top;
+        ElemType *e = this->top->data;
+        this->top = this->top->next;
+        delete p;
+        return e;
+    }
+
+    // 获取栈顶元素
+    ElemType *GetTop() {
+        if (this->top == nullptr) {
+            return nullptr;
+        }
+        return this->top->data;
+    }
+
+    bool Empty() {
+        return this->top == nullptr;
+    }
+};
+
+/*
+.	待定边缓冲 Pending Edge Buffer
+.	邀请者尚未出现的邀请关系按邀请者ID分桶暂存，邀请者插入时整桶取出，无需重新扫描。
+.	缓冲区按边数设置容量上限，超出时整桶淘汰最早创建的桶。
+*/
+class PendingEdgeBuffer {
+public:
+    // 缓冲区指标
+    struct Metrics {
+        uint64_t pendingCount = 0;      // 当前暂存边数
+        uint64_t bucketCount = 0;       // 当前等待的邀请者数
+        uint64_t parked = 0;            // 累计暂存边数
+        uint64_t resolved = 0;          // 累计取出（邀请者已到达）边数
+        uint64_t evicted = 0;           // 累计因容量淘汰的边数
+        uint64_t oldestAgeRecords = 0;  // 最早桶创建至今经过的记录数
+        double oldestAgeSeconds = 0;    // 最早桶创建至今经过的时间
+    };
+
+    explicit PendingEdgeBuffer(size_t capacity = _DEFAULT_CAPACITY) {
+        this->capacity = std::max(capacity, (size_t) 1);
+    }
+
+    void SetCapacity(size_t capacity) {
+        this->capacity = std::max(capacity, (size_t) 1);
+        _Evict();
+    }
+
+    size_t Capacity() const {
+        return this->capacity;
+    }
+
+    bool Empty() const {
+        return this->buckets.empty();
+    }
+
+    // 暂存一条邀请关系，seq 为当前的记录序号
+    void Park(Uid preID, Uid newID, uint64_t seq) {
+        auto itr = this->buckets.find(preID);
+        if (itr == this->buckets.end()) {
+            Bucket bucket;
+            bucket.firstSeq = seq;
+            bucket.firstTime = std::chrono::steady_clock::now();
+            itr = this->buckets.emplace(preID, std::move(bucket)).first;
+            this->order.emplace_back(seq, preID);
+        }
+        size_t capacity = itr->second.invitees.capacity();
+        itr->second.invitees.push_back(newID);
+        this->iInviteeBytes += (itr->second.invitees.capacity() - capacity) * sizeof(Uid);
+        this->iPendingCount++;
+        this->metrics.parked++;
+        this->iCurrentSeq = seq;
+        _Evict();
+    }
+
+    // 取出等待 preID 的所有被邀请者，无等待时返回 false
+    bool Take(Uid preID, std::vector<Uid> &invitees) {
+        auto itr = this->buckets.find(preID);
+        if (itr == this->buckets.end()) {
+            return false;
+        }
+        invitees = std::move(itr->second.invitees);
+        this->iInviteeBytes -= invitees.capacity() * sizeof(Uid);
+        this->buckets.erase(itr);
+        this->iPendingCount -= invitees.size();
+        this->metrics.resolved += invitees.size();
+        _TrimOrder();
+        return true;
+    }
+
+    Metrics GetMetrics(uint64_t seq) const {
+        Metrics result = this->metrics;
+        result.pendingCount = this->iPendingCount;
+        result.bucketCount = this->buckets.size();
+        // 队头在 _TrimOrder 后总是有效桶
+        if (!this->order.empty()) {
+            const Bucket &oldest = this->buckets.at(this->order.front().second);
+            result.oldestAgeRecords = seq - oldest.firstSeq;
+            result.oldestAgeSeconds = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - oldest.firstTime).count();
+        }
+        return result;
+    }
+
+    void Clear() {
+        this->buckets.clear();
+        this->order.clear();
+        this->iPendingCount = 0;
+        this->iInviteeBytes = 0;
+    }
+
+    // 占用字节数（估算）：哈希表结点与桶数组、被邀请者数组容量、创建顺序队列，代价 O(1)
+    size_t Bytes() const {
+        return this->buckets.size() * (sizeof(std::pair<const Uid, Bucket>) + sizeof(void *)) +
+               this->buckets.bucket_count() * sizeof(void *) + this->iInviteeBytes +
+               this->order.size() * sizeof(std::pair<uint64_t, Uid>);
+    }
+
+private:
+    static const size_t _DEFAULT_CAPACITY = 1 << 20;   // 默认容量：1M 条边
+
+    struct Bucket {
+        std::vector<Uid> invitees;      // 被邀请者ID
+        uint64_t firstSeq = 0;          // 创建时的记录序号
+        std::chrono::steady_clock::time_point firstTime;    // 创建时间
+    };
+
+    size_t capacity;
+    size_t iPendingCount = 0;
+    size_t iInviteeBytes = 0;       // 各桶被邀请者数组的容量字节数
+    uint64_t iCurrentSeq = 0;
+    Metrics metrics;
+    std::unordered_map<Uid, Bucket> buckets;                // 邀请者ID -> 等待桶
+    std::deque<std::pair<uint64_t, Uid>> order;             // 桶创建顺序（序号, 邀请者ID），可能含已取出的失效项
+
+    // 淘汰最早的桶直到不超过容量
+    void _Evict() {
+        while (this->iPendingCount > this->capacity && !this->order.empty()) {
+            auto itr = this->buckets.find(this->order.front().second);
+            this->order.pop_front();
+            this->iPendingCount -= itr->second.invitees.size();
+            this->iInviteeBytes -= itr->second.invitees.capacity() * sizeof(Uid);
+            this->metrics.evicted += itr->second.invitees.size();
+            this->buckets.erase(itr);
+            _TrimOrder();
+        }
+    }
+
+    // 清理队头失效项；失效项过多时整体压缩
+    void _TrimOrder() {
+        while (!this->order.empty() && !_IsLive(this->order.front())) {
+            this->order.pop_front();
+        }
+        if (this->order.size() > 2 * this->buckets.size() + 64) {
+            std::deque<std::pair<uint64_t, Uid>> live;
+            for (const auto &item : this->order) {
+                if (_IsLive(item)) {
+                    live.push_back(item);
+                }
+            }
+            this->order.swap(live);
+        }
+    }
+
+    bool _IsLive(const std::pair<uint64_t, Uid> &item) const {
+        auto itr = this->buckets.find(item.second);
+        return itr != this->buckets.end() && itr->second.firstSeq == item.first;
+    }
+};
+
+/*
+.	深度分区索引 Depth Index
+.	按深度优先序给每个用户分配编号 key，其子树恰好是区间 [key(X), key(last(X))]，last(X) 为子树中深度优先序最后的用户。
+.	每个深度一个分区，按 key 有序存储：用户 X 的第 N 级下级即深度为 depth(X) + N 的分区中
+.	key 落在 (key(X), key(last(X))] 的一段，两次二分查找后连续拷贝，无需逐层遍历。
+.	新用户（叶子）可增量加入：
+.		1.编号为 62 位整数，构建时均匀分布留出间隔，新用户取其深度优先序前驱与后继编号的中点；
+.		  间隔用尽时按对齐的编号区间重新均匀编号（顺序维护表），只改编号、不改各分区中的顺序；
+.		2.新用户先进入所在深度分区的增量表（有序、较小），查询时与分区合并读取，增量表达到分区的 1/8 时并入分区；
+.		3.沿邀请者链更新以其为最后用户的上级的 last。
+.	注：删除用户、移动子树仍需重建（GraphAdjList 在失效期间退回逐层遍历）。
+*/
+class DepthIndex {
+public:
+    // 重建索引：ids 为升序的全部用户，roots 为其中没有邀请者的用户，childrenOf(id, vector&) 按升序追加直接下级
+    template<typename ChildrenOf>
+    void Build(std::vector<Uid> &&ids, const std::vector<Uid> &roots, ChildrenOf &&childrenOf) {
+        Clear();
+        this->vexIDs = std::move(ids);
+        int32_t vexNum = (int32_t) this->vexIDs.size();
+        this->vexKey.assign(vexNum, 0);
+        this->vexPrev.assign(vexNum, -1);
+        this->vexNext.assign(vexNum, -1);
+        this->vexLast.assign(vexNum, 0);
+        this->vexParent.assign(vexNum, -1);
+        this->vexDepth.assign(vexNum, 0);
+
+        // 1.非递归深度优先遍历：进入时按顺序编号并链入顺序表，离开时记录子树中最后的用户
+        int64_t step = _KEY_SPACE / ((int64_t) vexNum + 1);
+        int32_t order = 0, head = -1, tail = -1;
+        struct Frame {
+            int32_t index;
+            bool exit;
+        };
+        std::vector<Frame> stack;
+        std::vector<Uid> children;
+        for (Uid root : roots) {
+            stack.push_back({ _IndexOf(root), false });
+            while (!stack.empty()) {
+                Frame frame = stack.back();
+                stack.pop_back();
+                if (frame.exit) {
+                    this->vexLast[frame.index] = tail;
+                    continue;
+                }
+                this->vexKey[frame.index] = ++order * step;
+                this->vexPrev[frame.index] = tail;
+                if (tail != -1) {
+                    this->vexNext[tail] = frame.index;
+                } else {
+                    head = frame.index;
+                }
+                tail = frame.index;
+                stack.push_back({ frame.index, true });
+
+                // 下级逆序入栈，使 ID 小的下级先访问
+                children.clear();
+                childrenOf(this->vexIDs[frame.index], children);
+                for (auto itr = children.rbegin(); itr != children.rend(); ++itr) {
+                    int32_t index = _IndexOf(*itr);
+                    if (index != -1) {
+                        this->vexParent[index] = frame.index;
+                        this->vexDepth[index] = this->vexDepth[frame.index] + 1;
+                        stack.push_back({ index, false });
+                    }
+                }
+            }
+        }
+
+        // 2.按深度分区：沿顺序表写入，同一深度内天然按编号有序
+        for (int32_t index = head; index != -1; index = this->vexNext[index]) {
+            Level &level = _LevelAt(this->vexDepth[index]);
+            level.keys.push_back(this->vexKey[index]);
+            level.ids.push_back(this->vexIDs[index]);
+        }
+    }
+
+    // 新用户 vertex 作为 parent 的直接下级加入（vertex 尚无下级）；parent 不在索引中或 vertex 已在索引中时返回 false
+    bool AddLeaf(Uid parent, Uid vertex) {
+        int32_t parentIndex = _IndexOf(parent);
+        if (parentIndex == -1 || _IndexOf(vertex) != -1) {
+            return false;
+        }
+        int32_t depth = this->vexDepth[parentIndex] + 1;
+        Level &level = _LevelAt(depth);
+
+        // 1.深度优先序前驱：ID 小于 vertex 的最后一个兄弟的子树末尾，没有时为 parent 本身
+        //   parent 的直接下级即下一深度分区中落在其子树编号区间内的一段，ID 随编号递增
+        int64_t lo = this->vexKey[parentIndex], hi = this->vexKey[this->vexLast[parentIndex]];
+        std::pair<int64_t, Uid> sibling = std::max(_LastBefore(level.keys, level.ids, lo, hi, vertex),
+                                                   _LastBefore(level.deltaKeys, level.deltaIds, lo, hi, vertex));
+        int32_t prev = sibling.first == -1 ? parentIndex : this->vexLast[_IndexOf(sibling.second)];
+
+        // 2.链入顺序表并编号
+        int32_t index = (int32_t) this->vexKey.size();
+        this->addedIndex.emplace(vertex, index);
+        this->vexKey.push_back(0);
+        this->vexPrev.push_back(prev);
+        this->vexNext.push_back(this->vexNext[prev]);
+        this->vexLast.push_back(index);
+        this->vexParent.push_back(parentIndex);
+        this->vexDepth.push_back(depth);
+        if (this->vexNext[prev] != -1) {
+            this->vexPrev[this->vexNext[prev]] = index;
+        }
+        this->vexNext[prev] = index;
+        _AssignKey(index);
+
+        // 3.新用户排在前驱所在的各级子树末尾时，成为这些上级的最后用户
+        for (int32_t itr = parentIndex; itr != -1 && this->vexLast[itr] == prev; itr = this->vexParent[itr]) {
+            this->vexLast[itr] = index;
+        }
+
+        // 4.加入分区的增量表；增量表长度超过分区长度的平方根时并入分区，插入与合并的移动量大致相当
+        int64_t key = this->vexKey[index];
+        size_t pos = std::upper_bound(level.deltaKeys.begin(), level.deltaKeys.end(), key) - level.deltaKeys.begin();
+        level.deltaKeys.insert(level.deltaKeys.begin() + pos, key);
+        level.deltaIds.insert(level.deltaIds.begin() + pos, vertex);
+        if (level.deltaKeys.size() > std::max(_DELTA_MIN, (size_t) std::sqrt((double) level.keys.size()))) {
+            _MergeDelta(level);
+        }
+        return true;
+    }
+
+    // 用户的第 n 级下级（n >= 1），顺序与逐层广度优先遍历相同；用户不在索引中时返回 false
+    bool GetLevel(Uid vertex, int32_t n, std::vector<Uid> &result) const {
+        int32_t index = _IndexOf(vertex);
+        if (index == -1) {
+            return false;
+        }
+        int32_t depth = this->vexDepth[index] + n;
+        if (n < 1 || depth >= (int32_t) this->levels.size()) {
+            return true;
+        }
+        _VisitRange(this->levels[depth], this->vexKey[index], this->vexKey[this->vexLast[index]],
+                    [&result](const Uid *first, const Uid *last) {
+                        result.insert(result.end(), first, last);
+                    });
+        return true;
+    }
+
+    // 按等级依次访问用户及其全部下级，每个用户调用一次 visit(id, level)，vertex 为第 0 级；用户不在索引中时返回 false
+    // 每一级为所在深度分区中的一段连续区间（及增量表中的一段），整个遍历基本为顺序读
+    template<typename Visitor>
+    bool VisitDownline(Uid vertex, Visitor &&visit) const {
+        int32_t index = _IndexOf(vertex);
+        if (index == -1) {
+            return false;
+        }
+        visit(vertex, 0);
+        int64_t lo = this->vexKey[index], hi = this->vexKey[this->vexLast[index]];
+        for (int32_t level = 1, depth = this->vexDepth[index] + 1; depth < (int32_t) this->levels.size(); level++, depth++) {
+            bool found = false;
+            _VisitRange(this->levels[depth], lo, hi, [&](const Uid *first, const Uid *last) {
+                for (; first != last; ++first) {
+                    visit(*first, level);
+                }
+                found = true;
+            });
+            if (!found) {
+                break;
+            }
+        }
+        return true;
+    }
+
+    // 索引占用的字节数（构建后加入的用户的哈希表按每项约 32 字节估算）
+    size_t Bytes() const {
+        size_t bytes = sizeof(Uid) * this->vexIDs.capacity() + sizeof(int64_t) * this->vexKey.capacity() +
+                       sizeof(int32_t) * (this->vexPrev.capacity() + this->vexNext.capacity() + this->vexLast.capacity() +
+                                          this->vexParent.capacity() + this->vexDepth.capacity()) +
+                       this->addedIndex.size() * 32 + this->addedIndex.bucket_count() * sizeof(void *) +
+                       sizeof(Level) * this->levels.capacity();
+        for (const Level &level : this->levels) {
+            bytes += sizeof(int64_t) * (level.keys.capacity() + level.deltaKeys.capacity()) +
+                     sizeof(Uid) * (level.ids.capacity() + level.deltaIds.capacity());
+        }
+        return bytes;
+    }
+
+    void Clear() {
+        std::vector<Uid>().swap(this->vexIDs);
+        std::unordered_map<Uid, int32_t>().swap(this->addedIndex);
+        std::vector<int64_t>().swap(this->vexKey);
+        std::vector<int32_t>().swap(this->vexPrev);
+        std::vector<int32_t>().swap(this->vexNext);
+        std::vector<int32_t>().swap(this->vexLast);
+        std::vector<int32_t>().swap(this->vexParent);
+        std::vector<int32_t>().swap(this->vexDepth);
+        std::vector<Level>().swap(this->levels);
+    }
+
+private:
+    static constexpr int64_t _KEY_SPACE = (int64_t) 1 << 62;   // 编号范围 [0, 2^62)
+    static constexpr double _RELABEL_DENSITY = 1.6;            // 长 2^i 的编号区间最多容纳 1.6^i 个用户，超过时扩大区间
+    static constexpr size_t _DELTA_MIN = 256;                  // 增量表并入分区的最小长度
+
+    // 一个深度的分区：按编号有序的编号与用户ID，以及尚未并入的增量表
+    struct Level {
+        std::vector<int64_t> keys;
+        std::vector<Uid> ids;
+        std::vector<int64_t> deltaKeys;
+        std::vector<Uid> deltaIds;
+    };
+
+    std::vector<Uid> vexIDs;            // 构建时的全部用户ID（升序），下标即用户下标
+    std::unordered_map<Uid, int32_t> addedIndex;    // 构建后加入的用户 -> 下标（从 vexIDs.size() 起）
+    std::vector<int64_t> vexKey;        // 深度优先序编号，以下数组均按用户下标
+    std::vector<int32_t> vexPrev;       // 顺序表中的前一个用户，-1 表示没有
+    std::vector<int32_t> vexNext;       // 顺序表中的后一个用户，-1 表示没有
+    std::vector<int32_t> vexLast;       // 子树中深度优先序最后的用户
+    std::vector<int32_t> vexParent;     // 邀请者，-1 表示根用户
+    std::vector<int32_t> vexDepth;      // 深度，根用户为 0
+    std::vector<Level> levels;          // 各深度的分区
+
+    int32_t _IndexOf(Uid vertex) const {
+        auto itr = std::lower_bound(this->vexIDs.begin(), this->vexIDs.end(), vertex);
+        if (itr != this->vexIDs.end() && *itr == vertex) {
+            return (int32_t) (itr - this->vexIDs.begin());
+        }
+        if (this->addedIndex.empty()) {
+            return -1;
+        }
+        auto added = this->addedIndex.find(vertex);
+        return added == this->addedIndex.end() ? -1 : added->second;
+    }
+
+    Level &_LevelAt(int32_t depth) {
+        if (depth >= (int32_t) this->levels.size()) {
+            this->levels.resize(depth + 1);
+        }
+        return this->levels[depth];
+    }
+
+    // 有序编号数组中落在 (lo, hi] 的一段
+    static std::pair<size_t, size_t> _Range(const std::vector<int64_t> &keys, int64_t lo, int64_t hi) {
+        auto first = std::upper_bound(keys.begin(), keys.end(), lo);
+        auto last = std::upper_bound(first, keys.end(), hi);
+        return { first - keys.begin(), last - keys.begin() };
+    }
+
+    // 按编号顺序访问分区与增量表中编号落在 (lo, hi] 的用户，visit(first, last) 每次接收一段连续的用户ID
+    template<typename Visitor>
+    static void _VisitRange(const Level &level, int64_t lo, int64_t hi, Visitor &&visit) {
+        auto [first, last] = _Range(level.keys, lo, hi);
+        auto [deltaFirst, deltaLast] = _Range(level.deltaKeys, lo, hi);
+        while (deltaFirst < deltaLast) {
+            // 分区中排在下一个增量用户之前的一段
+            size_t end = std::upper_bound(level.keys.begin() + first, level.keys.begin() + last, level.deltaKeys[deltaFirst]) -
+                         level.keys.begin();
+            if (first < end) {
+                visit(level.ids.data() + first, level.ids.data() + end);
+            }
+            visit(level.deltaIds.data() + deltaFirst, level.deltaIds.data() + deltaFirst + 1);
+            first = end;
+            deltaFirst++;
+        }
+        if (first < last) {
+            visit(level.ids.data() + first, level.ids.data() + last);
+        }
+    }
+
+    // 编号区间 (lo, hi] 内的兄弟（ID 随编号递增）中 ID 小于 vertex 的最后一个：(编号, ID)，没有时编号为 -1
+    static std::pair<int64_t, Uid> _LastBefore(const std::vector<int64_t> &keys, const std::vector<Uid> &ids, int64_t lo,
+                                               int64_t hi, Uid vertex) {
+        auto [first, last] = _Range(keys, lo, hi);
+        size_t pos = std::lower_bound(ids.begin() + first, ids.begin() + last, vertex) - ids.begin();
+        return pos > first ? std::make_pair(keys[pos - 1], ids[pos - 1]) : std::make_pair((int64_t) -1, (Uid) 0);
+    }
+
+    // 给刚链入顺序表的用户编号：取前后两个用户编号的中点，间隔用尽时重新编号
+    void _AssignKey(int32_t index) {
+        int32_t prev = this->vexPrev[index], next = this->vexNext[index];
+        int64_t lo = prev == -1 ? -1 : this->vexKey[prev];
+        int64_t hi = next == -1 ? _KEY_SPACE : this->vexKey[next];
+        if (hi - lo >= 2) {
+            this->vexKey[index] = lo + (hi - lo) / 2;
+            return;
+        }
+
+        // 从长 2 的对齐编号区间开始逐次加倍，直到区间内的用户（含新用户）足够稀疏，再在区间内均匀编号；
+        // 编号沿顺序表单调，区间内的用户是顺序表中包含新用户的连续一段 [first, last]
+        int64_t anchor = prev == -1 ? hi : lo;
+        int32_t first = index, last = index;
+        int64_t count = 1;
+        double capacity = 1.0;
+        for (int32_t bits = 1; bits <= 62; bits++) {
+            capacity *= _RELABEL_DENSITY;
+            int64_t base = anchor & ~(((int64_t) 1 << bits) - 1);
+            int64_t end = base + ((int64_t) 1 << bits);
+            for (; this->vexPrev[first] != -1 && this->vexKey[this->vexPrev[first]] >= base; count++) {
+                first = this->vexPrev[first];
+            }
+            for (; this->vexNext[last] != -1 && this->vexKey[this->vexNext[last]] < end; count++) {
+                last = this->vexNext[last];
+            }
+            if ((double) count <= capacity) {
+                _Relabel(index, first, last, base, (end - base) / count);
+                return;
+            }
+        }
+    }
+
+    // 将顺序表中 [first, last] 一段依次编号为 base, base + step, ...，并同步各分区中的编号（新用户 added 尚未加入分区）
+    // 重新编号不改变相对顺序，分区仍然有序；先按旧编号找到全部位置，再统一写入
+    void _Relabel(int32_t added, int32_t first, int32_t last, int64_t base, int64_t step) {
+        std::vector<int64_t *> slots;
+        for (int32_t itr = first;; itr = this->vexNext[itr]) {
+            if (itr != added) {
+                Level &level = this->levels[this->vexDepth[itr]];
+                auto pos = std::lower_bound(level.keys.begin(), level.keys.end(), this->vexKey[itr]);
+                if (pos == level.keys.end() || *pos != this->vexKey[itr]) {
+                    pos = std::lower_bound(level.deltaKeys.begin(), level.deltaKeys.end(), this->vexKey[itr]);
+                }
+                slots.push_back(&*pos);
+            }
+            if (itr == last) {
+                break;
+            }
+        }
+        size_t slot = 0;
+        int64_t key = base;
+        for (int32_t itr = first;; itr = this->vexNext[itr], key += step) {
+            this->vexKey[itr] = key;
+            if (itr != added) {
+                *slots[slot++] = key;
+            }
+            if (itr == last) {
+                break;
+            }
+        }
+    }
+
+    // 增量表并入分区
+    static void _MergeDelta(Level &level) {
+        std::vector<int64_t> keys(level.keys.size() + level.deltaKeys.size());
+        std::vector<Uid> ids(keys.size());
+        size_t i = 0, j = 0;
+        for (size_t k = 0; k < keys.size(); k++) {
+            if (j == level.deltaKeys.size() || (i < level.keys.size() && level.keys[i] < level.deltaKeys[j])) {
+                keys[k] = level.keys[i];
+                ids[k] = level.ids[i++];
+            } else {
+                keys[k] = level.deltaKeys[j];
+                ids[k] = level.deltaIds[j++];
+            }
+        }
+        level.keys.swap(keys);
+        level.ids.swap(ids);
+        level.deltaKeys.clear();
+        level.deltaIds.clear();
+    }
+};
+/*
+.	查询结果缓存 Query Cache
+.	缓存第 N 级下级与全部下级的查询结果，键为 (用户, 等级)，等级 0 表示全部下级；按占用字节数限容，超出时淘汰最久未使用的结果。
+.	失效是精确的：用户 X 新增直接下级 Y 时，只有 X 的各级上级在 Y 所在等级的结果（及其全部下级结果）会变化。
+.	沿 preID 链自 X 向上，距 X 为 d 的上级失效其第 d + 1 级结果；Y 带有下级（移动子树）或删除关系时失效第 d + 1 级及更深的结果。
+.	注：命中也会调整淘汰顺序，查询时会修改缓存。
+*/
+class QueryCache {
+public:
+    static constexpr int32_t DOWNLINE = 0;              // 全部下级结果的等级
+
+    // 缓存指标
+    struct Metrics {
+        uint64_t hits = 0;                  // 命中次数
+        uint64_t misses = 0;                // 未命中次数
+        uint64_t stores = 0;                // 存入结果数
+        uint64_t evictions = 0;             // 因容量淘汰的结果数
+        uint64_t invalidations = 0;         // 失效检查次数（每次关系变化一次）
+        uint64_t invalidationSteps = 0;     // 失效检查沿 preID 链访问的上级数
+        uint64_t invalidatedEntries = 0;    // 失效的结果数
+        double invalidationSeconds = 0;     // 失效检查累计耗时
+        uint64_t entryCount = 0;            // 当前结果数
+        uint64_t bytes = 0;                 // 当前占用字节数（估算）
+        uint64_t capacity = 0;              // 容量（字节）
+
+        double HitRate() const {
+            return this->hits + this->misses > 0 ? (double) this->hits / (double) (this->hits + this->misses) : 0.0;
+        }
+    };
+
+    explicit QueryCache(size_t capacity = 0) {
+        this->capacity = capacity;
+    }
+
+    // 设置容量（字节），为 0 时关闭缓存并清空
+    void SetCapacity(size_t capacity) {
+        this->capacity = capacity;
+        _Evict();
+    }
+
+    bool Enabled() const {
+        return this->capacity > 0;
+    }
+
+    bool Empty() const {
+        return this->lru.empty();
+    }
+
+    // 查找第 level 级下级，命中时覆盖写入 result 并返回 true
+    bool Find(Uid root, int32_t level, std::vector<Uid> &result) {
+        Entry *entry = _Touch(root, level);
+        if (entry == nullptr) {
+            return false;
+        }
+        result = entry->ids;
+        return true;
+    }
+
+    // 查找全部下级，命中时覆盖写入 levels 并返回 true
+    bool Find(Uid root, std::vector<std::vector<Uid>> &levels) {
+        Entry *entry = _Touch(root, DOWNLINE);
+        if (entry == nullptr) {
+            return false;
+        }
+        levels.resize(entry->offsets.size() - 1);
+        for (size_t i = 0; i + 1 < entry->offsets.size(); i++) {
+            levels[i].assign(entry->ids.begin() + entry->offsets[i], entry->ids.begin() + entry->offsets[i + 1]);
+        }
+        return true;
+    }
+
+    void Store(Uid root, int32_t level, const std::vector<Uid> &result) {
+        _Store(root, level, std::vector<Uid>(result), {});
+    }
+
+    void Store(Uid root, const std::vector<std::vector<Uid>> &levels) {
+        std::vector<Uid> ids;
+        std::vector<uint32_t> offsets = { 0 };
+        for (const std::vector<Uid> &level : levels) {
+            ids.insert(ids.end(), level.begin(), level.end());
+            offsets.push_back((uint32_t) ids.size());
+        }
+        _Store(root, DOWNLINE, std::move(ids), std::move(offsets));
+    }
+
+    // vertex 新增或删除直接下级 child 后调用：parentOf(id) 返回 id 的邀请者（没有时为 NO_UID）
+    // subtree 为 false 表示 child 没有下级，只影响各上级的一个等级
+    // 距离 child 为 d 的上级只有等级 >= d 的结果和全部下级结果可能失效：没有全部下级结果时，上溯到缓存中的最大等级即停止
+    template<typename ParentOf>
+    void Invalidate(Uid vertex, bool subtree, ParentOf &&parentOf) {
+        if (this->lru.empty()) {
+            return;
+        }
+        auto start = std::chrono::steady_clock::now();
+        this->metrics.invalidations++;
+        int32_t level = 1;
+        for (Uid id = vertex; id != NO_UID && !this->lru.empty(); id = parentOf(id), level++) {
+            if (this->iDownlineEntries == 0 && level > this->levelEntries.rbegin()->first) {
+                break;
+            }
+            this->metrics.invalidationSteps++;
+            auto itr = this->roots.find(id);
+            if (itr == this->roots.end()) {
+                continue;
+            }
+            std::vector<std::list<Entry>::iterator> &entries = itr->second;
+            for (size_t i = 0; i < entries.size();) {
+                int32_t entryLevel = entries[i]->level;
+                if (entryLevel == DOWNLINE || entryLevel == level || (subtree && entryLevel > level)) {
+                    _Erase(entries, i);
+                    this->metrics.invalidatedEntries++;
+                } else {
+                    i++;
+                }
+            }
+            if (entries.empty()) {
+                this->roots.erase(itr);
+            }
+        }
+        this->metrics.invalidationSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // 删除用户时调用：以其为根的全部结果失效
+    void InvalidateRoot(Uid root) {
+        auto itr = this->roots.find(root);
+        if (itr == this->roots.end()) {
+            return;
+        }
+        std::vector<std::list<Entry>::iterator> &entries = itr->second;
+        this->metrics.invalidatedEntries += entries.size();
+        while (!entries.empty()) {
+            _Erase(entries, entries.size() - 1);
+        }
+        this->roots.erase(itr);
+    }
+
+    void Clear() {
+        this->lru.clear();
+        this->roots.clear();
+        this->levelEntries.clear();
+        this->iDownlineEntries = 0;
+        this->iBytes = 0;
+    }
+
+    size_t Bytes() const {
+        return this->iBytes;
+    }
+
+    Metrics GetMetrics() const {
+        Metrics result = this->metrics;
+        result.entryCount = this->lru.size();
+        result.bytes = this->iBytes;
+        result.capacity = this->capacity;
+        return result;
+    }
+
+private:
+    static constexpr size_t _ENTRY_OVERHEAD = 96;       // 每个结果的链表结点、索引项等固定开销（估算）
+
+    struct Entry {
+        Uid root;
+        int32_t level;
+        std::vector<Uid> ids;               // 结果（全部下级时按层依次存放）
+        std::vector<uint32_t> offsets;      // 全部下级：第 i 层为 ids[offsets[i], offsets[i + 1])
+        size_t bytes;
+    };
+
+    size_t capacity;
+    size_t iBytes = 0;
+    Metrics metrics;
+    std::list<Entry> lru;                                                   // 最近使用的在前
+    std::unordered_map<Uid, std::vector<std::list<Entry>::iterator>> roots;   // 用户 -> 以其为根的结果
+    std::map<int32_t, uint32_t> levelEntries;                               // 第 n 级结果：等级 -> 结果数
+    uint64_t iDownlineEntries = 0;                                          // 全部下级结果数
+
+    Entry *_Touch(Uid root, int32_t level) {
+        auto itr = this->roots.find(root);
+        if (itr != this->roots.end()) {
+            for (std::list<Entry>::iterator entry : itr->second) {
+                if (entry->level == level) {
+                    this->lru.splice(this->lru.begin(), this->lru, entry);
+                    this->metrics.hits++;
+                    return &*entry;
+                }
+            }
+        }
+        this->metrics.misses++;
+        return nullptr;
+    }
+
+    void _Store(Uid root, int32_t level, std::vector<Uid> &&ids, std::vector<uint32_t> &&offsets) {
+        size_t bytes = _ENTRY_OVERHEAD + ids.size() * sizeof(Uid) + offsets.size() * sizeof(uint32_t);
+        if (bytes > this->capacity) {
+            return;
+        }
+        std::vector<std::list<Entry>::iterator> &entries = this->roots[root];
+        for (size_t i = 0; i < entries.size(); i++) {
+            if (entries[i]->level == level) {
+                _Erase(entries, i);
+                break;
+            }
+        }
+        this->lru.push_front({ root, level, std::move(ids), std::move(offsets), bytes });
+        entries.push_back(this->lru.begin());
+        _CountLevel(level, 1);
+        this->iBytes += bytes;
+        this->metrics.stores++;
+        _Evict();
+    }
+
+    // 从结果链表和 entries 中删除 entries[i]，不删除空的 entries
+    void _Erase(std::vector<std::list<Entry>::iterator> &entries, size_t i) {
+        _CountLevel(entries[i]->level, -1);
+        this->iBytes -= entries[i]->bytes;
+        this->lru.erase(entries[i]);
+        entries[i] = entries.back();
+        entries.pop_back();
+    }
+
+    // 按等级计数结果，sign 为 1 表示存入，-1 表示删除
+    void _CountLevel(int32_t level, int32_t sign) {
+        if (level == DOWNLINE) {
+            this->iDownlineEntries += sign;
+            return;
+        }
+        auto itr = this->levelEntries.try_emplace(level, 0).first;
+        itr->second += sign;
+        if (itr->second == 0) {
+            this->levelEntries.erase(itr);
+        }
+    }
+
+    // 淘汰最久未使用的结果直到不超过容量
+    void _Evict() {
+        while (this->iBytes > this->capacity && !this->lru.empty()) {
+            Entry &oldest = this->lru.back();
+            auto itr = this->roots.find(oldest.root);
+            std::vector<std::list<Entry>::iterator> &entries = itr->second;
+            for (size_t i = 0; i < entries.size(); i++) {
+                if (&*entries[i] == &oldest) {
+                    _Erase(entries, i);
+                    break;
+                }
+            }
+            if (entries.empty()) {
+                this->roots.erase(itr);
+            }
+            this->metrics.evictions++;
+        }
+    }
+};
+
+/*
+.	压缩邻接表 Compressed Adjacency
+.	只读快照，用于冷数据存储与离线遍历。用户ID升序排列，每个用户的下级列表连续存储在一个字节流中：
+.		1.下级个数（varint）；
+.		2.不超过 BLOCK_SIZE 个下级：首个下级与本用户ID之差（zigzag varint），随后为一个数据块；
+.		  超过时：先是跳表，每块一项（块首下级ID sizeof(Uid) 字节、块相对偏移 4 字节），随后依次为各数据块；
+.		3.数据块：相邻下级ID之差减 1 按块内最大位宽打包（1 字节位宽 + 按位连续存储），单个下级的块为空。
+.	解码时按位宽解包后做前缀和（32 位用户ID且支持 SSE2 时每次 4 个），结果直接追加到调用者的广度优先遍历队列中。
+*/
+class CompressedAdjacency {
+public:
+    static constexpr int32_t BLOCK_SIZE = 128;  // 每个数据块的最大下级数
+    static constexpr int32_t SKIP_ENTRY = sizeof(Uid) + sizeof(uint32_t);    // 跳表每项字节数
+
+    // 追加一个用户及其按升序排列的直接下级，用户须按ID升序追加
+    // 编码后字节流超过 4GB（偏移无法用 uint32_t 表示）时撤销本次追加并返回 false，已追加的部分仍可 Finish
+    bool Add(Uid vertex, std::span<const Uid> children) {
+        size_t offset = this->data.size();
+        _EncodeList(vertex, children);
+        if (this->data.size() > UINT32_MAX) {
+            this->data.resize(offset);
+            return false;
+        }
+        this->vexIndex.Add(vertex);
+        this->vexOffset.push_back((uint32_t) offset);
+        this->iEdgeNum += (int64_t) children.size();
+        return true;
+    }
+
+    // 结束构建：补齐末尾偏移与解码时越界读取所需的填充字节
+    void Finish() {
+        this->vexOffset.push_back((uint32_t) this->data.size());
+        this->data.resize(this->data.size() + sizeof(BitWord), 0);
+        this->vexIndex.Finish();
+        this->vexOffset.shrink_to_fit();
+        this->data.shrink_to_fit();
+    }
+
+    // 将用户的直接下级（升序）追加到 children，用户不存在时返回 false
+    bool AppendChildren(Uid vertex, std::vector<Uid> &children) const {
+        int32_t index = _IndexOf(vertex);
+        if (index == -1) {
+            return false;
+        }
+        _DecodeList(index, children);
+        return true;
+    }
+
+    // 是否存在边 vertex -> child：通过跳表只解码一个数据块
+    bool Contains(Uid vertex, Uid child) const {
+        int32_t index = _IndexOf(vertex);
+        if (index == -1 || this->vexOffset[index] == this->vexOffset[index + 1]) {
+            return false;
+        }
+        const uint8_t *p = this->data.data() + this->vexOffset[index];
+        int32_t count = (int32_t) _GetVarint(p);
+        Uid block[BLOCK_SIZE];
+        if (count <= BLOCK_SIZE) {
+            Uid first = (Uid) ((UnsignedUid) vertex + _UnZigZag(_GetVarint(p)));
+            _DecodeBlock(p, first, count, block);
+            return std::binary_search(block, block + count, child);
+        }
+
+        // 跳表中最后一个块首不大于 child 的块
+        int32_t blockNum = (count + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        const uint8_t *skip = p, *base = p + SKIP_ENTRY * blockNum;
+        int32_t lo = 0, hi = blockNum - 1;
+        while (lo < hi) {
+            int32_t mid = (lo + hi + 1) / 2;
+            if (_SkipFirst(skip, mid) <= child) {
+                lo = mid;
+            } else {
+                hi = mid - 1;
+            }
+        }
+        Uid first = _SkipFirst(skip, lo);
+        if (child < first) {
+            return false;
+        }
+        int32_t blockCount = std::min(BLOCK_SIZE, count - lo * BLOCK_SIZE);
+        _DecodeBlock(base + _SkipOffset(skip, lo), first, blockCount, block);
+        return std::binary_search(block, block + blockCount, child);
+    }
+
+    // 用户的第 n 级下级（n >= 1），顺序与图的逐层遍历相同
+    std::vector<Uid> GetNthLevel(Uid vertex, int32_t n) const {
+        std::vector<Uid> frontier;
+        if (n < 1 || _IndexOf(vertex) == -1) {
+            return frontier;
+        }
+        frontier.push_back(vertex);
+        std::vector<Uid> next;
+        for (int32_t level = 0; level < n && !frontier.empty(); level++) {
+            next.clear();
+            for (Uid id : frontier) {
+                AppendChildren(id, next);
+            }
+            frontier.swap(next);
+        }
+        return frontier;
+    }
+
+    // 用户的所有下级，按邀请等级分层
+    std::vector<std::vector<Uid>> GetDownline(Uid vertex) const {
+        std::vector<std::vector<Uid>> levels;
+        if (_IndexOf(vertex) == -1) {
+            return levels;
+        }
+        std::vector<Uid> frontier = { vertex };
+        while (true) {
+            std::vector<Uid> next;
+            for (Uid id : frontier) {
+                AppendChildren(id, next);
+            }
+            if (next.empty()) {
+                break;
+            }
+            levels.push_back(next);
+            frontier.swap(next);
+        }
+        return levels;
+    }
+
+    int32_t GetVexNum() const {
+        return (int32_t) this->vexIndex.Size();
+    }
+
+    int64_t GetEdgeNum() const {
+        return this->iEdgeNum;
+    }
+
+    // 快照占用的字节数：用户ID、偏移与字节流
+    size_t Bytes() const {
+        return this->vexIndex.Bytes() + sizeof(uint32_t) * this->vexOffset.capacity() +
+               this->data.capacity();
+    }
+
+    void Clear() {
+        this->vexIndex.Clear();
+        std::vector<uint32_t>().swap(this->vexOffset);
+        std::vector<uint8_t>().swap(this->data);
+        this->iEdgeNum = 0;
+    }
+
+private:
+    StaticKeyIndex<Uid> vexIndex;       // 用户ID（升序），静态搜索树
+    std::vector<uint32_t> vexOffset;    // 每个用户下级列表在字节流中的起始偏移，末尾多一项；相邻偏移相等表示没有下级
+    std::vector<uint8_t> data;          // 字节流
+    int64_t iEdgeNum = 0;               // 边数
+
+    using UnsignedUid = std::make_unsigned_t<Uid>;
+    // 解包位宽可达用户ID位数：一次读取的字要能容纳最多 7 位的偏移加一个差值
+    using BitWord = std::conditional_t<sizeof(Uid) == sizeof(int64_t), unsigned __int128, uint64_t>;
+
+    int32_t _IndexOf(Uid vertex) const {
+        return (int32_t) this->vexIndex.Find(vertex);
+    }
+
+    void _PutVarint(uint64_t value) {
+        while (value >= 0x80) {
+            this->data.push_back((uint8_t) (value | 0x80));
+            value >>= 7;
+        }
+        this->data.push_back((uint8_t) value);
+    }
+
+    static uint64_t _GetVarint(const uint8_t *&p) {
+        uint64_t value = 0;
+        for (int32_t shift = 0;; shift += 7) {
+            uint8_t byte = *p++;
+            value |= (uint64_t) (byte & 0x7F) << shift;
+            if (byte < 0x80) {
+                return value;
+            }
+        }
+    }
+
+    static UnsignedUid _ZigZag(Uid value) {
+        return ((UnsignedUid) value << 1) ^ (UnsignedUid) (value >> (sizeof(Uid) * 8 - 1));
+    }
+
+    static UnsignedUid _UnZigZag(uint64_t value) {
+        UnsignedUid v = (UnsignedUid) value;
+        return (v >> 1) ^ (0 - (v & 1));
+    }
+
+    static Uid _SkipFirst(const uint8_t *skip, int32_t block) {
+        Uid first;
+        std::memcpy(&first, skip + SKIP_ENTRY * block, sizeof(first));
+        return first;
+    }
+
+    static uint32_t _SkipOffset(const uint8_t *skip, int32_t block) {
+        uint32_t offset;
+        std::memcpy(&offset, skip + SKIP_ENTRY * block + sizeof(Uid), sizeof(offset));
+        return offset;
+    }
+
+    void _EncodeList(Uid vertex, std::span<const Uid> children) {
+        int32_t count = (int32_t) children.size();
+        if (count == 0) {
+            return;
+        }
+        _PutVarint((uint32_t) count);
+        if (count <= BLOCK_SIZE) {
+            _PutVarint(_ZigZag((Uid) ((UnsignedUid) children[0] - (UnsignedUid) vertex)));
+            _EncodeBlock(children.data(), count);
+            return;
+        }
+
+        int32_t blockNum = (count + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        size_t skip = this->data.size();
+        this->data.resize(skip + SKIP_ENTRY * blockNum);
+        size_t base = this->data.size();
+        for (int32_t b = 0; b < blockNum; b++) {
+            Uid first = children[b * BLOCK_SIZE];
+            uint32_t offset = (uint32_t) (this->data.size() - base);
+            std::memcpy(this->data.data() + skip + SKIP_ENTRY * b, &first, sizeof(first));
+            std::memcpy(this->data.data() + skip + SKIP_ENTRY * b + sizeof(Uid), &offset, sizeof(offset));
+            _EncodeBlock(children.data() + b * BLOCK_SIZE, std::min(BLOCK_SIZE, count - b * BLOCK_SIZE));
+        }
+    }
+
+    // 数据块：相邻差值减 1，按最大位宽从低位开始连续打包
+    void _EncodeBlock(const Uid *values, int32_t count) {
+        if (count <= 1) {
+            return;
+        }
+        UnsignedUid gaps[BLOCK_SIZE];
+        UnsignedUid maxGap = 0;
+        for (int32_t i = 1; i < count; i++) {
+            gaps[i - 1] = (UnsignedUid) values[i] - (UnsignedUid) values[i - 1] - 1;
+            maxGap |= gaps[i - 1];
+        }
+        int32_t width = (int32_t) std::bit_width(maxGap);
+        this->data.push_back((uint8_t) width);
+
+        BitWord buffer = 0;
+        int32_t bits = 0;
+        for (int32_t i = 0; i < count - 1; i++) {
+            buffer |= (BitWord) gaps[i] << bits;
+            bits += width;
+            while (bits >= 8) {
+                this->data.push_back((uint8_t) buffer);
+                buffer >>= 8;
+                bits -= 8;
+            }
+        }
+        if (bits > 0) {
+            this->data.push_back((uint8_t) buffer);
+        }
+    }
+
+    // 解码一个数据块到 out，返回块后的位置
+    static const uint8_t *_DecodeBlock(const uint8_t *p, Uid first, int32_t count, Uid *out) {
+        out[0] = first;
+        if (count <= 1) {
+            return p;
+        }
+        int32_t width = *p++;
+        int32_t gapNum = count - 1;
+        UnsignedUid gaps[BLOCK_SIZE];
+        if (width == 0) {
+            std::fill(gaps, gaps + gapNum, 0);
+        } else {
+            BitWord mask = ((BitWord) 1 << width) - 1;
+            for (int32_t i = 0; i < gapNum; i++) {
+                int32_t bitPos = i * width;
+                BitWord word;
+                std::memcpy(&word, p + (bitPos >> 3), sizeof(word));
+                gaps[i] = (UnsignedUid) ((word >> (bitPos & 7)) & mask);
+            }
+        }
+
+        // 前缀和：out[i] = out[i - 1] + gaps[i - 1] + 1
+        int32_t i = 1;
+#if defined(__SSE2__) && !INVITE_UID_64
+        __m128i one = _mm_set1_epi32(1);
+        __m128i prev = _mm_set1_epi32(first);
+        for (; i + 4 <= count; i += 4) {
+            __m128i v = _mm_add_epi32(_mm_loadu_si128((const __m128i *) (gaps + i - 1)), one);
+            v = _mm_add_epi32(v, _mm_slli_si128(v, 4));
+            v = _mm_add_epi32(v, _mm_slli_si128(v, 8));
+            v = _mm_add_epi32(v, prev);
+            _mm_storeu_si128((__m128i *) (out + i), v);
+            prev = _mm_shuffle_epi32(v, 0xFF);
+        }
+#endif
+        for (; i < count; i++) {
+            out[i] = (Uid) ((UnsignedUid) out[i - 1] + gaps[i - 1] + 1);
+        }
+        return p + ((int64_t) gapNum * width + 7) / 8;
+    }
+
+    void _DecodeList(int32_t index, std::vector<Uid> &children) const {
+        if (this->vexOffset[index] == this->vexOffset[index + 1]) {
+            return;
+        }
+        const uint8_t *p = this->data.data() + this->vexOffset[index];
+        int32_t count = (int32_t) _GetVarint(p);
+        size_t oldSize = children.size();
+        children.resize(oldSize + count);
+        Uid *out = children.data() + oldSize;
+        if (count <= BLOCK_SIZE) {
+            Uid first = (Uid) ((UnsignedUid) this->vexIndex.Key(index) + _UnZigZag(_GetVarint(p)));
+            _DecodeBlock(p, first, count, out);
+            return;
+        }
+        int32_t blockNum = (count + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        const uint8_t *skip = p, *base = p + SKIP_ENTRY * blockNum;
+        for (int32_t b = 0; b < blockNum; b++) {
+            _DecodeBlock(base + _SkipOffset(skip, b), _SkipFirst(skip, b), std::min(BLOCK_SIZE, count - b * BLOCK_SIZE),
+                         out + b * BLOCK_SIZE);
+        }
+    }
+};
+
+/*
+.	遍历输出 Traversal Sinks
+.	图的遍历接受任意可调用对象作为访问者，每个用户调用一次；以下为常用的输出端：
+.		1.ConsoleSink：写入输出流，每个ID后跟分隔符，不逐个刷新；
+.		2.BufferedFileSink：在缓冲区中格式化ID，缓冲区满时一次 write 写入文件；
+.		3.IteratorSink：写入输出迭代器，如 std::back_inserter(vector)。
+*/
+class ConsoleSink {
+public:
+    explicit ConsoleSink(std::ostream &out = std::cout, char delimiter = ' ') : out(out), delimiter(delimiter) {
+    }
+
+    void operator()(Uid id) {
+        this->out << id << this->delimiter;
+    }
+
+private:
+    std::ostream &out;
+    char delimiter;
+};
+
+class BufferedFileSink {
+public:
+    static constexpr size_t BUFFER_SIZE = 1 << 20;
+
+    explicit BufferedFileSink(const char *path, char delimiter = '\n') : delimiter(delimiter) {
+        this->iFd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        this->buffer.reset(new char[BUFFER_SIZE]);
+    }
+
+    ~BufferedFileSink() {
+        Close();
+    }
+
+    BufferedFileSink(const BufferedFileSink &) = delete;
+    BufferedFileSink &operator=(const BufferedFileSink &) = delete;
+
+    void operator()(Uid id) {
+        // 最长为符号、20 位数字与分隔符
+        if (this->iLength + 22 > BUFFER_SIZE) {
+            Flush();
+        }
+        char *p = this->buffer.get() + this->iLength;
+        uint64_t value = (uint64_t) (int64_t) id;
+        if (id < 0) {
+            *p++ = '-';
+            value = 0 - value;
+        }
+
+        // 数字从低位到高位写入临时区，再顺序拷贝
+        char digits[20];
+        int32_t n = 0;
+        do {
+            digits[n++] = (char) ('0' + value % 10);
+            value /= 10;
+        } while (value != 0);
+        while (n > 0) {
+            *p++ = digits[--n];
+        }
+        *p++ = this->delimiter;
+        this->iLength = (size_t) (p - this->buffer.get());
+    }
+
+    // 写出缓冲区，被信号中断时重试；失败后不再写入
+    bool Flush() {
+        const char *p = this->buffer.get();
+        size_t remaining = this->iLength;
+        while (remaining > 0 && Good()) {
+            ssize_t written = ::write(this->iFd, p, remaining);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                this->bFailed = true;
+                break;
+            }
+            p += written;
+            remaining -= (size_t) written;
+        }
+        this->iBytes += this->iLength - remaining;
+        this->iLength = 0;
+        return Good();
+    }
+
+    bool Close() {
+        if (this->iFd < 0) {
+            return false;
+        }
+        Flush();
+        bool ok = ::close(this->iFd) == 0 && !this->bFailed;
+        this->iFd = -1;
+        return ok;
+    }
+
+    bool Good() const {
+        return this->iFd >= 0 && !this->bFailed;
+    }
+
+    // 已写入文件的字节数
+    uint64_t Bytes() const {
+        return this->iBytes;
+    }
+
+private:
+    int32_t iFd = -1;
+    bool bFailed = false;
+    char delimiter;
+    std::unique_ptr<char[]> buffer;
+    size_t iLength = 0;
+    uint64_t iBytes = 0;
+};
+
+template<typename OutputIt>
+class IteratorSink {
+public:
+    explicit IteratorSink(OutputIt it) : it(it) {
+    }
+
+    void operator()(Uid id) {
+        *this->it++ = id;
+    }
+
+    OutputIt Get() const {
+        return this->it;
+    }
+
+private:
+    OutputIt it;
+};
+
+/*
+.	图（邻接表实现） Graph Adjacency List
+.	相关术语：
+.		顶点 Vertex ； 边 Edge ；
+.		有向图 Digraph ；
+.	存储结构：
+.		1.顶点表采用B+树结构。
+.		2.边表按下级数分级：少量下级内联存储在顶点结点中，下级较多时采用以下级ID为键的B+树结构。
+*/
+class GraphAdjList {
+private:
+    // 边表结点
+    using EdgeNode = struct EdgeNode {
+        Uid adjVex; // 邻接顶点所在表中下标ID
+//        EdgeNode *next; // 指向下一条边
+
+        static bool cmp(const EdgeNode &A, const EdgeNode &B){
+            return A.adjVex < B.adjVex; // 降序
+        }
+    };
+
+    // 顶点表与边表 B+ 树的阶：编译期常量，可按结点大小分别调整
+    static constexpr int32_t VERTEX_ORDER = 16;
+    static constexpr int32_t EDGE_ORDER = ORDER;
+    using EdgeTable = BPlusTree<Uid, EdgeNode, EDGE_ORDER>;
+
+    /*
+    .	下级集合：某个顶点的直接下级，按下级ID升序存储，按下级数自动分级
+    .		1.内联：不超过 INLINE_CAPACITY 个，存储在顶点结点中，无需额外分配；
+    .		2.有序数组：不超过 ARRAY_CAPACITY 个，连续存储，二分查找；
+    .		3.B+树：超过 ARRAY_CAPACITY 个的大扇出顶点，以下级ID为键。
+    .	插入时自动升级；删除后下级数降到下一级容量的一半时降级，避免在边界附近反复转换。
+    .	注：集合按值复制时只复制外部存储的指针（浅复制），由图在析构或删除顶点时调用 Release 释放。
+    */
+    class ChildSet {
+    public:
+        static const int32_t INLINE_CAPACITY = 16 / sizeof(Uid);    // 内联存储的最大下级数：占 16 字节，32 位ID时为 4 个
+        static const int32_t ARRAY_CAPACITY = 128;      // 有序数组的最大下级数
+
+        // 存储级别
+        enum TIER {
+            TIER_INLINE, TIER_ARRAY, TIER_TREE
+        };
+
+        ChildSet() {
+            this->iCount = 0;
+            this->iTier = TIER_INLINE;
+        }
+
+        int32_t Size() const {
+            return this->iCount;
+        }
+
+        bool Empty() const {
+            return this->iCount == 0;
+        }
+
+        TIER Tier() const {
+            return (TIER) this->iTier;
+        }
+
+        bool Contains(Uid child) const {
+            switch (this->iTier) {
+                case TIER_INLINE: {
+                    int32_t index = _InlineIndex(child);
+                    return index < this->iCount && this->store.inlineIDs[index] == child;
+                }
+                case TIER_ARRAY: {
+                    int32_t index = _ArrayIndex(child);
+                    return index < this->iCount && this->store.pArray->Get(index) == child;
+                }
+                default:
+                    return this->store.pEdgeTable->search(child);
+            }
+        }
+
+        // 插入下级，已存在时返回 false
+        bool Insert(Uid child) {
+            switch (this->iTier) {
+                case TIER_INLINE: {
+                    int32_t index = _InlineIndex(child);
+                    if (index < this->iCount && this->store.inlineIDs[index] == child) {
+                        return false;
+                    }
+                    if (this->iCount == INLINE_CAPACITY) {
+                        _ToArray();
+                        return Insert(child);
+                    }
+                    for (int32_t i = this->iCount; i > index; i--) {
+                        this->store.inlineIDs[i] = this->store.inlineIDs[i - 1];
+                    }
+                    this->store.inlineIDs[index] = child;
+                    break;
+                }
+                case TIER_ARRAY: {
+                    int32_t index = _ArrayIndex(child);
+                    if (index < this->iCount && this->store.pArray->Get(index) == child) {
+                        return false;
+                    }
+                    if (this->iCount == ARRAY_CAPACITY) {
+                        _ToTree();
+                        return Insert(child);
+                    }
+                    this->store.pArray->Insert(index, child);
+                    break;
+                }
+                default:
+                    if (this->store.pEdgeTable->search(child)) {
+                        return false;
+                    }
+                    this->store.pEdgeTable->insert(child, EdgeNode{ child });
+                    break;
+            }
+            this->iCount++;
+            return true;
+        }
+
+        // 删除下级，不存在时返回 false
+        bool Erase(Uid child) {
+            switch (this->iTier) {
+                case TIER_INLINE: {
+                    int32_t index = _InlineIndex(child);
+                    if (index >= this->iCount || this->store.inlineIDs[index] != child) {
+                        return false;
+                    }
+                    for (int32_t i = index; i < this->iCount - 1; i++) {
+                        this->store.inlineIDs[i] = this->store.inlineIDs[i + 1];
+                    }
+                    this->iCount--;
+                    return true;
+                }
+                case TIER_ARRAY: {
+                    int32_t index = _ArrayIndex(child);
+                    if (index >= this->iCount || this->store.pArray->Get(index) != child) {
+                        return false;
+                    }
+                    this->store.pArray->RemoveAt(index);
+                    this->iCount--;
+                    if (this->iCount <= INLINE_CAPACITY / 2) {
+                        _ToInline();
+                    }
+                    return true;
+                }
+                default:
+                    if (!this->store.pEdgeTable->remove(child)) {
+                        return false;
+                    }
+                    this->iCount--;
+                    if (this->iCount <= ARRAY_CAPACITY / 2) {
+                        _TreeToArray();
+                    }
+                    return true;
+            }
+        }
+
+        // 按下级ID升序访问每个下级
+        template<typename Visitor>
+        void ForEach(Visitor &&visit) const {
+            switch (this->iTier) {
+                case TIER_INLINE:
+                    for (int32_t i = 0; i < this->iCount; i++) {
+                        visit(this->store.inlineIDs[i]);
+                    }
+                    break;
+                case TIER_ARRAY:
+                    for (Uid child : *this->store.pArray) {
+                        visit(child);
+                    }
+                    break;
+                default:
+                    this->store.pEdgeTable->forEach([&](Uid, const EdgeNode &edge) {
+                        visit(edge.adjVex);
+                    });
+                    break;
+            }
+        }
+
+        // 将所有下级追加到 children
+        void AppendTo(std::vector<Uid> &children) const {
+            ForEach([&](Uid child) {
+                children.push_back(child);
+            });
+        }
+
+        // 集合本身之外的堆内存字节数（不含分配器开销）
+        size_t HeapBytes() const {
+            switch (this->iTier) {
+                case TIER_INLINE:
+                    return 0;
+                case TIER_ARRAY:
+                    return sizeof(ObjArrayList<Uid>) + sizeof(Uid) * (size_t) this->store.pArray->Size();
+                default:
+                    return sizeof(EdgeTable) + (size_t) this->store.pEdgeTable->stats().nodeBytes;
+            }
+        }
+
+        // 集合本身之外的堆内存在分配器中实际占用的字节数
+        size_t AllocatedBytes() const {
+            switch (this->iTier) {
+                case TIER_INLINE:
+                    return 0;
+                case TIER_ARRAY:
+                    return AllocatedSize(this->store.pArray, sizeof(ObjArrayList<Uid>)) +
+                           this->store.pArray->AllocatedBytes();
+                default:
+                    return AllocatedSize(this->store.pEdgeTable, sizeof(EdgeTable)) +
+                           (size_t) this->store.pEdgeTable->stats().allocatedBytes;
+            }
+        }
+
+        // B+树边表的统计，未升级为 B+树时为空
+        TreeStats EdgeTableStats() const {
+            return this->iTier == TIER_TREE ? this->store.pEdgeTable->stats() : TreeStats();
+        }
+
+        // 释放外部存储
+        void Release() {
+            if (this->iTier == TIER_ARRAY) {
+                delete this->store.pArray;
+            } else if (this->iTier == TIER_TREE) {
+                delete this->store.pEdgeTable;
+            }
+            this->iTier = TIER_INLINE;
+            this->iCount = 0;
+        }
+
+    private:
+        int32_t iCount;     // 下级个数
+        int32_t iTier;      // 存储级别
+        union {
+            Uid inlineIDs[INLINE_CAPACITY];             // 内联存储的下级ID（升序）
+            ObjArrayList<Uid> *pArray;                  // 有序数组
+            EdgeTable *pEdgeTable;       // B+树边表，键为下级ID
+        } store;
+
+        // 内联数组中第一个不小于 child 的下标
+        int32_t _InlineIndex(Uid child) const {
+            int32_t i = 0;
+            while (i < this->iCount && this->store.inlineIDs[i] < child) {
+                i++;
+            }
+            return i;
+        }
+
+        // 有序数组中第一个不小于 child 的下标
+        int32_t _ArrayIndex(Uid child) const {
+            const ObjArrayList<Uid> &arr = *this->store.pArray;
+            return (int32_t) (std::lower_bound(arr.begin(), arr.end(), child) - arr.begin());
+        }
+
+        void _ToArray() {
+            ObjArrayList<Uid> *arr = new ObjArrayList<Uid>(2 * INLINE_CAPACITY);
+            for (int32_t i = 0; i < this->iCount; i++) {
+                arr->Add(this->store.inlineIDs[i]);
+            }
+            this->store.pArray = arr;
+            this->iTier = TIER_ARRAY;
+        }
+
+        void _ToTree() {
+            EdgeTable *tree = new EdgeTable();
+            for (Uid child : *this->store.pArray) {
+                tree->insert(child, EdgeNode{ child });
+            }
+            delete this->store.pArray;
+            this->store.pEdgeTable = tree;
+            this->iTier = TIER_TREE;
+        }
+
+        void _ToInline() {
+            ObjArrayList<Uid> *arr = this->store.pArray;
+            for (int32_t i = 0; i < this->iCount; i++) {
+                this->store.inlineIDs[i] = arr->Get(i);
+            }
+            delete arr;
+            this->iTier = TIER_INLINE;
+        }
+
+        void _TreeToArray() {
+            EdgeTable *tree = this->store.pEdgeTable;
+            ObjArrayList<Uid> *arr = new ObjArrayList<Uid>(ARRAY_CAPACITY);
+            tree->forEach([&](Uid key, const EdgeNode &) {
+                arr->Add(key);
+            });
+            delete tree;
+            this->store.pArray = arr;
+            this->iTier = TIER_ARRAY;
+        }
+    };
+
+    // 顶点表结点
+    using VertexNode = struct VertexNode {
+        Uid id; // 顶点ID
+        Uid preID;  // 前向节点
+        ChildSet children;  // 直接下级
+
+        static bool cmp(const VertexNode &A, const VertexNode &B){
+            return A.id < B.id; // 降序
+        }
+    };
+
+    static const int32_t LOCATE_BATCH = 64;    // 按层遍历时每次批量查找顶点表的顶点数
+    static const int32_t DEPTH_INDEX_REBUILD_RATIO = 8;     // 累计修改达到用户数的 1/8 时重建深度分区索引
+    static const int32_t DEPTH_INDEX_MIN_BATCH = 4096;      // 触发重建的最少修改数
+
+public:
+    // 边数据，注：供外部初始化边数据使用
+    using EdgeData = struct EdgeData {
+        Uid Tail;    // 边（弧）尾
+        Uid Head;    // 边（弧）头
+    };
+
+public:
+    // 添加邀请关系的结果：已插入 | 邀请者不存在，已暂存 | 新用户已存在，丢弃
+    enum LINK_RESULT {
+        LINK_INSERTED, LINK_PARKED, LINK_DUPLICATE
+    };
+
+    // 添加邀请关系：邀请者不存在时暂存到待定边缓冲并返回 false，邀请者到达后自动补插；新用户已存在时丢弃并返回 false
+    // result 非空时写入具体结果，用于区分暂存与丢弃
+    bool addInviteRelationship(Uid preID, Uid newID, LINK_RESULT *result = nullptr) {
+        INSTRUMENT_SCOPE(OP_ADD_INVITE);
+        this->iIngestSeq++;
+        LINK_RESULT linked = _Link(preID, newID);
+        if (result != nullptr) {
+            *result = linked;
+        }
+        if (linked != LINK_INSERTED) {
+            if (linked == LINK_PARKED) {
+                _Park(preID, newID);
+            }
+            return false;
+        }
+        if (!this->pendingEdges.Empty()) {
+            _FlushPending(newID);
+        }
+        _RebuildDepthIndexIfDue();
+        return true;
+    }
+
+    // 批量添加邀请关系，返回本批直接插入的关系数（不含补插）
+    int32_t addInviteRelationships(std::span<const EdgeData> edges) {
+        // 1.先插入顶点，收集可建边的关系
+        ObjArrayList<EdgeData> edgesList((int32_t) edges.size());
+        for (const EdgeData &edge : edges) {
+            this->iIngestSeq++;
+            LINK_RESULT linked = _addVexSet(edge.Tail, edge.Head);
+            if (linked == LINK_INSERTED) {
+                edgesList.Add(edge);
+            } else if (linked == LINK_PARKED) {
+                _Park(edge.Tail, edge.Head);
+            }
+        }
+
+        // 2.批量建边
+        _AddEdge(edgesList);
+
+        // 3.补插等待新用户的关系
+        if (!this->pendingEdges.Empty()) {
+            for (const EdgeData &edge : edgesList) {
+                _FlushPending(edge.Head);
+            }
+        }
+        _RebuildDepthIndexIfDue();
+        return edgesList.Length();
+    }
+
+    // 删除用户时其直接下级的处理方式：挂到被删除用户的邀请者下 | 成为孤立用户（preID 为 -1）
+    enum CHILD_POLICY {
+        CHILDREN_REATTACH, CHILDREN_ORPHAN
+    };
+
+    // 删除用户，代价与其直接下级个数成正比；用户不存在时返回 false
+    bool DeleteUser(Uid vertex, CHILD_POLICY policy = CHILDREN_REATTACH) {
+        if (!_Unlink(vertex, policy)) {
+            return false;
+        }
+        this->vexs.erase(vertex);
+        _RebuildDepthIndexIfDue();
+        return true;
+    }
+
+    // 批量删除用户：先逐个调整邀请关系，再一次性从顶点表中删除，返回删除的用户数
+    // 注：批内用户互为上下级时，下级最终挂到最近的未删除上级下，与逐个删除的结果相同
+    int32_t DeleteUsers(std::span<const Uid> vertices, CHILD_POLICY policy = CHILDREN_REATTACH) {
+        std::vector<Uid> ids(vertices.begin(), vertices.end());
+        std::sort(ids.begin(), ids.end());
+        ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+        std::vector<Uid> removed;
+        removed.reserve(ids.size());
+        for (Uid id : ids) {
+            if (_Unlink(id, policy)) {
+                removed.push_back(id);
+            }
+        }
+        this->vexs.eraseSorted(removed);
+        _RebuildDepthIndexIfDue();
+        return (int32_t) removed.size();
+    }
+
+    // 将用户及其全部下级移到新的邀请者下；新邀请者是该用户本身或其下级（会形成环）时返回 false
+    bool MoveSubtree(Uid vertex, Uid newPreID) {
+        VertexNode *vertexNode = this->vexs.find(vertex);
+        VertexNode *newParent = this->vexs.find(newPreID);
+        if (vertexNode == nullptr || newParent == nullptr) {
+            return false;
+        }
+        if (vertexNode->preID == newPreID) {
+            return true;
+        }
+
+        // 环检测：沿新邀请者的上级链向上，代价与其深度成正比
+        for (VertexNode *itr = newParent; itr != nullptr; itr = itr->preID == NO_UID ? nullptr : this->vexs.find(itr->preID)) {
+            if (itr->id == vertex) {
+                return false;
+            }
+        }
+
+        if (vertexNode->preID != NO_UID) {
+            _DeleteEdge(vertexNode->preID, vertex);
+        }
+        vertexNode->preID = newPreID;
+        _InsertEdge(newPreID, vertex);
+        _RebuildDepthIndexIfDue();
+        return true;
+    }
+
+    // 启用或关闭深度分区索引：启用时立即构建；之后新用户增量加入索引，删除用户与移动子树标记索引失效，失效期间查询退回逐层遍历，
+    // 这类修改累计达到一批（用户数的 1/DEPTH_INDEX_REBUILD_RATIO）时在修改操作结束时重建，查询本身从不等待重建
+    void EnableDepthIndex(bool enable) {
+        this->bDepthIndexEnabled = enable;
+        if (!enable) {
+            this->depthIndex.Clear();
+            this->bDepthIndexDirty = true;
+        } else if (this->bDepthIndexDirty) {
+            _BuildDepthIndex();
+        }
+    }
+
+    // 立即重建已失效的深度分区索引（未启用时忽略），批量修改结束后调用可使后续查询直接使用索引
+    void RebuildDepthIndex() {
+        if (this->bDepthIndexEnabled && this->bDepthIndexDirty) {
+            _BuildDepthIndex();
+        }
+    }
+
+    // 设置查询结果缓存的容量（字节），为 0 时关闭：第 N 级下级与全部下级查询先查缓存，图修改时按 preID 链精确失效
+    void EnableQueryCache(size_t capacityBytes) {
+        this->queryCache.SetCapacity(capacityBytes);
+    }
+
+    QueryCache::Metrics GetQueryCacheMetrics() const {
+        return this->queryCache.GetMetrics();
+    }
+
+    // 生成压缩邻接表快照
+    bool Snapshot(CompressedAdjacency &snapshot) const {
+        snapshot.Clear();
+        std::vector<Uid> children;
+        bool ok = true;
+        this->vexs.forEach([&](Uid id, const VertexNode &vex) {
+            children.clear();
+            vex.children.AppendTo(children);
+            ok = ok && snapshot.Add(id, children);
+        });
+        snapshot.Finish();
+        return ok;
+    }
+
+    // 深度分区索引占用的字节数
+    size_t GetDepthIndexBytes() const {
+        return this->depthIndex.Bytes();
+    }
+
+    // 顶点个数
+    int32_t GetVexNum() const {
+        return this->iVexNum;
+    }
+
+    // 待定边缓冲指标
+    PendingEdgeBuffer::Metrics GetPendingMetrics() const {
+        return this->pendingEdges.GetMetrics(this->iIngestSeq);
+    }
+
+    // 设置待定边缓冲容量（边数）
+    void SetPendingCapacity(size_t capacity) {
+        this->pendingEdges.SetCapacity(capacity);
+    }
+
+    // 下级存储统计（按存储级别）
+    struct ChildTierStats {
+        int64_t vertices = 0;       // 处于该级别的顶点数
+        int64_t children = 0;       // 下级总数
+        int64_t heapBytes = 0;      // 顶点结点之外的堆内存字节数
+        int64_t allocatedBytes = 0; // 上述堆内存在分配器中实际占用的字节数
+    };
+
+    struct ChildStorageReport {
+        int64_t vertices = 0;           // 顶点数
+        int64_t leafVertices = 0;       // 没有下级的顶点数
+        int64_t inlineBytes = 0;        // 顶点结点内的下级集合字节数
+        ChildTierStats tiers[3];        // 按 ChildSet::TIER 下标
+        TreeStats edgeTables;           // 所有 B+树边表的汇总
+
+        // 下级集合在顶点结点之外实际占用的字节数
+        int64_t AllocatedBytes() const {
+            return this->tiers[0].allocatedBytes + this->tiers[1].allocatedBytes + this->tiers[2].allocatedBytes;
+        }
+    };
+
+    // 下级存储统计随每次修改增量维护，代价 O(1)
+    ChildStorageReport GetChildStorageReport() const {
+        ChildStorageReport report = this->childStorage;
+        report.edgeTables.height = 0;
+        for (int32_t h = _MAX_TREE_HEIGHT - 1; h > 0; h--) {
+            if (this->edgeTableHeights[h] > 0) {
+                report.edgeTables.height = h;
+                break;
+            }
+        }
+        return report;
+    }
+
+    // 内存报告：顶点表、下级集合（含全部边表）、深度分区索引、查询结果缓存与待定边缓冲
+    struct MemoryReport {
+        int64_t vertices = 0;           // 顶点数
+        int64_t edges = 0;              // 边数
+        TreeStats vertexTable;          // 顶点表
+        ChildStorageReport children;    // 下级集合
+        int64_t depthIndexBytes = 0;    // 深度分区索引
+        int64_t queryCacheBytes = 0;    // 查询结果缓存
+        int64_t pendingBytes = 0;       // 待定边缓冲（估算）
+
+        // 总占用字节数（分配器口径）
+        int64_t TotalBytes() const {
+            return this->vertexTable.allocatedBytes + this->children.AllocatedBytes() + this->depthIndexBytes +
+                   this->queryCacheBytes + this->pendingBytes;
+        }
+
+        double BytesPerVertex() const {
+            return this->vertices > 0 ? (double) TotalBytes() / this->vertices : 0.0;
+        }
+
+        double BytesPerEdge() const {
+            return this->edges > 0 ? (double) TotalBytes() / this->edges : 0.0;
+        }
+
+        void Print(std::ostream &out) const {
+            auto printTree = [&](const char *name, const TreeStats &tree) {
+                out << "  " << name << "：树 " << tree.trees << "，内结点 " << tree.internalNodes << "，叶子结点 "
+                    << tree.leafNodes << "，树高 " << tree.height << "，填充率 叶子 " << tree.LeafFill() * 100
+                    << "% / 内结点 " << tree.InternalFill() * 100 << "%，结点 " << tree.nodeBytes << " B，分配 "
+                    << tree.allocatedBytes << " B" << std::endl;
+            };
+            out << "内存：顶点 " << this->vertices << "，边 " << this->edges << "，合计 " << TotalBytes() << " B（"
+                << BytesPerVertex() << " B/顶点，" << BytesPerEdge() << " B/边）" << std::endl;
+            printTree("顶点表", this->vertexTable);
+            printTree("边表", this->children.edgeTables);
+            const char *tierNames[] = { "内联", "有序数组", "B+树" };
+            for (int32_t t = 0; t < 3; t++) {
+                const ChildTierStats &tier = this->children.tiers[t];
+                out << "  下级（" << tierNames[t] << "）：顶点 " << tier.vertices << "，下级 " << tier.children
+                    << "，堆内存 " << tier.heapBytes << " B，分配 " << tier.allocatedBytes << " B" << std::endl;
+            }
+            out << "  深度分区索引：" << this->depthIndexBytes << " B" << std::endl;
+            out << "  查询结果缓存：" << this->queryCacheBytes << " B" << std::endl;
+            out << "  待定边缓冲：" << this->pendingBytes << " B" << std::endl;
+        }
+    };
+
+    // 生成内存报告：各项计数随修改维护，代价 O(树高)，可频繁导出到监控
+    MemoryReport GetMemoryReport() const {
+        MemoryReport report;
+        report.vertices = this->iVexNum;
+        report.edges = this->iEdgeNum;
+        report.vertexTable = this->vexs.stats();
+        report.children = GetChildStorageReport();
+        report.depthIndexBytes = (int64_t) this->depthIndex.Bytes();
+        report.queryCacheBytes = (int64_t) this->queryCache.Bytes();
+        report.pendingBytes = (int64_t) this->pendingEdges.Bytes();
+        return report;
+    }
+
+
+private:
+    static const int32_t _MAX_VERTEX_NUM = 10;          // 支持最大顶点数
+    static const int32_t _MAX_TREE_HEIGHT = 64;         // 边表树高上限（每结点至少两个孩子）
+
+    BPlusTree<Uid, VertexNode, VERTEX_ORDER> vexs;  // 顶点表
+
+    int32_t iVexNum; // 顶点个数
+    int32_t iEdgeNum; // 边数
+
+    PendingEdgeBuffer pendingEdges;     // 待定边缓冲：邀请者尚未出现的邀请关系
+    uint64_t iIngestSeq = 0;            // 已接收的邀请记录数
+
+    DepthIndex depthIndex;              // 深度分区索引，启用后供第 N 级下级查询使用
+    bool bDepthIndexEnabled = false;    // 是否启用深度分区索引
+    bool bDepthIndexDirty = true;       // 删除用户或移动了子树，索引失效，查询退回逐层遍历
+    int64_t iDepthIndexChanges = 0;     // 索引上次构建后使其失效的修改数
+
+    QueryCache queryCache;              // 查询结果缓存，容量为 0 时关闭
+
+    ChildStorageReport childStorage;                // 下级存储统计，随修改增量维护（边表树高见 edgeTableHeights）
+    int64_t edgeTableHeights[_MAX_TREE_HEIGHT] = {};    // 各树高的 B+树边表个数
+
+    // 断开用户的所有邀请关系并按 policy 处理其直接下级，顶点结点保留在顶点表中由调用者删除
+    bool _Unlink(Uid vertex, CHILD_POLICY policy) {
+        VertexNode *vertexNode = this->vexs.find(vertex);
+        if (vertexNode == nullptr) {
+            return false;
+        }
+
+        // 1.从邀请者的下级集合中移除
+        Uid preID = vertexNode->preID;
+        if (preID != NO_UID) {
+            _DeleteEdge(preID, vertex);
+        }
+
+        // 2.直接下级挂到邀请者下，或成为孤立用户（被删除的是根用户时同样成为孤立用户）
+        Uid newPreID = policy == CHILDREN_REATTACH ? preID : NO_UID;
+        VertexNode *newParent = newPreID == NO_UID ? nullptr : this->vexs.find(newPreID);
+        if (newParent != nullptr) {
+            _AccountChildren(newParent->children, -1);
+        }
+        vertexNode->children.ForEach([&](Uid child) {
+            this->vexs.find(child)->preID = newPreID;
+            if (newParent != nullptr && newParent->children.Insert(child)) {
+                this->iEdgeNum++;
+            }
+        });
+        if (newParent != nullptr) {
+            _AccountChildren(newParent->children, 1);
+        }
+        this->iEdgeNum -= vertexNode->children.Size();
+        _AccountChildren(vertexNode->children, -1);
+        vertexNode->children.Release();
+        _AccountChildren(vertexNode->children, 1);
+        _AccountVertex(-1);
+
+        this->iVexNum--;
+        _MarkDepthIndexDirty();
+        this->queryCache.InvalidateRoot(vertex);
+        return true;
+    }
+
+    // 重建深度分区索引
+    void _BuildDepthIndex() {
+        std::vector<Uid> ids, roots;
+        ids.reserve(this->iVexNum);
+        this->vexs.forEach([&](Uid id, const VertexNode &vex) {
+            ids.push_back(id);
+            if (vex.preID == NO_UID) {
+                roots.push_back(id);
+            }
+        });
+        this->depthIndex.Build(std::move(ids), roots, [this](Uid id, std::vector<Uid> &children) {
+            _GetChildren(id, children);
+        });
+        this->bDepthIndexDirty = false;
+        this->iDepthIndexChanges = 0;
+    }
+
+    // 新增邀请边：head 是新用户（尚无下级）且索引有效时增量加入索引，否则标记索引失效
+    void _AddToDepthIndex(Uid tail, Uid head) {
+        if (!this->bDepthIndexEnabled || this->bDepthIndexDirty || !this->depthIndex.AddLeaf(tail, head)) {
+            _MarkDepthIndexDirty();
+        }
+    }
+
+    // 图已修改：标记索引失效并计数，重建推迟到本次公开的修改操作结束（此时顶点表与边表一致）
+    void _MarkDepthIndexDirty() {
+        this->bDepthIndexDirty = true;
+        this->iDepthIndexChanges++;
+    }
+
+    // 公开的修改操作结束时调用：累计修改达到一批时重建，O(用户数) 的重建代价分摊到这一批修改上
+    void _RebuildDepthIndexIfDue() {
+        if (this->bDepthIndexEnabled && this->bDepthIndexDirty &&
+            this->iDepthIndexChanges >= std::max<int64_t>(this->iVexNum / DEPTH_INDEX_REBUILD_RATIO, DEPTH_INDEX_MIN_BATCH)) {
+            _BuildDepthIndex();
+        }
+    }
+
+    // 新增（sign = 1）或删除（sign = -1，下级集合已释放）顶点时更新下级存储统计
+    void _AccountVertex(int32_t sign) {
+        this->childStorage.vertices += sign;
+        this->childStorage.leafVertices += sign;
+        this->childStorage.inlineBytes += sign * (int64_t) sizeof(ChildSet);
+    }
+
+    // 下级集合修改前以 sign = -1 撤销其统计，修改后以 sign = 1 重新计入
+    void _AccountChildren(const ChildSet &children, int32_t sign) {
+        if (children.Empty()) {
+            this->childStorage.leafVertices += sign;
+            return;
+        }
+        ChildTierStats &tier = this->childStorage.tiers[children.Tier()];
+        tier.vertices += sign;
+        tier.children += sign * (int64_t) children.Size();
+        if (children.Tier() == ChildSet::TIER_INLINE) {
+            return;
+        }
+        tier.heapBytes += sign * (int64_t) children.HeapBytes();
+        tier.allocatedBytes += sign * (int64_t) children.AllocatedBytes();
+        if (children.Tier() == ChildSet::TIER_TREE) {
+            TreeStats stats = children.EdgeTableStats();
+            this->childStorage.edgeTables.Merge(stats, sign);
+            this->edgeTableHeights[stats.height] += sign;
+        }
+    }
+
+    // 插入顶点及其邀请边
+    LINK_RESULT _Link(Uid preID, Uid newID) {
+        LINK_RESULT linked = _addVexSet(preID, newID);
+        if (linked == LINK_INSERTED) {
+            _InsertEdge(preID, newID);
+        }
+        return linked;
+    }
+
+    // 暂存邀请者尚不存在的关系（调用方已由 _addVexSet 判定为 LINK_PARKED）
+    void _Park(Uid preID, Uid newID) {
+        this->pendingEdges.Park(preID, newID, this->iIngestSeq);
+    }
+
+    // 补插等待 vertex 的邀请关系，新插入的用户继续作为邀请者补插
+    void _FlushPending(Uid vertex) {
+        std::vector<Uid> ready = { vertex };
+        std::vector<Uid> invitees;
+        while (!ready.empty()) {
+            Uid inviter = ready.back();
+            ready.pop_back();
+            if (!this->pendingEdges.Take(inviter, invitees)) {
+                continue;
+            }
+            for (Uid invitee : invitees) {
+                if (_Link(inviter, invitee) == LINK_INSERTED) {
+                    ready.push_back(invitee);
+                }
+            }
+        }
+    }
+
+    // 创建顶点集合：新用户已存在返回 LINK_DUPLICATE，邀请者不存在返回 LINK_PARKED（由调用方暂存）
+    LINK_RESULT _addVexSet(Uid preID, Uid newID) {
+        if (_Locate(newID) != NO_UID) {
+            return LINK_DUPLICATE;
+        }
+        if (_Locate(preID) == NO_UID) {
+            return LINK_PARKED;
+        }
+
+        this->vexs.emplace(newID, VertexNode{ newID, preID, ChildSet() });
+        _AccountVertex(1);
+
+        this->iVexNum++;
+
+        return LINK_INSERTED;
+    }
+
+    // 创建边
+    void _AddEdge(const ObjArrayList<EdgeData> &edgesList) {
+        // 初始化 Tail Head 顶点下标索引
+        Uid tail = 0, head = 0;
+        // 遍历边数据列表
+        for (int32_t i = 0; i < edgesList.Length(); i++) {
+            // 按序获取边（弧）
+            const EdgeData *edgeData = &edgesList.Get(i);
+            // 定位（或设置）边的两端顶点位置
+            tail = _Locate(edgeData->Tail);
+            head = _Locate(edgeData->Head);
+            // 插入边
+            _InsertEdge(tail, head);
+        }
+
+    }
+
+    // 将顶点的直接下级追加到 children
+    void _GetChildren(Uid vertex, std::vector<Uid> &children) {
+        VertexNode *vertexNode = this->vexs.find(vertex);
+        if (vertexNode == nullptr) {
+            return;
+        }
+        vertexNode->children.AppendTo(children);
+    }
+
+    // 将 frontier 中每个顶点的直接下级依次追加到 children，与逐个调用结果相同；顶点表按批查找，各次下降的缓存未命中相互重叠
+    void _GetChildren(std::span<const Uid> frontier, std::vector<Uid> &children) {
+        VertexNode *vertexNodes[LOCATE_BATCH];
+        for (size_t base = 0; base < frontier.size(); base += LOCATE_BATCH) {
+            int32_t n = (int32_t) std::min(frontier.size() - base, (size_t) LOCATE_BATCH);
+            this->vexs.multiFind(frontier.data() + base, n, vertexNodes);
+            for (int32_t i = 0; i < n; i++) {
+                if (vertexNodes[i] != nullptr) {
+                    vertexNodes[i]->children.AppendTo(children);
+                }
+            }
+        }
+    }
+
+    // 定位顶点元素位置
+    Uid _Locate(Uid vertex) {
+        INSTRUMENT_SCOPE(OP_LOCATE);
+        if (this->vexs.search(vertex)) {
+            return vertex;
+        }
+
+        // std::cout << std::endl << "顶点[" << vertex << "]不存在。" << std::endl;
+        return NO_UID;
+    }
+
+    // 插入边
+    void _InsertEdge(Uid tail, Uid head) {
+        INSTRUMENT_SCOPE(OP_INSERT_EDGE);
+        // 弧尾顶点：直接修改顶点表中的结点
+        VertexNode *vertexNode = this->vexs.find(tail);
+
+        if (vertexNode == nullptr) {
+            return;
+        }
+
+        // 2.插入边：下级集合以下级ID为键，边已存在时跳过
+        _AccountChildren(vertexNode->children, -1);
+        bool inserted = vertexNode->children.Insert(head);
+        _AccountChildren(vertexNode->children, 1);
+        if (!inserted) {
+            return;
+        }
+
+        // 4.边 计数
+        this->iEdgeNum++;
+        _AddToDepthIndex(tail, head);
+        _InvalidateQueryCache(tail, head);
+    }
+
+    // 删除边，边不存在时返回 false
+    bool _DeleteEdge(Uid tail, Uid head) {
+        // 弧尾顶点：直接修改顶点表中的结点
+        VertexNode *vertexNode = this->vexs.find(tail);
+
+        if (vertexNode == nullptr) {
+            return false;
+        }
+        _AccountChildren(vertexNode->children, -1);
+        bool erased = vertexNode->children.Erase(head);
+        _AccountChildren(vertexNode->children, 1);
+        if (!erased) {
+            return false;
+        }
+
+        this->iEdgeNum--;
+        _MarkDepthIndexDirty();
+        _InvalidateQueryCache(tail, head);
+        return true;
+    }
+
+    // 顶点 tail 新增或删除直接下级 head 后，使受影响的查询结果失效；head 没有下级时只影响各上级的一个等级
+    void _InvalidateQueryCache(Uid tail, Uid head) {
+        if (this->queryCache.Empty()) {
+            return;
+        }
+        VertexNode *headNode = this->vexs.find(head);
+        bool subtree = headNode != nullptr && headNode->children.Size() > 0;
+        this->queryCache.Invalidate(tail, subtree, [this](Uid id) {
+            VertexNode *vertexNode = this->vexs.find(id);
+            return vertexNode == nullptr ? NO_UID : vertexNode->preID;
+        });
+    }
+
+    // 第 n 级下级：深度分区索引有效时直接定位，否则逐层广度优先遍历
+    std::vector<Uid> _GetNthLevel(Uid vertex, int32_t n) {
+        std::vector<Uid> frontier;
+        if (this->bDepthIndexEnabled && !this->bDepthIndexDirty) {
+            this->depthIndex.GetLevel(vertex, n, frontier);
+            return frontier;
+        }
+        if (_Locate(vertex) == NO_UID) {
+            return frontier;
+        }
+
+        frontier.push_back(vertex);
+        for (int32_t level = 0; level < n && !frontier.empty(); level++) {
+            std::vector<Uid> next;
+            _GetChildren(frontier, next);
+            frontier.swap(next);
+        }
+        return frontier;
+    }
+
+    // 深度优先遍历（先序，下级按ID升序）：显式栈代替递归，深链不会耗尽调用栈
+    template<typename Visitor>
+    int64_t _DFS(Uid vertex, Visitor &visit) {
+        int64_t visited = 0;
+        std::vector<Uid> stack = { vertex };
+        while (!stack.empty()) {
+            Uid id = stack.back();
+            stack.pop_back();
+            visit(id);
+            visited++;
+
+            // 下级逆序入栈，出栈时按升序访问
+            size_t top = stack.size();
+            _GetChildren(id, stack);
+            std::reverse(stack.begin() + (std::ptrdiff_t) top, stack.end());
+        }
+        return visited;
+    }
+
+//    // 深度优先遍历 非递归
+//    void _DFS(int32_t index) {
+//        // 1.访问第一个结点，并标记为 已访问
+//        auto vertexList = this->vexs.select(index, EQ);
+//
+//        if (vertexList.empty()) {
+//            return;
 //        }
 //
 //        VertexNode vertexNode = vertexList[0];
@@ -1357,262 +5278,3668 @@ private:
 //                this->vexs_visited.remove(pEdgeList->front().adjVex);
 //                this->vexs_visited.insert(pEdgeList->front().adjVex, 1);
 //
-//                s->Push(pEdgeList);
+//                s->Push(pEdgeList);
+//
+//                pEdges = vertexNode.pEdgeTable;
+//            } else {
+//                pEdgeList->pop_front();
+//                if (pEdgeList->empty()) {
+//                    delete pEdgeList;
+//                }
+//            }
+//
+//            if (pEdges == nullptr) {
+//                pEdgeList = s->Pop();
+//            }
+//        }
+//        //释放 栈
+//        delete s;
+//    }
+
+public:
+    // 构造函数：初始化图
+    GraphAdjList() {
+        this->iVexNum = 0;
+        this->iEdgeNum = 0;
+    }
+
+    // 析构函数：释放各顶点的边表
+    ~GraphAdjList() {
+        this->vexs.forEach([](Uid, VertexNode &vex) {
+            vex.children.Release();
+        });
+    }
+
+    // 初始化顶点、边数据为 图|网
+    void Init() {
+        // 1.创建顶点集
+        this->vexs.emplace(0, VertexNode{ 0, NO_UID, ChildSet() });
+        _AccountVertex(1);
+        this->iVexNum++;
+        _MarkDepthIndexDirty();
+    }
+
+//    //插入边
+//    void InsertEdge(const EdgeData &edgeData) {
+//        // 初始化 Tail Head 顶点下标索引
+//        int32_t tail = 0, head = 0;
+//        tail = _Locate(edgeData.Tail);
+//        head = _Locate(edgeData.Head);
+//        // 根据图类型，插入边
+//        _InsertEdge(tail, head);
+//    }
+//
+//    // 删除边
+//    void DeleteEdge(const EdgeData &edgeData) {
+//        // 初始化 Tail Head 顶点下标索引
+//        int32_t tail = 0, head = 0;
+//        tail = _Locate(edgeData.Tail);
+//        head = _Locate(edgeData.Head);
+//
+//        // 根据图类型，删除边
+//        _DeleteEdge(tail, head);
+//    }
+
+    // 用户是否存在
+    bool Contains(Uid vertex) {
+        return _Locate(vertex) != NO_UID;
+    }
+
+    // 用户的直接邀请者，用户不存在或为根用户时返回 NO_UID
+    Uid GetInviter(Uid vertex) {
+        VertexNode *vertexNode = this->vexs.find(vertex);
+        return vertexNode == nullptr ? NO_UID : vertexNode->preID;
+    }
+
+    // 将 frontier 中每个顶点的直接下级依次追加到 children，供调用方分段逐层遍历
+    void GetChildren(std::span<const Uid> frontier, std::vector<Uid> &children) {
+        _GetChildren(frontier, children);
+    }
+
+    // 查找用户的所有上级：从直接邀请者到根用户，用户不存在时返回空
+    std::vector<Uid> GetAncestors(Uid vertex) {
+        INSTRUMENT_SCOPE(OP_ANCESTORS);
+        std::vector<Uid> ancestors;
+        VertexNode *vertexNode = this->vexs.find(vertex);
+        while (vertexNode != nullptr && vertexNode->preID != NO_UID) {
+            ancestors.push_back(vertexNode->preID);
+            vertexNode = this->vexs.find(vertexNode->preID);
+        }
+        return ancestors;
+    }
+
+    // 批量查找上级：第 i 个元素为 vertices[i] 的全部上级，与逐个调用 GetAncestors 结果相同
+    // 全部查询同步上溯，每一步对仍未到达根用户的查询做一次批量查找
+    std::vector<std::vector<Uid>> GetAncestors(const std::vector<Uid> &vertices) {
+        INSTRUMENT_SCOPE(OP_ANCESTORS);
+        std::vector<std::vector<Uid>> ancestors(vertices.size());
+        std::vector<int32_t> pending(vertices.size());   // 仍在上溯的查询下标
+        std::vector<Uid> current(vertices);          // 对应查询当前所在的用户
+        std::vector<VertexNode *> vertexNodes;
+        for (size_t i = 0; i < pending.size(); i++) {
+            pending[i] = (int32_t) i;
+        }
+        while (!pending.empty()) {
+            this->vexs.multiFind(current, vertexNodes);
+            size_t kept = 0;
+            for (size_t i = 0; i < pending.size(); i++) {
+                if (vertexNodes[i] == nullptr || vertexNodes[i]->preID == NO_UID) {
+                    continue;
+                }
+                ancestors[pending[i]].push_back(vertexNodes[i]->preID);
+                pending[kept] = pending[i];
+                current[kept] = vertexNodes[i]->preID;
+                kept++;
+            }
+            pending.resize(kept);
+            current.resize(kept);
+        }
+        return ancestors;
+    }
+
+    // 查找用户的所有下级，按邀请等级分层：第 i 个元素为第 i + 1 级下级
+    std::vector<std::vector<Uid>> GetDownline(Uid vertex) {
+        INSTRUMENT_SCOPE(OP_DOWNLINE);
+        std::vector<std::vector<Uid>> levels;
+        if (this->queryCache.Enabled() && this->queryCache.Find(vertex, levels)) {
+            return levels;
+        }
+        if (_Locate(vertex) == NO_UID) {
+            return levels;
+        }
+
+        std::vector<Uid> frontier = { vertex };
+        while (true) {
+            std::vector<Uid> next;
+            _GetChildren(frontier, next);
+            if (next.empty()) {
+                break;
+            }
+            levels.push_back(next);
+            frontier.swap(next);
+        }
+        if (this->queryCache.Enabled()) {
+            this->queryCache.Store(vertex, levels);
+        }
+        return levels;
+    }
+
+    // 查找用户的第 n 级下级（n >= 1）
+    std::vector<Uid> GetNthLevel(Uid vertex, int32_t n) {
+        INSTRUMENT_SCOPE(OP_NTH_LEVEL);
+        std::vector<Uid> frontier;
+        if (n < 1) {
+            return frontier;
+        }
+        if (this->queryCache.Enabled()) {
+            if (!this->queryCache.Find(vertex, n, frontier) && _Locate(vertex) != NO_UID) {
+                frontier = _GetNthLevel(vertex, n);
+                this->queryCache.Store(vertex, n, frontier);
+            }
+            return frontier;
+        }
+        return _GetNthLevel(vertex, n);
+    }
+
+    // 显示 图
+    void Display(std::ostream &out = std::cout) {
+        out << std::endl << "邻接表：" << std::endl;
+
+        // 遍历顶点表：顶点及其下级
+        this->vexs.forEach([&](Uid id, const VertexNode &vex) {
+            out << "[" << id << "]" << id << " ";
+            vex.children.ForEach([&](Uid adjVex) {
+                out << "[" << adjVex << "] ";
+            });
+            out << std::endl;
+        });
+    }
+
+    // 深度优先遍历 vertex 及其全部下级，每个用户调用一次 visit(id)，返回访问的用户数；用户不存在时返回 0
+    // visit 可以是回调、IteratorSink、ConsoleSink、BufferedFileSink 等任意可调用对象
+    template<typename Visitor>
+    int64_t TraverseDFS(Uid vertex, Visitor &&visit) {
+        if (_Locate(vertex) == NO_UID) {
+            return 0;
+        }
+        return _DFS(vertex, visit);
+    }
+
+    // 广度优先遍历 vertex 及其全部下级，按邀请等级逐层访问；visit 接受 (id, level) 时同时传入等级（vertex 为第 0 级）
+    // 深度分区索引有效时按分区顺序读取，否则逐层查找顶点表
+    template<typename Visitor>
+    int64_t TraverseBFS(Uid vertex, Visitor &&visit) {
+        if (_Locate(vertex) == NO_UID) {
+            return 0;
+        }
+
+        int64_t visited = 0;
+        if (this->bDepthIndexEnabled && !this->bDepthIndexDirty) {
+            this->depthIndex.VisitDownline(vertex, [&](Uid id, int32_t level) {
+                if constexpr (std::is_invocable_v<Visitor &, Uid, int32_t>) {
+                    visit(id, level);
+                } else {
+                    visit(id);
+                }
+                visited++;
+            });
+            return visited;
+        }
+
+        std::vector<Uid> frontier = { vertex }, next;
+        for (int32_t level = 0; !frontier.empty(); level++) {
+            next.clear();
+            for (Uid id : frontier) {
+                if constexpr (std::is_invocable_v<Visitor &, Uid, int32_t>) {
+                    visit(id, level);
+                } else {
+                    visit(id);
+                }
+            }
+            _GetChildren(frontier, next);
+            visited += (int64_t) frontier.size();
+            frontier.swap(next);
+        }
+        return visited;
+    }
+
+    // 从指定顶点开始，深度优先遍历并输出
+    void Display_DFS_R(Uid vertex, std::ostream &out = std::cout) {
+        if (_Locate(vertex) == NO_UID) {
+            return;
+        }
+        out << "深度优先遍历：（从顶点" << vertex << "开始）" << std::endl;
+        TraverseDFS(vertex, ConsoleSink(out));
+        out << std::flush;
+    }
+
+//    // 从指定顶点开始，深度优先 非递归 遍历
+//    void Display_DFS(int32_t vertex) {
+//        // 1.判断顶点是否存在
+//        int32_t index = _Locate(vertex);
+//        if (index == -1)
+//            return;
+//
+//        auto vertexList = this->vexs.select(0, BE);
 //
-//                pEdges = vertexNode.pEdgeTable;
-//            } else {
-//                pEdgeList->pop_front();
-//                if (pEdgeList->empty()) {
-//                    delete pEdgeList;
-//                }
-//            }
+//        if (vertexList.empty()) {
+//            return;
+//        }
 //
-//            if (pEdges == nullptr) {
-//                pEdgeList = s->Pop();
-//            }
+//        // 2.初始化顶点访问数组
+//        for (auto vex : vertexList) {
+//            this->vexs_visited.remove(vex.id);
+//            this->vexs_visited.insert(vex.id, 0);
 //        }
-//        //释放 栈
-//        delete s;
+//
+//        // 3.深度优先遍历 递归
+//        std::cout << "深度优先遍历（非递归）：（从顶点" << vertex << "开始）" << std::endl;
+//        _DFS(index);
 //    }
 
-public:
-    // 构造函数：初始化图
-    GraphAdjList() {
-        this->iVexNum = 0;
-        this->iEdgeNum = 0;
+    // 从指定顶点开始，广度优先遍历并输出
+    void Display_BFS(Uid vertex, std::ostream &out = std::cout) {
+        if (_Locate(vertex) == NO_UID) {
+            return;
+        }
+        out << "广度优先遍历：（从顶点" << vertex << "开始）" << std::endl;
+        TraverseBFS(vertex, ConsoleSink(out));
+        out << std::flush;
+    }
+};
+
+// 分片用户目录：用户ID -> 位置（不存在 | 上层树 | 分片），按 2^16 个连续ID分块，块按需分配，每个用户 1 字节
+class ShardDirectory {
+public:
+    static constexpr uint8_t ABSENT = 0;            // 用户不存在
+    static constexpr uint8_t UPPER = 1;             // 用户在上层树
+    static constexpr uint8_t SHARD_BASE = 2;        // 分片 s 记为 SHARD_BASE + s
+
+    uint8_t Get(Uid id) const {
+        const uint8_t *chunk = _Chunk(id >> CHUNK_BITS);
+        return chunk != nullptr ? chunk[id & (CHUNK_SIZE - 1)] : ABSENT;
+    }
+
+    void Set(Uid id, uint8_t location) {
+        Uid chunkID = id >> CHUNK_BITS;
+        uint8_t *chunk = _Chunk(chunkID);
+        if (chunk == nullptr) {
+            auto &slot = this->chunks[chunkID];
+            slot = std::make_unique<uint8_t[]>(CHUNK_SIZE);
+            chunk = slot.get();
+            this->lastChunkID = chunkID;
+            this->lastChunk = chunk;
+        }
+        chunk[id & (CHUNK_SIZE - 1)] = location;
+    }
+
+private:
+    static const int32_t CHUNK_BITS = 16;
+    static const int32_t CHUNK_SIZE = 1 << CHUNK_BITS;
+
+    // 连续插入与查询多落在同一块，先查最近一次访问的块
+    uint8_t *_Chunk(Uid chunkID) const {
+        if (chunkID != this->lastChunkID || this->lastChunk == nullptr) {
+            auto itr = this->chunks.find(chunkID);
+            if (itr == this->chunks.end()) {
+                return nullptr;
+            }
+            this->lastChunkID = chunkID;
+            this->lastChunk = itr->second.get();
+        }
+        return this->lastChunk;
+    }
+
+    std::unordered_map<Uid, std::unique_ptr<uint8_t[]>> chunks;
+    mutable Uid lastChunkID = NO_UID;
+    mutable uint8_t *lastChunk = nullptr;
+};
+
+/*
+.	分片邀请森林 Sharded Graph
+.	按顶层子树划分：深度小于 splitDepth 的用户组成上层树，由路由（调用方线程）持有；深度为 splitDepth 的用户是子树的根，
+.	按其ID的哈希分配到分片，整棵子树归该分片所有。每个分片是一个 GraphAdjList，由一个工作线程独占：
+.		1.插入按所属分片攒批，一批作为一个任务交给分片的工作线程，分片之间没有共享数据，也不加锁；
+.		2.分片内用户的下级查询在分片内完成；上级查询在分片内上溯到子树的根，其余部分由上层树补齐；
+.		3.上层用户的下级查询扇出到其下各子树所在的分片，按上层树中子树根的顺序拼接，结果与单个 GraphAdjList 相同。
+.	上层树另外保存各子树的根（作为叶子），分片中子树的根挂在虚拟根 0 下。用户目录记录每个用户所在的位置。
+.	注：路由只供一个线程调用；查询前自动提交尚未发出的插入批次，批量查询由各分片并行执行。
+*/
+class ShardedGraph {
+public:
+    using EdgeData = GraphAdjList::EdgeData;
+
+    static constexpr int32_t MAX_SHARD_NUM = 250;      // 最大分片数（用户目录每个用户占 1 字节）
+
+    explicit ShardedGraph(int32_t shardNum, int32_t splitDepth = 1) {
+        this->iShardNum = std::clamp(shardNum, 1, MAX_SHARD_NUM);
+        this->iSplitDepth = std::max(splitDepth, 1);
+        this->upper.Init();
+        this->directory.Set(0, ShardDirectory::UPPER);
+        this->iVexNum = 1;
+        this->shardVexNum.assign(this->iShardNum, 0);
+        for (int32_t i = 0; i < this->iShardNum; i++) {
+            this->shards.push_back(std::make_unique<Shard>());
+            this->shards.back()->graph.Init();
+            this->shards.back()->worker = std::thread(&Shard::Run, this->shards.back().get());
+        }
+    }
+
+    ~ShardedGraph() {
+        Flush();
+        for (auto &shard : this->shards) {
+            shard->Stop();
+        }
+    }
+
+    ShardedGraph(const ShardedGraph &) = delete;
+
+    ShardedGraph &operator=(const ShardedGraph &) = delete;
+
+    // 添加邀请关系：邀请者不存在时暂存到待定边缓冲并返回 false，邀请者到达后自动补插；新用户已存在时返回 false
+    bool addInviteRelationship(Uid preID, Uid newID) {
+        this->iIngestSeq++;
+        if (!_Link(preID, newID)) {
+            if (this->directory.Get(preID) == ShardDirectory::ABSENT && this->directory.Get(newID) == ShardDirectory::ABSENT) {
+                this->pendingEdges.Park(preID, newID, this->iIngestSeq);
+            }
+            return false;
+        }
+        if (!this->pendingEdges.Empty()) {
+            _FlushPending(newID);
+        }
+        return true;
+    }
+
+    // 批量添加邀请关系，返回本批直接插入的关系数（不含补插）
+    int32_t addInviteRelationships(std::span<const EdgeData> edges) {
+        int32_t linked = 0;
+        for (const EdgeData &edge : edges) {
+            linked += addInviteRelationship(edge.Tail, edge.Head);
+        }
+        return linked;
+    }
+
+    // 提交所有分片尚未发出的插入批次（不等待完成）
+    void Flush() {
+        for (int32_t i = 0; i < this->iShardNum; i++) {
+            _SubmitBatch(i);
+        }
+    }
+
+    // 提交并等待所有分片处理完已发出的插入
+    void Sync() {
+        std::vector<std::function<void(GraphAdjList &)>> work(this->iShardNum, [](GraphAdjList &) {});
+        _RunOnShards(work);
+    }
+
+    int32_t GetVexNum() const {
+        return this->iVexNum;
+    }
+
+    int32_t GetShardNum() const {
+        return this->iShardNum;
+    }
+
+    // 分片中的用户数（不含虚拟根），由路由计数，无需等待分片
+    int32_t GetShardVexNum(int32_t shard) const {
+        return this->shardVexNum[shard];
+    }
+
+    // 查找用户的所有上级：从直接邀请者到根用户，用户不存在时返回空
+    std::vector<Uid> GetAncestors(Uid vertex) {
+        return std::move(GetAncestors(std::vector<Uid>{ vertex })[0]);
+    }
+
+    // 批量查找上级：各分片并行上溯到子树的根（分片内为批量查找），再由上层树补齐
+    std::vector<std::vector<Uid>> GetAncestors(const std::vector<Uid> &vertices) {
+        std::vector<std::vector<Uid>> ancestors(vertices.size());
+        std::vector<std::vector<int32_t>> positions(this->iShardNum);
+        for (size_t i = 0; i < vertices.size(); i++) {
+            uint8_t location = this->directory.Get(vertices[i]);
+            if (location == ShardDirectory::UPPER) {
+                ancestors[i] = this->upper.GetAncestors(vertices[i]);
+            } else if (location != ShardDirectory::ABSENT) {
+                positions[location - ShardDirectory::SHARD_BASE].push_back((int32_t) i);
+            }
+        }
+
+        std::vector<std::function<void(GraphAdjList &)>> work(this->iShardNum);
+        for (int32_t s = 0; s < this->iShardNum; s++) {
+            if (!positions[s].empty()) {
+                work[s] = [&, s](GraphAdjList &graph) {
+                    std::vector<Uid> ids;
+                    for (int32_t i : positions[s]) {
+                        ids.push_back(vertices[i]);
+                    }
+                    std::vector<std::vector<Uid>> result = graph.GetAncestors(ids);
+                    for (size_t j = 0; j < ids.size(); j++) {
+                        ancestors[positions[s][j]] = std::move(result[j]);
+                    }
+                };
+            }
+        }
+        _RunOnShards(work);
+
+        // 去掉分片的虚拟根，从子树的根接上上层树
+        for (const std::vector<int32_t> &shardPositions : positions) {
+            for (int32_t i : shardPositions) {
+                std::vector<Uid> &chain = ancestors[i];
+                chain.pop_back();
+                Uid root = chain.empty() ? vertices[i] : chain.back();
+                std::vector<Uid> upperChain = this->upper.GetAncestors(root);
+                chain.insert(chain.end(), upperChain.begin(), upperChain.end());
+            }
+        }
+        return ancestors;
+    }
+
+    // 查找用户的所有下级，按邀请等级分层：第 i 个元素为第 i + 1 级下级
+    std::vector<std::vector<Uid>> GetDownline(Uid vertex) {
+        std::vector<std::vector<Uid>> levels;
+        uint8_t location = this->directory.Get(vertex);
+        if (location == ShardDirectory::ABSENT) {
+            return levels;
+        }
+        std::vector<std::function<void(GraphAdjList &)>> work(this->iShardNum);
+        if (location != ShardDirectory::UPPER) {
+            work[location - ShardDirectory::SHARD_BASE] = [&](GraphAdjList &graph) {
+                levels = graph.GetDownline(vertex);
+            };
+            _RunOnShards(work);
+            return levels;
+        }
+
+        // 上层用户：上层树给出到子树根为止的各级，更深的各级由子树所在分片给出，按子树根的顺序逐级拼接
+        levels = this->upper.GetDownline(vertex);
+        int32_t rootLevel = this->iSplitDepth - _UpperDepth(vertex);
+        if ((int32_t) levels.size() < rootLevel) {
+            return levels;
+        }
+        const std::vector<Uid> &roots = levels[rootLevel - 1];
+        std::vector<std::vector<std::vector<Uid>>> subtrees(roots.size());
+        std::vector<std::vector<int32_t>> positions(this->iShardNum);
+        for (size_t i = 0; i < roots.size(); i++) {
+            positions[this->directory.Get(roots[i]) - ShardDirectory::SHARD_BASE].push_back((int32_t) i);
+        }
+        for (int32_t s = 0; s < this->iShardNum; s++) {
+            if (!positions[s].empty()) {
+                work[s] = [&, s](GraphAdjList &graph) {
+                    for (int32_t i : positions[s]) {
+                        subtrees[i] = graph.GetDownline(roots[i]);
+                    }
+                };
+            }
+        }
+        _RunOnShards(work);
+        for (const std::vector<std::vector<Uid>> &subtree : subtrees) {
+            for (size_t level = 0; level < subtree.size(); level++) {
+                if (levels.size() <= rootLevel + level) {
+                    levels.emplace_back();
+                }
+                levels[rootLevel + level].insert(levels[rootLevel + level].end(), subtree[level].begin(), subtree[level].end());
+            }
+        }
+        return levels;
+    }
+
+    // 查找用户的第 n 级下级（n >= 1）
+    std::vector<Uid> GetNthLevel(Uid vertex, int32_t n) {
+        return std::move(GetNthLevel(std::vector<Uid>{ vertex }, n)[0]);
+    }
+
+    // 批量查找第 n 级下级：第 i 个元素与 GetNthLevel(vertices[i], n) 相同，各分片并行执行
+    std::vector<std::vector<Uid>> GetNthLevel(const std::vector<Uid> &vertices, int32_t n) {
+        std::vector<std::vector<Uid>> results(vertices.size());
+        if (n < 1) {
+            return results;
+        }
+
+        // 每个查询拆成若干分片请求：分片内用户为一个请求，上层用户为其下每棵子树一个请求
+        struct LevelRequest {
+            Uid vertex;
+            int32_t level;
+            std::vector<Uid> result;
+        };
+        std::vector<LevelRequest> requests;
+        std::vector<std::pair<size_t, size_t>> ranges(vertices.size(), { 0, 0 });  // 查询对应的请求区间
+        std::vector<std::vector<int32_t>> positions(this->iShardNum);
+        auto addRequest = [&](Uid vertex, int32_t level) {
+            positions[this->directory.Get(vertex) - ShardDirectory::SHARD_BASE].push_back((int32_t) requests.size());
+            requests.push_back({ vertex, level, {}});
+        };
+        for (size_t i = 0; i < vertices.size(); i++) {
+            uint8_t location = this->directory.Get(vertices[i]);
+            ranges[i].first = requests.size();
+            if (location == ShardDirectory::UPPER) {
+                int32_t rootLevel = this->iSplitDepth - _UpperDepth(vertices[i]);
+                if (n <= rootLevel) {
+                    results[i] = this->upper.GetNthLevel(vertices[i], n);
+                } else {
+                    for (Uid root : this->upper.GetNthLevel(vertices[i], rootLevel)) {
+                        addRequest(root, n - rootLevel);
+                    }
+                }
+            } else if (location != ShardDirectory::ABSENT) {
+                addRequest(vertices[i], n);
+            }
+            ranges[i].second = requests.size();
+        }
+
+        std::vector<std::function<void(GraphAdjList &)>> work(this->iShardNum);
+        for (int32_t s = 0; s < this->iShardNum; s++) {
+            if (!positions[s].empty()) {
+                work[s] = [&, s](GraphAdjList &graph) {
+                    for (int32_t r : positions[s]) {
+                        requests[r].result = graph.GetNthLevel(requests[r].vertex, requests[r].level);
+                    }
+                };
+            }
+        }
+        _RunOnShards(work);
+
+        for (size_t i = 0; i < vertices.size(); i++) {
+            if (ranges[i].second - ranges[i].first == 1) {
+                results[i] = std::move(requests[ranges[i].first].result);
+                continue;
+            }
+            for (size_t r = ranges[i].first; r < ranges[i].second; r++) {
+                results[i].insert(results[i].end(), requests[r].result.begin(), requests[r].result.end());
+            }
+        }
+        return results;
+    }
+
+private:
+    // 分片：一个 GraphAdjList 与独占它的工作线程，按提交顺序执行任务
+    class Shard {
+    public:
+        GraphAdjList graph;
+        std::vector<EdgeData> batch;        // 尚未提交的插入
+        std::thread worker;
+
+        void Submit(std::function<void()> &&task) {
+            {
+                std::lock_guard<std::mutex> lock(this->mutex);
+                this->tasks.push_back(std::move(task));
+            }
+            this->ready.notify_one();
+        }
+
+        // 工作线程：每次取走队列中的全部任务，依次执行
+        void Run() {
+            std::deque<std::function<void()>> running;
+            while (true) {
+                {
+                    std::unique_lock<std::mutex> lock(this->mutex);
+                    this->ready.wait(lock, [this]() { return this->bStop || !this->tasks.empty(); });
+                    if (this->tasks.empty()) {
+                        return;
+                    }
+                    running.swap(this->tasks);
+                }
+                for (std::function<void()> &task : running) {
+                    task();
+                }
+                running.clear();
+            }
+        }
+
+        // 执行完已提交的任务后退出工作线程
+        void Stop() {
+            {
+                std::lock_guard<std::mutex> lock(this->mutex);
+                this->bStop = true;
+            }
+            this->ready.notify_one();
+            this->worker.join();
+        }
+
+    private:
+        std::mutex mutex;
+        std::condition_variable ready;
+        std::deque<std::function<void()>> tasks;
+        bool bStop = false;
+    };
+
+    static constexpr size_t _INSERT_BATCH = 4096;     // 每个插入任务的关系数
+
+    bool _Link(Uid preID, Uid newID) {
+        uint8_t location = this->directory.Get(preID);
+        if (location == ShardDirectory::ABSENT || this->directory.Get(newID) != ShardDirectory::ABSENT) {
+            return false;
+        }
+        if (location == ShardDirectory::UPPER) {
+            this->upper.addInviteRelationship(preID, newID);
+            if (_UpperDepth(preID) + 1 < this->iSplitDepth) {
+                this->directory.Set(newID, ShardDirectory::UPPER);
+                this->iVexNum++;
+                return true;
+            }
+            // 新用户是子树的根：按ID哈希选择分片，挂在分片的虚拟根下
+            location = (uint8_t) (ShardDirectory::SHARD_BASE + _ShardOf(newID));
+            preID = 0;
+        }
+        int32_t shard = location - ShardDirectory::SHARD_BASE;
+        this->directory.Set(newID, location);
+        this->shards[shard]->batch.push_back({ preID, newID });
+        if (this->shards[shard]->batch.size() >= _INSERT_BATCH) {
+            _SubmitBatch(shard);
+        }
+        this->shardVexNum[shard]++;
+        this->iVexNum++;
+        return true;
+    }
+
+    // 补插等待 vertex 的邀请关系，新插入的用户继续作为邀请者补插
+    void _FlushPending(Uid vertex) {
+        std::vector<Uid> ready = { vertex };
+        std::vector<Uid> invitees;
+        while (!ready.empty()) {
+            Uid inviter = ready.back();
+            ready.pop_back();
+            if (!this->pendingEdges.Take(inviter, invitees)) {
+                continue;
+            }
+            for (Uid invitee : invitees) {
+                if (_Link(inviter, invitee)) {
+                    ready.push_back(invitee);
+                }
+            }
+        }
+    }
+
+    void _SubmitBatch(int32_t shard) {
+        Shard &target = *this->shards[shard];
+        if (target.batch.empty()) {
+            return;
+        }
+        target.Submit([&graph = target.graph, edges = std::move(target.batch)]() {
+            graph.addInviteRelationships(edges);
+        });
+        target.batch = std::vector<EdgeData>();
+        target.batch.reserve(_INSERT_BATCH);
+    }
+
+    // 在各分片上并行执行 work[s]（为空的跳过），排在已提交的插入之后，全部完成后返回
+    void _RunOnShards(std::vector<std::function<void(GraphAdjList &)>> &work) {
+        Flush();
+        std::ptrdiff_t count = 0;
+        for (const auto &fn : work) {
+            count += fn != nullptr;
+        }
+        std::latch done(count);
+        for (int32_t s = 0; s < this->iShardNum; s++) {
+            if (work[s] != nullptr) {
+                this->shards[s]->Submit([&, s]() {
+                    work[s](this->shards[s]->graph);
+                    done.count_down();
+                });
+            }
+        }
+        done.wait();
+    }
+
+    // 上层用户的深度（根用户为 0）
+    int32_t _UpperDepth(Uid vertex) {
+        return (int32_t) this->upper.GetAncestors(vertex).size();
+    }
+
+    int32_t _ShardOf(Uid root) const {
+        return (int32_t) ((((uint64_t) root * 0x9E3779B97F4A7C15ull) >> 32) % (uint64_t) this->iShardNum);
+    }
+
+    int32_t iShardNum;                                  // 分片数
+    int32_t iSplitDepth;                                // 子树根所在的深度
+    int32_t iVexNum;                                    // 用户数
+    uint64_t iIngestSeq = 0;                            // 已处理的插入记录数
+    GraphAdjList upper;                                 // 上层树（含各子树的根）
+    ShardDirectory directory;                           // 用户目录
+    PendingEdgeBuffer pendingEdges;                     // 邀请者尚未出现的关系
+    std::vector<int32_t> shardVexNum;                   // 各分片用户数
+    std::vector<std::unique_ptr<Shard>> shards;
+};
+
+/*
+.	分片传输 Shard Transport
+.	路由与分片进程之间按帧收发消息，每帧为 8 字节长度加消息内容；具体传输可替换（本机测试用 Unix 套接字，跨机时换为网络连接）。
+.	长度来自对端，不可信：超过 MAX_FRAME_BYTES 的帧视为连接损坏。
+*/
+class ShardTransport {
+public:
+    static constexpr uint64_t MAX_FRAME_BYTES = (uint64_t) 1 << 32;    // 单帧上限 4 GB
+
+    virtual ~ShardTransport() = default;
+
+    virtual bool Send(const std::vector<uint8_t> &message) = 0;     // 发送一帧，连接断开时返回 false
+
+    virtual bool Receive(std::vector<uint8_t> &message) = 0;        // 接收一帧，连接断开时返回 false
+};
+
+// Unix 套接字传输：持有已连接的流式套接字，析构时关闭
+class SocketTransport : public ShardTransport {
+public:
+    explicit SocketTransport(int32_t fd) : fd(fd) {
+    }
+
+    ~SocketTransport() override {
+        close(this->fd);
+    }
+
+    bool Send(const std::vector<uint8_t> &message) override {
+        uint64_t length = message.size();
+        return _WriteAll(&length, sizeof(length)) && _WriteAll(message.data(), message.size());
+    }
+
+    bool Receive(std::vector<uint8_t> &message) override {
+        uint64_t length;
+        if (!_ReadAll(&length, sizeof(length)) || length > MAX_FRAME_BYTES) {
+            return false;
+        }
+        message.resize(length);
+        return _ReadAll(message.data(), length);
+    }
+
+private:
+    // 对端已关闭时 send 返回 EPIPE 而不是发出 SIGPIPE 终止进程
+    bool _WriteAll(const void *data, size_t size) {
+        const uint8_t *p = (const uint8_t *) data;
+        while (size > 0) {
+            ssize_t n = send(this->fd, p, size, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                return false;
+            }
+            p += n;
+            size -= (size_t) n;
+        }
+        return true;
+    }
+
+    bool _ReadAll(void *data, size_t size) {
+        uint8_t *p = (uint8_t *) data;
+        while (size > 0) {
+            ssize_t n = read(this->fd, p, size);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                return false;
+            }
+            p += n;
+            size -= (size_t) n;
+        }
+        return true;
+    }
+
+    int32_t fd;
+};
+
+// 分片消息：首个 uint32_t 为消息类型，其后为定长字段与 Uid 数组
+enum SHARD_MESSAGE {
+    MSG_INSERT,         // 插入：子树根 (上层邀请者, 根) 列表、分片内关系列表，无应答
+    MSG_DOWNLINE,       // 全部下级：顶点列表 -> 每个顶点按层分组的下级
+    MSG_LEVEL,          // 第 n 级下级：层数、顶点列表 -> 每个顶点的第 n 级下级
+    MSG_ANCESTORS,      // 上级：顶点列表 -> 每个顶点在分片内的上级，最后一个为子树根的上层邀请者
+    MSG_STOP            // 结束分片进程，无应答
+};
+
+// 消息编码：按本机字节序追加、读取定长字段，路由与分片运行在同一种机器上
+// 读取越过消息末尾时标记失败，之后的读取均返回零值或空数组，由调用方检查 Good()
+class WireBuffer {
+public:
+    explicit WireBuffer(std::vector<uint8_t> &bytes) : bytes(bytes) {
+    }
+
+    bool Good() const {
+        return !this->bFailed;
+    }
+
+    // 消息内容与预期不符（如元素个数不对）时由调用方标记失败
+    void Fail() {
+        this->bFailed = true;
+    }
+
+    template<typename T>
+    void Put(T value) {
+        PutArray(&value, 1);
+    }
+
+    template<typename T>
+    void PutArray(const T *values, size_t n) {
+        if (n == 0) {
+            return;
+        }
+        size_t size = this->bytes.size();
+        this->bytes.resize(size + n * sizeof(T));
+        std::memcpy(this->bytes.data() + size, values, n * sizeof(T));
+    }
+
+    // 每组一个 uint32_t 长度，其后为全部元素
+    void PutLists(const std::vector<std::vector<Uid>> &lists) {
+        Put((uint32_t) lists.size());
+        for (const std::vector<Uid> &list : lists) {
+            Put((uint32_t) list.size());
+        }
+        for (const std::vector<Uid> &list : lists) {
+            PutArray(list.data(), list.size());
+        }
+    }
+
+    template<typename T>
+    T Get() {
+        T value{};
+        GetArray(&value, 1);
+        return value;
+    }
+
+    template<typename T>
+    void GetArray(T *values, size_t n) {
+        if (n == 0) {
+            return;
+        }
+        if (!_Fits(n, sizeof(T))) {
+            std::fill(values, values + n, T{});
+            return;
+        }
+        std::memcpy(values, this->bytes.data() + this->offset, n * sizeof(T));
+        this->offset += n * sizeof(T);
+    }
+
+    // 先校验元素个数不超过剩余字节，再分配
+    std::vector<Uid> GetVector() {
+        uint32_t n = Get<uint32_t>();
+        if (!_Fits(n, sizeof(Uid))) {
+            return {};
+        }
+        std::vector<Uid> values(n);
+        GetArray(values.data(), values.size());
+        return values;
+    }
+
+    std::vector<std::vector<Uid>> GetLists() {
+        uint32_t n = Get<uint32_t>();
+        if (!_Fits(n, sizeof(uint32_t))) {
+            return {};
+        }
+        std::vector<uint32_t> sizes(n);
+        GetArray(sizes.data(), sizes.size());
+        uint64_t total = 0;
+        for (uint32_t size : sizes) {
+            total += size;
+        }
+        if (!_Fits(total, sizeof(Uid))) {
+            return {};
+        }
+        std::vector<std::vector<Uid>> lists(n);
+        for (uint32_t i = 0; i < n; i++) {
+            lists[i].resize(sizes[i]);
+            GetArray(lists[i].data(), lists[i].size());
+        }
+        return lists;
+    }
+
+private:
+    // 剩余字节能否容纳 n 个 size 字节的元素，不能时标记失败
+    bool _Fits(uint64_t n, size_t size) {
+        if (this->bFailed || n > (this->bytes.size() - this->offset) / size) {
+            this->bFailed = true;
+            return false;
+        }
+        return true;
+    }
+
+    std::vector<uint8_t> &bytes;
+    size_t offset = 0;
+    bool bFailed = false;
+};
+
+/*
+.	分片服务 Shard Server
+.	在分片进程中运行：持有若干整棵子树，子树的根挂在虚拟根 0 下，另记其在上层树中的邀请者。
+.	按顺序处理路由发来的消息，直到收到 MSG_STOP 或连接断开。
+*/
+class ShardServer {
+public:
+    ShardServer() {
+        this->graph.Init();
+    }
+
+    void Serve(ShardTransport &transport) {
+        std::vector<uint8_t> request, reply;
+        while (transport.Receive(request)) {
+            WireBuffer in(request);
+            SHARD_MESSAGE type = (SHARD_MESSAGE) in.Get<uint32_t>();
+            if (type == MSG_STOP || !in.Good()) {
+                return;
+            }
+            if (type == MSG_INSERT) {
+                if (!_Insert(in)) {
+                    return;
+                }
+                continue;
+            }
+            reply.clear();
+            WireBuffer out(reply);
+            switch (type) {
+                case MSG_DOWNLINE:
+                    for (Uid vertex : in.GetVector()) {
+                        out.PutLists(this->graph.GetDownline(vertex));
+                    }
+                    break;
+                case MSG_LEVEL: {
+                    int32_t n = in.Get<int32_t>();
+                    std::vector<std::vector<Uid>> levels;
+                    for (Uid vertex : in.GetVector()) {
+                        levels.push_back(this->graph.GetNthLevel(vertex, n));
+                    }
+                    out.PutLists(levels);
+                }
+                    break;
+                case MSG_ANCESTORS: {
+                    std::vector<Uid> vertices = in.GetVector();
+                    std::vector<std::vector<Uid>> chains = this->graph.GetAncestors(vertices);
+                    for (size_t i = 0; i < vertices.size(); i++) {
+                        _ReplaceVirtualRoot(vertices[i], chains[i]);
+                    }
+                    out.PutLists(chains);
+                }
+                    break;
+                default:
+                    return;
+            }
+            // 请求不完整时断开连接，路由将本分片标记为失败
+            if (!in.Good() || !transport.Send(reply)) {
+                return;
+            }
+        }
+    }
+
+private:
+    // 插入一批关系，消息不完整时返回 false（不插入）
+    bool _Insert(WireBuffer &in) {
+        std::vector<Uid> roots = in.GetVector();
+        std::vector<Uid> edges = in.GetVector();
+        if (!in.Good()) {
+            return false;
+        }
+        for (size_t i = 0; i + 1 < roots.size(); i += 2) {
+            this->rootParent[roots[i + 1]] = roots[i];
+            this->graph.addInviteRelationship(0, roots[i + 1]);
+        }
+        std::vector<GraphAdjList::EdgeData> edgeData(edges.size() / 2);
+        for (size_t i = 0; i < edgeData.size(); i++) {
+            edgeData[i] = { edges[2 * i], edges[2 * i + 1] };
+        }
+        this->graph.addInviteRelationships(edgeData);
+        return true;
+    }
+
+    // 分片内的上级链以虚拟根 0 结尾，替换为子树根在上层树中的邀请者
+    void _ReplaceVirtualRoot(Uid vertex, std::vector<Uid> &chain) {
+        if (chain.empty()) {
+            return;
+        }
+        chain.pop_back();
+        Uid root = chain.empty() ? vertex : chain.back();
+        chain.push_back(this->rootParent.at(root));
+    }
+
+    GraphAdjList graph;
+    std::unordered_map<Uid, Uid> rootParent;    // 子树根 -> 上层树中的邀请者
+};
+
+/*
+.	多进程分片邀请森林 Distributed Graph
+.	与 ShardedGraph 划分方式相同：路由持有上层树与用户目录，每个分片是一个独立进程（或远端节点）中的 ShardServer，
+.	经 ShardTransport 通信。每次查询（或一批查询）只需一轮消息，每个分片收发各一条：
+.		1.下级查询：子树不跨分片，上层用户先在上层树中展开到子树根，各分片并行返回整棵子树，按层拼接；
+.		2.第 n 级查询：同上，分片在本地逐层展开后只返回第 n 级；
+.		3.上级查询：分片在本地上溯到子树根的上层邀请者，其余部分由上层树补齐。
+.	插入按分片攒批发送，不等待应答；查询前先发出未发送的批次，分片按接收顺序处理，保证查询看到之前的插入。
+.	注：路由只供一个线程调用；SpawnLocalShards 以 fork 创建本机分片进程，须在启动其他线程之前调用。
+*/
+class DistributedGraph {
+public:
+    using EdgeData = GraphAdjList::EdgeData;
+
+    // 通信统计
+    struct TransportStats {
+        uint64_t rounds = 0;            // 请求-应答轮数（一轮内各分片并行）
+        uint64_t messages = 0;          // 发出的消息数（含插入批次）
+        uint64_t bytesSent = 0;         // 发出的字节数
+        uint64_t bytesReceived = 0;     // 收到的字节数
+    };
+
+    explicit DistributedGraph(int32_t splitDepth = 1) {
+        this->iSplitDepth = std::max(splitDepth, 1);
+        this->upper.Init();
+        this->directory.Set(0, ShardDirectory::UPPER);
+        this->iVexNum = 1;
+    }
+
+    ~DistributedGraph() {
+        Flush();
+        std::vector<uint8_t> stop;
+        WireBuffer(stop).Put((uint32_t) MSG_STOP);
+        for (auto &shard : this->shards) {
+            if (!shard.bFailed) {
+                shard.transport->Send(stop);
+            }
+        }
+        this->shards.clear();
+        for (pid_t pid : this->children) {
+            waitpid(pid, nullptr, 0);
+        }
+    }
+
+    DistributedGraph(const DistributedGraph &) = delete;
+
+    DistributedGraph &operator=(const DistributedGraph &) = delete;
+
+    // 接入一个分片（须在插入之前），分片数已达上限时返回 false
+    bool AddShard(std::unique_ptr<ShardTransport> transport) {
+        if ((int32_t) this->shards.size() >= ShardedGraph::MAX_SHARD_NUM || this->iVexNum > 1) {
+            return false;
+        }
+        this->shards.push_back({ std::move(transport), {}, {}, 0, false });
+        return true;
+    }
+
+    // 在本机以 fork 启动 shardNum 个分片进程，经 Unix 套接字对通信；创建失败时返回 false
+    bool SpawnLocalShards(int32_t shardNum) {
+        for (int32_t i = 0; i < shardNum; i++) {
+            int32_t fds[2];
+            if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+                return false;
+            }
+            pid_t pid = fork();
+            if (pid < 0) {
+                close(fds[0]);
+                close(fds[1]);
+                return false;
+            }
+            if (pid == 0) {
+                // 分片进程：关闭继承来的其他分片连接，只服务自己的一端
+                close(fds[0]);
+                this->shards.clear();
+                {
+                    SocketTransport transport(fds[1]);
+                    ShardServer server;
+                    server.Serve(transport);
+                }
+                _exit(0);
+            }
+            close(fds[1]);
+            this->children.push_back(pid);
+            if (!AddShard(std::make_unique<SocketTransport>(fds[0]))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // 添加邀请关系：邀请者不存在时暂存到待定边缓冲并返回 false，邀请者到达后自动补插；新用户已存在时返回 false
+    bool addInviteRelationship(Uid preID, Uid newID) {
+        this->iIngestSeq++;
+        if (!_Link(preID, newID)) {
+            if (this->directory.Get(preID) == ShardDirectory::ABSENT && this->directory.Get(newID) == ShardDirectory::ABSENT) {
+                this->pendingEdges.Park(preID, newID, this->iIngestSeq);
+            }
+            return false;
+        }
+        if (!this->pendingEdges.Empty()) {
+            _FlushPending(newID);
+        }
+        return true;
+    }
+
+    int32_t addInviteRelationships(std::span<const EdgeData> edges) {
+        int32_t linked = 0;
+        for (const EdgeData &edge : edges) {
+            linked += addInviteRelationship(edge.Tail, edge.Head);
+        }
+        return linked;
+    }
+
+    // 发出所有分片尚未发送的插入批次，有分片失败时返回 false
+    bool Flush() {
+        bool ok = true;
+        for (int32_t i = 0; i < (int32_t) this->shards.size(); i++) {
+            ok &= _SendBatch(i);
+        }
+        return ok;
+    }
+
+    int32_t GetVexNum() const {
+        return this->iVexNum;
+    }
+
+    int32_t GetShardNum() const {
+        return (int32_t) this->shards.size();
+    }
+
+    int32_t GetShardVexNum(int32_t shard) const {
+        return this->shards[shard].iVexNum;
+    }
+
+    const TransportStats &GetTransportStats() const {
+        return this->stats;
+    }
+
+    // 已失败的分片：连接断开或应答格式错误；此后不再向其发送，落在其上的查询结果为空
+    std::vector<int32_t> GetFailedShards() const {
+        std::vector<int32_t> failed;
+        for (int32_t i = 0; i < (int32_t) this->shards.size(); i++) {
+            if (this->shards[i].bFailed) {
+                failed.push_back(i);
+            }
+        }
+        return failed;
+    }
+
+    std::vector<Uid> GetAncestors(Uid vertex) {
+        return std::move(GetAncestors(std::vector<Uid>{ vertex })[0]);
+    }
+
+    // 批量查找上级：一轮消息，各分片上溯到子树根的上层邀请者，再由上层树补齐
+    std::vector<std::vector<Uid>> GetAncestors(const std::vector<Uid> &vertices) {
+        std::vector<std::vector<Uid>> ancestors(vertices.size());
+        std::vector<std::vector<int32_t>> positions(this->shards.size());
+        for (size_t i = 0; i < vertices.size(); i++) {
+            uint8_t location = this->directory.Get(vertices[i]);
+            if (location == ShardDirectory::UPPER) {
+                ancestors[i] = this->upper.GetAncestors(vertices[i]);
+            } else if (location != ShardDirectory::ABSENT) {
+                positions[location - ShardDirectory::SHARD_BASE].push_back((int32_t) i);
+            }
+        }
+        _Exchange(MSG_ANCESTORS, 0, vertices, positions, [&](size_t s, WireBuffer &reply) {
+            std::vector<std::vector<Uid>> chains = reply.GetLists();
+            // 每条上级链至少含子树根的上层邀请者
+            bool valid = reply.Good() && chains.size() == positions[s].size();
+            for (size_t j = 0; valid && j < chains.size(); j++) {
+                valid = !chains[j].empty();
+            }
+            if (!valid) {
+                reply.Fail();
+                return;
+            }
+            for (size_t j = 0; j < chains.size(); j++) {
+                std::vector<Uid> &chain = ancestors[positions[s][j]];
+                chain = std::move(chains[j]);
+                std::vector<Uid> upperChain = this->upper.GetAncestors(chain.back());
+                chain.insert(chain.end(), upperChain.begin(), upperChain.end());
+            }
+        });
+        return ancestors;
+    }
+
+    // 查找用户的所有下级，按邀请等级分层：上层用户先在上层树中展开到子树根，再一轮消息由各分片返回整棵子树
+    std::vector<std::vector<Uid>> GetDownline(Uid vertex) {
+        uint8_t location = this->directory.Get(vertex);
+        std::vector<Uid> roots = { vertex };
+        std::vector<std::vector<Uid>> levels;
+        if (location == ShardDirectory::ABSENT) {
+            return levels;
+        }
+        if (location == ShardDirectory::UPPER) {
+            levels = this->upper.GetDownline(vertex);
+            int32_t rootLevel = this->iSplitDepth - (int32_t) this->upper.GetAncestors(vertex).size();
+            if ((int32_t) levels.size() < rootLevel) {
+                return levels;
+            }
+            roots = levels.back();
+        }
+
+        // 各子树根在同一层，子树第 i 层按子树根的顺序拼接到结果的同一层
+        size_t base = levels.size();
+        std::vector<std::vector<int32_t>> positions(this->shards.size());
+        for (size_t i = 0; i < roots.size(); i++) {
+            positions[this->directory.Get(roots[i]) - ShardDirectory::SHARD_BASE].push_back((int32_t) i);
+        }
+        std::vector<std::vector<std::vector<Uid>>> subtrees(roots.size());
+        _Exchange(MSG_DOWNLINE, 0, roots, positions, [&](size_t s, WireBuffer &reply) {
+            std::vector<std::vector<std::vector<Uid>>> replies(positions[s].size());
+            for (std::vector<std::vector<Uid>> &subtree : replies) {
+                subtree = reply.GetLists();
+            }
+            if (!reply.Good()) {
+                return;
+            }
+            for (size_t j = 0; j < replies.size(); j++) {
+                subtrees[positions[s][j]] = std::move(replies[j]);
+            }
+        });
+        for (const std::vector<std::vector<Uid>> &subtree : subtrees) {
+            if (levels.size() < base + subtree.size()) {
+                levels.resize(base + subtree.size());
+            }
+            for (size_t i = 0; i < subtree.size(); i++) {
+                levels[base + i].insert(levels[base + i].end(), subtree[i].begin(), subtree[i].end());
+            }
+        }
+        return levels;
+    }
+
+    std::vector<Uid> GetNthLevel(Uid vertex, int32_t n) {
+        return std::move(GetNthLevel(std::vector<Uid>{ vertex }, n)[0]);
+    }
+
+    // 批量查找第 n 级下级：上层用户先在上层树中展开到子树根，再一轮消息由各分片在本地展开剩余层数
+    std::vector<std::vector<Uid>> GetNthLevel(const std::vector<Uid> &vertices, int32_t n) {
+        std::vector<std::vector<Uid>> results(vertices.size());
+        if (n < 1) {
+            return results;
+        }
+
+        // 每个查询拆成若干分片请求，子树根在同一层，剩余层数相同；按剩余层数分组发送
+        struct LevelRequest {
+            size_t query;
+            Uid vertex;
+        };
+        std::map<int32_t, std::vector<LevelRequest>> groups;
+        for (size_t i = 0; i < vertices.size(); i++) {
+            uint8_t location = this->directory.Get(vertices[i]);
+            if (location == ShardDirectory::UPPER) {
+                int32_t rootLevel = this->iSplitDepth - (int32_t) this->upper.GetAncestors(vertices[i]).size();
+                if (n <= rootLevel) {
+                    results[i] = this->upper.GetNthLevel(vertices[i], n);
+                    continue;
+                }
+                for (Uid root : this->upper.GetNthLevel(vertices[i], rootLevel)) {
+                    groups[n - rootLevel].push_back({ i, root });
+                }
+            } else if (location != ShardDirectory::ABSENT) {
+                groups[n].push_back({ i, vertices[i] });
+            }
+        }
+        for (const auto &[level, requests] : groups) {
+            std::vector<Uid> requestVertices;
+            std::vector<std::vector<int32_t>> positions(this->shards.size());
+            for (const LevelRequest &request : requests) {
+                positions[this->directory.Get(request.vertex) - ShardDirectory::SHARD_BASE].push_back(
+                        (int32_t) requestVertices.size());
+                requestVertices.push_back(request.vertex);
+            }
+            std::vector<std::vector<Uid>> replies(requests.size());
+            _Exchange(MSG_LEVEL, level, requestVertices, positions, [&](size_t s, WireBuffer &reply) {
+                std::vector<std::vector<Uid>> lists = reply.GetLists();
+                if (!reply.Good() || lists.size() != positions[s].size()) {
+                    reply.Fail();
+                    return;
+                }
+                for (size_t j = 0; j < lists.size(); j++) {
+                    replies[positions[s][j]] = std::move(lists[j]);
+                }
+            });
+            // 按请求顺序（即上层树中子树根的顺序）拼接
+            for (size_t r = 0; r < requests.size(); r++) {
+                std::vector<Uid> &result = results[requests[r].query];
+                result.insert(result.end(), replies[r].begin(), replies[r].end());
+            }
+        }
+        return results;
+    }
+
+private:
+    struct Shard {
+        std::unique_ptr<ShardTransport> transport;
+        std::vector<Uid> roots;         // 尚未发送的子树根：(上层邀请者, 根)
+        std::vector<Uid> edges;         // 尚未发送的分片内关系：(邀请者, 新用户)
+        int32_t iVexNum;                // 分片中的用户数
+        bool bFailed;                   // 连接断开或应答格式错误，不再使用
+    };
+
+    static constexpr size_t _INSERT_BATCH = 4096;     // 每条插入消息的关系数
+
+    bool _Link(Uid preID, Uid newID) {
+        uint8_t location = this->directory.Get(preID);
+        if (this->shards.empty() || location == ShardDirectory::ABSENT || this->directory.Get(newID) != ShardDirectory::ABSENT) {
+            return false;
+        }
+        this->iVexNum++;
+        if (location == ShardDirectory::UPPER) {
+            this->upper.addInviteRelationship(preID, newID);
+            if ((int32_t) this->upper.GetAncestors(preID).size() + 1 < this->iSplitDepth) {
+                this->directory.Set(newID, ShardDirectory::UPPER);
+                return true;
+            }
+            // 新用户是子树的根：按ID哈希选择分片
+            int32_t shard = (int32_t) ((((uint64_t) newID * 0x9E3779B97F4A7C15ull) >> 32) % this->shards.size());
+            this->directory.Set(newID, (uint8_t) (ShardDirectory::SHARD_BASE + shard));
+            this->shards[shard].roots.insert(this->shards[shard].roots.end(), { preID, newID });
+            _CountInsert(shard);
+            return true;
+        }
+        int32_t shard = location - ShardDirectory::SHARD_BASE;
+        this->directory.Set(newID, location);
+        this->shards[shard].edges.insert(this->shards[shard].edges.end(), { preID, newID });
+        _CountInsert(shard);
+        return true;
+    }
+
+    // 批次发送失败时分片已标记为失败，由 GetFailedShards() 报告
+    void _CountInsert(int32_t shard) {
+        Shard &target = this->shards[shard];
+        target.iVexNum++;
+        if (target.roots.size() + target.edges.size() >= 2 * _INSERT_BATCH) {
+            _SendBatch(shard);
+        }
+    }
+
+    // 补插等待 vertex 的邀请关系，新插入的用户继续作为邀请者补插
+    void _FlushPending(Uid vertex) {
+        std::vector<Uid> ready = { vertex };
+        std::vector<Uid> invitees;
+        while (!ready.empty()) {
+            Uid inviter = ready.back();
+            ready.pop_back();
+            if (!this->pendingEdges.Take(inviter, invitees)) {
+                continue;
+            }
+            for (Uid invitee : invitees) {
+                if (_Link(inviter, invitee)) {
+                    ready.push_back(invitee);
+                }
+            }
+        }
+    }
+
+    // 子树根排在分片内关系之前：批次中的关系可能以本批新增的子树根为邀请者
+    // 分片已失败或发送失败时丢弃批次并返回 false
+    bool _SendBatch(int32_t shard) {
+        Shard &target = this->shards[shard];
+        if (target.bFailed) {
+            target.roots.clear();
+            target.edges.clear();
+            return false;
+        }
+        if (target.roots.empty() && target.edges.empty()) {
+            return true;
+        }
+        std::vector<uint8_t> message;
+        WireBuffer out(message);
+        out.Put((uint32_t) MSG_INSERT);
+        out.Put((uint32_t) target.roots.size());
+        out.PutArray(target.roots.data(), target.roots.size());
+        out.Put((uint32_t) target.edges.size());
+        out.PutArray(target.edges.data(), target.edges.size());
+        target.bFailed = !target.transport->Send(message);
+        this->stats.messages++;
+        this->stats.bytesSent += message.size();
+        target.roots.clear();
+        target.edges.clear();
+        return !target.bFailed;
+    }
+
+    // 一轮请求-应答：positions[s] 为发往分片 s 的顶点在 vertices 中的下标；先向所有分片发出，再依次接收并交给 read 解析
+    // 发送、接收失败或 read 判定应答格式错误（WireBuffer 失败）的分片标记为失败，其顶点的结果保持为空；
+    // read 只在应答完整时写入结果。有分片失败时返回 false
+    bool _Exchange(SHARD_MESSAGE type, int32_t level, const std::vector<Uid> &vertices,
+                   const std::vector<std::vector<int32_t>> &positions, const std::function<void(size_t, WireBuffer &)> &read) {
+        bool ok = Flush();
+        std::vector<uint8_t> message;
+        bool sent = false;
+        for (size_t s = 0; s < this->shards.size(); s++) {
+            if (positions[s].empty()) {
+                continue;
+            }
+            if (this->shards[s].bFailed) {
+                ok = false;
+                continue;
+            }
+            message.clear();
+            WireBuffer out(message);
+            out.Put((uint32_t) type);
+            if (type == MSG_LEVEL) {
+                out.Put(level);
+            }
+            out.Put((uint32_t) positions[s].size());
+            for (int32_t i : positions[s]) {
+                out.Put(vertices[i]);
+            }
+            if (!this->shards[s].transport->Send(message)) {
+                this->shards[s].bFailed = true;
+                ok = false;
+                continue;
+            }
+            this->stats.messages++;
+            this->stats.bytesSent += message.size();
+            sent = true;
+        }
+        for (size_t s = 0; s < this->shards.size(); s++) {
+            Shard &shard = this->shards[s];
+            if (positions[s].empty() || shard.bFailed) {
+                continue;
+            }
+            if (!shard.transport->Receive(message)) {
+                shard.bFailed = true;
+                ok = false;
+                continue;
+            }
+            this->stats.bytesReceived += message.size();
+            WireBuffer in(message);
+            read(s, in);
+            if (!in.Good()) {
+                shard.bFailed = true;
+                ok = false;
+            }
+        }
+        this->stats.rounds += sent;
+        return ok;
+    }
+
+    int32_t iSplitDepth;                                // 子树根所在的深度
+    int32_t iVexNum;                                    // 用户数
+    uint64_t iIngestSeq = 0;                            // 已处理的插入记录数
+    GraphAdjList upper;                                 // 上层树（含各子树的根）
+    ShardDirectory directory;                           // 用户目录
+    PendingEdgeBuffer pendingEdges;                     // 邀请者尚未出现的关系
+    std::vector<Shard> shards;
+    std::vector<pid_t> children;                        // 本机分片进程
+    TransportStats stats;
+};
+
+/*
+.	异步查询调度器 Query Scheduler
+.	少量工作线程按先进先出顺序恢复查询协程，不为每个查询创建线程。
+.	大的遍历每访问 yieldEvery 个用户让出一次、重新排到队尾，排在其后的小查询不必等它全部完成。
+.	析构时先执行完队列中已有的协程，再结束工作线程。
+*/
+class QueryScheduler {
+public:
+    // co_await 调度器：挂起当前协程，加入队尾，由工作线程恢复
+    struct ScheduleAwaiter {
+        QueryScheduler *scheduler;
+
+        bool await_ready() const noexcept {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> handle) const {
+            this->scheduler->_Post(handle);
+        }
+
+        void await_resume() const noexcept {
+        }
+    };
+
+    explicit QueryScheduler(int32_t threadNum = 2, int32_t yieldEvery = 4096) {
+        this->iYieldEvery = std::max(yieldEvery, 1);
+        for (int32_t i = 0; i < std::max(threadNum, 1); i++) {
+            this->workers.emplace_back([this] {
+                _Run();
+            });
+        }
+    }
+
+    ~QueryScheduler() {
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->bStopping = true;
+        }
+        this->ready.notify_all();
+        for (std::thread &worker : this->workers) {
+            worker.join();
+        }
+    }
+
+    QueryScheduler(const QueryScheduler &) = delete;
+
+    QueryScheduler &operator=(const QueryScheduler &) = delete;
+
+    // 切换到工作线程执行
+    ScheduleAwaiter Schedule() {
+        return { this };
+    }
+
+    // 让出工作线程：重新排到队尾
+    ScheduleAwaiter Yield() {
+        this->iYieldNum.fetch_add(1, std::memory_order_relaxed);
+        return { this };
+    }
+
+    // 大的遍历每访问多少个用户让出一次
+    int32_t GetYieldEvery() const {
+        return this->iYieldEvery;
+    }
+
+    uint64_t GetYieldNum() const {
+        return this->iYieldNum.load(std::memory_order_relaxed);
+    }
+
+private:
+    void _Post(std::coroutine_handle<> handle) {
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->queue.push_back(handle);
+        }
+        this->ready.notify_one();
+    }
+
+    void _Run() {
+        while (true) {
+            std::coroutine_handle<> handle;
+            {
+                std::unique_lock<std::mutex> lock(this->mutex);
+                this->ready.wait(lock, [this] {
+                    return this->bStopping || !this->queue.empty();
+                });
+                if (this->queue.empty()) {
+                    return;
+                }
+                handle = this->queue.front();
+                this->queue.pop_front();
+            }
+            handle.resume();
+        }
+    }
+
+    int32_t iYieldEvery;
+    std::atomic<uint64_t> iYieldNum{ 0 };
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<std::coroutine_handle<>> queue;          // 待恢复的协程
+    bool bStopping = false;
+    std::vector<std::thread> workers;
+};
+
+/*
+.	查询任务 Query Task
+.	查询协程的返回类型，创建后不立即执行：
+.		1.在协程中 co_await 任务，任务完成后在完成它的工作线程上恢复等待者；
+.		2.在普通线程中 Start() 发出任务（立即返回），之后 Get() 阻塞等待结果；可以先发出大量任务再逐个等待。
+.	任务对象析构时销毁协程帧，已发出但未完成的任务先等待其完成。
+.	协程中抛出的异常（如内存不足）保存在任务中，由 Get() 或 co_await 在等待方重新抛出。
+*/
+template<typename T>
+class QueryTask {
+public:
+    struct promise_type {
+        T value;
+        std::exception_ptr exception;               // 协程抛出的异常
+        std::coroutine_handle<> continuation;       // co_await 该任务的协程
+        std::mutex mutex;
+        std::condition_variable finished;
+        bool bDone = false;
+
+        QueryTask get_return_object() {
+            return QueryTask(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() noexcept {
+            return {};
+        }
+
+        // 完成：先取出等待者，再在锁内置完成标志；解锁后不再访问协程帧，Get() 返回后即可销毁它
+        struct FinalAwaiter {
+            bool await_ready() const noexcept {
+                return false;
+            }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) const noexcept {
+                promise_type &promise = handle.promise();
+                std::coroutine_handle<> next = promise.continuation ? promise.continuation : std::noop_coroutine();
+                {
+                    std::lock_guard<std::mutex> lock(promise.mutex);
+                    promise.bDone = true;
+                    promise.finished.notify_all();
+                }
+                return next;
+            }
+
+            void await_resume() const noexcept {
+            }
+        };
+
+        FinalAwaiter final_suspend() noexcept {
+            return {};
+        }
+
+        void return_value(T result) {
+            this->value = std::move(result);
+        }
+
+        // 保存异常后照常进入 final_suspend：置完成标志并恢复等待者
+        void unhandled_exception() {
+            this->exception = std::current_exception();
+        }
+
+        T TakeResult() {
+            if (this->exception) {
+                std::rethrow_exception(this->exception);
+            }
+            return std::move(this->value);
+        }
+    };
+
+    QueryTask(QueryTask &&other) noexcept : handle(std::exchange(other.handle, nullptr)),
+                                             bStarted(std::exchange(other.bStarted, false)) {
+    }
+
+    QueryTask &operator=(QueryTask &&other) noexcept {
+        if (this != &other) {
+            _Destroy();
+            this->handle = std::exchange(other.handle, nullptr);
+            this->bStarted = std::exchange(other.bStarted, false);
+        }
+        return *this;
+    }
+
+    QueryTask(const QueryTask &) = delete;
+
+    QueryTask &operator=(const QueryTask &) = delete;
+
+    ~QueryTask() {
+        _Destroy();
+    }
+
+    // 发出任务：执行到第一个挂起点（切换到调度器）后返回
+    void Start() {
+        if (!this->bStarted) {
+            this->bStarted = true;
+            this->handle.resume();
+        }
+    }
+
+    // 等待任务完成并取走结果，未发出时先发出
+    T Get() {
+        Start();
+        promise_type &promise = this->handle.promise();
+        std::unique_lock<std::mutex> lock(promise.mutex);
+        promise.finished.wait(lock, [&promise] {
+            return promise.bDone;
+        });
+        return promise.TakeResult();
+    }
+
+    // co_await 任务：记下等待者后直接转入任务执行
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) {
+        this->bStarted = true;
+        this->handle.promise().continuation = awaiting;
+        return this->handle;
+    }
+
+    T await_resume() {
+        return this->handle.promise().TakeResult();
+    }
+
+private:
+    explicit QueryTask(std::coroutine_handle<promise_type> handle) : handle(handle) {
+    }
+
+    void _Destroy() {
+        if (!this->handle) {
+            return;
+        }
+        if (this->bStarted) {
+            promise_type &promise = this->handle.promise();
+            std::unique_lock<std::mutex> lock(promise.mutex);
+            promise.finished.wait(lock, [&promise] {
+                return promise.bDone;
+            });
+        }
+        this->handle.destroy();
+        this->handle = nullptr;
+    }
+
+    std::coroutine_handle<promise_type> handle;
+    bool bStarted = false;
+};
+
+/*
+.	异步查询 Async Graph
+.	在调度器的工作线程上执行 GraphAdjList 的只读查询，返回 QueryTask；结果与同步查询相同。
+.	下级查询按层分段展开，每展开 yieldEvery 个用户让出一次；上级查询每上溯 yieldEvery 步让出一次。
+.	注：多个查询可以并发执行，但查询期间（从发出到完成）不得修改图。
+*/
+class AsyncGraph {
+public:
+    AsyncGraph(GraphAdjList &graph, QueryScheduler &scheduler) : graph(graph), scheduler(scheduler) {
+    }
+
+    // 查找用户的所有上级：从直接邀请者到根用户，用户不存在时返回空
+    QueryTask<std::vector<Uid>> GetAncestors(Uid vertex) {
+        co_await this->scheduler.Schedule();
+        std::vector<Uid> ancestors;
+        int32_t budget = this->scheduler.GetYieldEvery();
+        for (Uid preID = this->graph.GetInviter(vertex); preID != NO_UID; preID = this->graph.GetInviter(preID)) {
+            ancestors.push_back(preID);
+            if (--budget == 0) {
+                co_await this->scheduler.Yield();
+                budget = this->scheduler.GetYieldEvery();
+            }
+        }
+        co_return ancestors;
+    }
+
+    // 查找用户的所有下级，按邀请等级分层：第 i 个元素为第 i + 1 级下级
+    QueryTask<std::vector<std::vector<Uid>>> GetDownline(Uid vertex) {
+        co_await this->scheduler.Schedule();
+        std::vector<std::vector<Uid>> levels;
+        if (!this->graph.Contains(vertex)) {
+            co_return levels;
+        }
+        std::vector<Uid> frontier = { vertex }, next;
+        int32_t budget = this->scheduler.GetYieldEvery();
+        while (true) {
+            next.clear();
+            for (size_t pos = 0; pos < frontier.size();) {
+                pos = _Expand(frontier, pos, next, budget);
+                if (budget == 0) {
+                    co_await this->scheduler.Yield();
+                    budget = this->scheduler.GetYieldEvery();
+                }
+            }
+            if (next.empty()) {
+                break;
+            }
+            levels.push_back(next);
+            frontier.swap(next);
+        }
+        co_return levels;
+    }
+
+    // 查找用户的第 n 级下级（n >= 1）
+    QueryTask<std::vector<Uid>> GetNthLevel(Uid vertex, int32_t n) {
+        co_await this->scheduler.Schedule();
+        std::vector<Uid> frontier, next;
+        if (n < 1 || !this->graph.Contains(vertex)) {
+            co_return frontier;
+        }
+        frontier.push_back(vertex);
+        int32_t budget = this->scheduler.GetYieldEvery();
+        for (int32_t level = 0; level < n && !frontier.empty(); level++) {
+            next.clear();
+            for (size_t pos = 0; pos < frontier.size();) {
+                pos = _Expand(frontier, pos, next, budget);
+                if (budget == 0) {
+                    co_await this->scheduler.Yield();
+                    budget = this->scheduler.GetYieldEvery();
+                }
+            }
+            frontier.swap(next);
+        }
+        co_return frontier;
+    }
+
+private:
+    // 从 frontier[pos] 起展开至多 budget 个用户，下级追加到 next，返回下一个未展开的位置
+    size_t _Expand(const std::vector<Uid> &frontier, size_t pos, std::vector<Uid> &next, int32_t &budget) {
+        size_t n = std::min(frontier.size() - pos, (size_t) budget);
+        this->graph.GetChildren(std::span<const Uid>(frontier).subspan(pos, n), next);
+        budget -= (int32_t) n;
+        return pos + n;
+    }
+
+    GraphAdjList &graph;
+    QueryScheduler &scheduler;
+};
+
+/*
+.	邀请日志导入器 Invite Log Importer
+.	日志格式：
+.		1.文本：每行 "preID,newID"，以 '#' 开头的行视为注释。
+.		2.二进制：定长记录，每条记录为两个小端 Uid（preID, newID），即默认 8 字节、64 位ID时 16 字节。
+.	实现说明：
+.		1.优先 mmap 整个文件，失败时退化为大块缓冲读取；按窗口顺序处理，解析结果占用内存与窗口大小成正比。
+.		2.每个窗口按行（记录）边界切成若干块，由多个线程并行解析，整数解析使用 SWAR（寄存器内 SIMD）一次处理 8 位数字。
+.		3.邀请者尚未出现的记录由图的待定边缓冲暂存，邀请者插入后立即补插其下级，无需对日志预先排序。
+*/
+enum LOG_FORMAT {
+    LOG_TEXT, LOG_BINARY
+};
+
+// 导入统计
+struct ImportStats {
+    uint64_t bytes = 0;         // 读取字节数
+    uint64_t records = 0;       // 解析出的记录数
+    uint64_t malformed = 0;     // 无法解析的行数
+    uint64_t edges = 0;         // 成功插入的邀请关系数（含补插）
+    uint64_t pending = 0;       // 导入结束时仍在等待邀请者的记录数
+    uint64_t evicted = 0;       // 因待定边缓冲容量不足而丢弃的记录数
+    double parseSeconds = 0;    // 解析耗时
+    double buildSeconds = 0;    // 建图耗时
+    double totalSeconds = 0;    // 总耗时
+
+    double MBPerSecond() const {
+        return totalSeconds > 0 ? bytes / (1024.0 * 1024.0) / totalSeconds : 0;
+    }
+
+    double EdgesPerSecond() const {
+        return totalSeconds > 0 ? edges / totalSeconds : 0;
+    }
+};
+
+class InviteLogImporter {
+public:
+    // threadNum 为 0 时使用硬件线程数
+    explicit InviteLogImporter(int32_t threadNum = 0, size_t windowSize = _DEFAULT_WINDOW_SIZE) {
+        this->iThreadNum = threadNum > 0 ? threadNum : (int32_t) std::max(1u, std::thread::hardware_concurrency());
+        this->windowSize = std::max(windowSize, (size_t) (1 << 20));
+    }
+
+    // 导入日志文件到图中，文件无法打开或读取出错时返回 false（出错前已读到的记录仍会导入）
+    bool Import(const std::string &path, LOG_FORMAT format, GraphAdjList &graph, ImportStats &stats) {
+        auto start = std::chrono::steady_clock::now();
+        stats = ImportStats();
+        int32_t vexNum = graph.GetVexNum();
+        uint64_t evicted = graph.GetPendingMetrics().evicted;
+
+        int32_t fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            return false;
+        }
+        size_t fileSize = (size_t) st.st_size;
+
+        // 1.优先 mmap
+        void *mapped = fileSize > 0 ? mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+        if (mapped != MAP_FAILED) {
+            madvise(mapped, fileSize, MADV_SEQUENTIAL);
+            const char *base = (const char *) mapped;
+            size_t offset = 0;
+            while (offset < fileSize) {
+                size_t end = _WindowEnd(base, offset, fileSize, format);
+                _ProcessWindow(base + offset, base + end, format, graph, stats);
+                offset = end;
+            }
+            munmap(mapped, fileSize);
+            stats.bytes = fileSize;
+        } else {
+            // 2.退化为缓冲读取，窗口末尾不完整的行（记录）留到下一窗口；一行比窗口还长时扩大窗口
+            size_t window = this->windowSize;
+            std::vector<char> buffer(window + 16);
+            size_t carry = 0;
+            while (true) {
+                if (carry == window) {
+                    window *= 2;
+                    buffer.resize(window + 16);
+                }
+                ssize_t n = read(fd, buffer.data() + carry, window - carry);
+                if (n < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (n < 0) {
+                    close(fd);
+                    return false;
+                }
+                if (n == 0) {
+                    break;
+                }
+                stats.bytes += (uint64_t) n;
+                size_t length = carry + (size_t) n;
+                size_t end = _CompleteLength(buffer.data(), length, format);
+                _ProcessWindow(buffer.data(), buffer.data() + end, format, graph, stats);
+                carry = length - end;
+                memmove(buffer.data(), buffer.data() + end, carry);
+            }
+            if (carry > 0) {
+                _ProcessWindow(buffer.data(), buffer.data() + carry, format, graph, stats);
+            }
+        }
+        close(fd);
+
+        // 3.仍在等待的记录留在图的待定边缓冲中，后续数据可继续补插
+        PendingEdgeBuffer::Metrics metrics = graph.GetPendingMetrics();
+        stats.edges = (uint64_t) (graph.GetVexNum() - vexNum);
+        stats.pending = metrics.pendingCount;
+        stats.evicted = metrics.evicted - evicted;
+
+        stats.totalSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return true;
+    }
+
+private:
+    static const size_t _DEFAULT_WINDOW_SIZE = 64 << 20;   // 默认窗口大小：64MB
+
+    int32_t iThreadNum;     // 解析线程数
+    size_t windowSize;      // 窗口大小
+
+    // 确定从 offset 开始的窗口结束位置（落在行或记录边界上）
+    size_t _WindowEnd(const char *base, size_t offset, size_t fileSize, LOG_FORMAT format) const {
+        if (fileSize - offset <= this->windowSize) {
+            return fileSize;
+        }
+        return offset + _LastBoundary(base + offset, this->windowSize, format);
+    }
+
+    // [0, length) 内最后一个完整行（记录）之后的位置，找不到边界时返回 length
+    static size_t _LastBoundary(const char *data, size_t length, LOG_FORMAT format) {
+        size_t end = _CompleteLength(data, length, format);
+        return end == 0 ? length : end;
+    }
+
+    // [0, length) 内完整行（记录）的总长度，没有完整的行（记录）时返回 0
+    static size_t _CompleteLength(const char *data, size_t length, LOG_FORMAT format) {
+        if (format == LOG_BINARY) {
+            return length - length % (2 * sizeof(Uid));
+        }
+        const char *p = (const char *) memrchr(data, '\n', length);
+        return p == nullptr ? 0 : (size_t) (p - data) + 1;
+    }
+
+    // 并行解析一个窗口，并将结果送入建图
+    void _ProcessWindow(const char *begin, const char *end, LOG_FORMAT format, GraphAdjList &graph, ImportStats &stats) {
+        auto parseStart = std::chrono::steady_clock::now();
+
+        // 1.按行（记录）边界切块
+        size_t length = (size_t) (end - begin);
+        int32_t chunkNum = length < (1 << 16) ? 1 : this->iThreadNum;
+        std::vector<const char *> bounds(chunkNum + 1);
+        bounds[0] = begin;
+        bounds[chunkNum] = end;
+        for (int32_t i = 1; i < chunkNum; i++) {
+            const char *p = begin + length / chunkNum * i;
+            if (format == LOG_BINARY) {
+                p = begin + (size_t) (p - begin) / (2 * sizeof(Uid)) * (2 * sizeof(Uid));
+            } else {
+                p = (const char *) memchr(p, '\n', (size_t) (end - p));
+                p = p == nullptr ? end : p + 1;
+            }
+            bounds[i] = std::max(p, bounds[i - 1]);
+        }
+
+        // 2.并行解析
+        std::vector<std::vector<GraphAdjList::EdgeData>> results(chunkNum);
+        std::vector<uint64_t> malformed(chunkNum, 0);
+        std::vector<std::thread> workers;
+        for (int32_t i = 1; i < chunkNum; i++) {
+            workers.emplace_back([&, i]() {
+                _ParseChunk(bounds[i], std::max(bounds[i], bounds[i + 1]), format, results[i], malformed[i]);
+            });
+        }
+        _ParseChunk(bounds[0], bounds[1], format, results[0], malformed[0]);
+        for (auto &worker : workers) {
+            worker.join();
+        }
+
+        auto buildStart = std::chrono::steady_clock::now();
+        stats.parseSeconds += std::chrono::duration<double>(buildStart - parseStart).count();
+
+        // 3.按文件顺序建图
+        for (int32_t i = 0; i < chunkNum; i++) {
+            stats.malformed += malformed[i];
+            stats.records += results[i].size();
+            graph.addInviteRelationships(results[i]);
+        }
+
+        stats.buildSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - buildStart).count();
+    }
+
+    // 解析一个块
+    static void _ParseChunk(const char *p, const char *end, LOG_FORMAT format,
+                            std::vector<GraphAdjList::EdgeData> &edges, uint64_t &malformed) {
+        if (format == LOG_BINARY) {
+            size_t count = (size_t) (end - p) / (2 * sizeof(Uid));
+            edges.resize(count);
+            for (size_t i = 0; i < count; i++, p += 2 * sizeof(Uid)) {
+                memcpy(&edges[i].Tail, p, sizeof(Uid));
+                memcpy(&edges[i].Head, p + sizeof(Uid), sizeof(Uid));
+            }
+            return;
+        }
+
+        edges.reserve((size_t) (end - p) / 12);
+        while (p < end) {
+            const char *lineEnd = (const char *) memchr(p, '\n', (size_t) (end - p));
+            if (lineEnd == nullptr) {
+                lineEnd = end;
+            }
+            // 跳过空行与注释行
+            if (p != lineEnd && *p != '#' && *p != '\r') {
+                Uid preID, newID;
+                const char *q = _ParseInt(p, lineEnd, preID);
+                if (q != nullptr && q < lineEnd && *q == ',' &&
+                    (q = _ParseInt(q + 1, lineEnd, newID)) != nullptr &&
+                    (q == lineEnd || *q == '\r')) {
+                    edges.push_back({ preID, newID });
+                } else {
+                    malformed++;
+                }
+            }
+            p = lineEnd + 1;
+        }
+    }
+
+    // 解析非负十进制整数，返回数字之后的位置，失败返回 nullptr
+    static const char *_ParseInt(const char *p, const char *end, Uid &value) {
+        uint64_t result = 0;
+        const char *start = p;
+
+        // 1.SWAR：一次判断并转换 8 位数字
+        if (end - p >= 8) {
+            uint64_t chunk;
+            memcpy(&chunk, p, sizeof(chunk));
+            if (_IsEightDigits(chunk)) {
+                result = _ParseEightDigits(chunk);
+                p += 8;
+            }
+        }
+
+        // 2.剩余数字逐位处理
+        while (p < end && (uint8_t) (*p - '0') <= 9) {
+            result = result * 10 + (uint64_t) (*p - '0');
+            p++;
+        }
+
+        // 位数上限使 result 不会溢出：int32_t 为 10 位，int64_t 为 19 位
+        if (p == start || p - start > std::numeric_limits<Uid>::digits10 + 1 ||
+            result > (uint64_t) std::numeric_limits<Uid>::max()) {
+            return nullptr;
+        }
+        value = (Uid) result;
+        return p;
+    }
+
+    // 8 个字节是否全为 '0'~'9'
+    static bool _IsEightDigits(uint64_t chunk) {
+        return (((chunk & 0xF0F0F0F0F0F0F0F0ULL) |
+                 (((chunk + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) ==
+                0x3333333333333333ULL);
+    }
+
+    // 将 8 位数字（小端，首字符在最低字节）转换为整数
+    static uint64_t _ParseEightDigits(uint64_t chunk) {
+        chunk -= 0x3030303030303030ULL;
+        chunk = (chunk * 10 + (chunk >> 8)) & 0x00FF00FF00FF00FFULL;
+        chunk = (chunk * 100 + (chunk >> 16)) & 0x0000FFFF0000FFFFULL;
+        chunk = (chunk * 10000 + (chunk >> 32)) & 0x00000000FFFFFFFFULL;
+        return chunk;
+    }
+};
+
+// 导入邀请日志并报告吞吐量
+int32_t RunImport(int32_t argc, char *argv[]) {
+    if (argc < 3) {
+        std::cout << "用法：" << argv[0] << " import <文件> [text|binary] [线程数] [text|json]" << std::endl;
+        return 1;
+    }
+    LOG_FORMAT format = (argc > 3 && std::string(argv[3]) == "binary") ? LOG_BINARY : LOG_TEXT;
+    int32_t threadNum = argc > 4 ? std::atoi(argv[4]) : 0;
+
+    GraphAdjList *graph = new GraphAdjList();
+    graph->Init();
+
+    InviteLogImporter importer(threadNum);
+    ImportStats stats;
+    if (!importer.Import(argv[2], format, *graph, stats)) {
+        std::cout << "无法打开或读取文件：" << argv[2] << std::endl;
+        delete graph;
+        return 1;
+    }
+
+    std::cout << "读取：" << stats.bytes << " 字节，记录：" << stats.records
+              << "，插入：" << stats.edges << "，等待：" << stats.pending << "，淘汰：" << stats.evicted
+              << "，格式错误：" << stats.malformed << std::endl;
+    std::cout << "解析：" << stats.parseSeconds << " s，建图：" << stats.buildSeconds
+              << " s，总计：" << stats.totalSeconds << " s" << std::endl;
+    std::cout << "吞吐：" << stats.MBPerSecond() << " MB/s，" << stats.EdgesPerSecond() << " edges/s" << std::endl;
+
+    PendingEdgeBuffer::Metrics metrics = graph->GetPendingMetrics();
+    std::cout << "待定边：" << metrics.pendingCount << " 条（" << metrics.bucketCount << " 个邀请者），累计暂存："
+              << metrics.parked << "，已补插：" << metrics.resolved << "，淘汰：" << metrics.evicted
+              << "，最早等待：" << metrics.oldestAgeRecords << " 条记录 / " << metrics.oldestAgeSeconds << " s" << std::endl;
+
+    // 埋点统计：第 5 个参数指定输出格式
+    if (argc > 5) {
+        Instrumentation::Snapshot snapshot = Instrumentation::Collect();
+        if (std::string(argv[5]) == "json") {
+            snapshot.PrintJson(std::cout);
+        } else {
+            snapshot.PrintText(std::cout);
+        }
+    }
+
+    delete graph;
+    return 0;
+}
+
+/*
+.	基准测试 Benchmark
+.	合成邀请森林（幂律扇出、深链、宽星形），测量 B+ 树与图的热点操作：
+.		B+ 树：插入、点查询、范围扫描；
+.		图：邀请关系插入、上级链、全部下级、第 N 级下级。
+.	每项输出延迟分位数、吞吐量，每组结束后输出进程峰值常驻内存（RSS）。
+*/
+enum FOREST_SHAPE {
+    SHAPE_POWERLAW, SHAPE_CHAIN, SHAPE_STAR
+};
+
+const char *ShapeName(FOREST_SHAPE shape) {
+    switch (shape) {
+        case SHAPE_POWERLAW:
+            return "powerlaw";
+        case SHAPE_CHAIN:
+            return "chain";
+        default:
+            return "star";
+    }
+}
+
+// 生成 n 个用户（根用户 0 之外）的邀请关系，邀请者总在被邀请者之前
+std::vector<GraphAdjList::EdgeData> GenerateForest(FOREST_SHAPE shape, int32_t n, uint64_t seed) {
+    std::vector<GraphAdjList::EdgeData> edges;
+    edges.reserve(n);
+    std::mt19937_64 rng(seed);
+
+    // 优先连接：每个用户按 (1 + 已邀请人数) 的权重被选为邀请者，扇出服从幂律分布
+    std::vector<int32_t> tickets = { 0 };
+    for (int32_t id = 1; id <= n; id++) {
+        int32_t preID;
+        switch (shape) {
+            case SHAPE_POWERLAW:
+                preID = tickets[rng() % tickets.size()];
+                tickets.push_back(preID);
+                tickets.push_back(id);
+                break;
+            case SHAPE_CHAIN:
+                preID = id - 1;
+                break;
+            default:
+                preID = 0;
+                break;
+        }
+        edges.push_back({ preID, id });
+    }
+    return edges;
+}
+
+// 延迟样本统计
+class LatencyRecorder {
+public:
+    explicit LatencyRecorder(const std::string &name) : name(name) {
+    }
+
+    void Add(double nanoseconds) {
+        this->samples.push_back(nanoseconds);
+    }
+
+    // 输出：操作数、p50/p90/p99/p99.9/max（微秒）、吞吐量
+    void Report(double totalSeconds, uint64_t ops) {
+        std::sort(this->samples.begin(), this->samples.end());
+        auto percentile = [&](double p) {
+            if (this->samples.empty()) {
+                return 0.0;
+            }
+            size_t index = std::min(this->samples.size() - 1, (size_t) (p * this->samples.size()));
+            return this->samples[index] / 1000.0;
+        };
+        printf("  %-14s %10lu ops  p50 %9.3f  p90 %9.3f  p99 %9.3f  p999 %9.3f  max %10.3f us  %12.0f ops/s\n",
+               this->name.c_str(), (unsigned long) ops, percentile(0.5), percentile(0.9), percentile(0.99),
+               percentile(0.999), this->samples.empty() ? 0.0 : this->samples.back() / 1000.0,
+               totalSeconds > 0 ? ops / totalSeconds : 0.0);
+    }
+
+private:
+    std::string name;
+    std::vector<double> samples;
+};
+
+// 硬件计数器（Linux perf_event）：末级缓存未命中、L1 数据缓存读未命中、数据 TLB 读未命中
+// 内核或容器不允许时计数器不可用，输出为 n/a
+class PerfCounters {
+public:
+    static const int32_t COUNTER_NUM = 3;
+
+    PerfCounters() {
+#if defined(__linux__)
+        const uint64_t configs[COUNTER_NUM][2] = {
+                { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+                { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+                { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+        };
+        for (int32_t i = 0; i < COUNTER_NUM; i++) {
+            struct perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = (uint32_t) configs[i][0];
+            attr.config = configs[i][1];
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            this->fds[i] = (int32_t) syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+        }
+#endif
+    }
+
+    ~PerfCounters() {
+        for (int32_t fd : this->fds) {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+        }
+    }
+
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+    void Start() {
+#if defined(__linux__)
+        for (int32_t fd : this->fds) {
+            if (fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+#endif
+    }
+
+    void Stop() {
+#if defined(__linux__)
+        for (int32_t i = 0; i < COUNTER_NUM; i++) {
+            this->values[i] = -1;
+            uint64_t value;
+            if (this->fds[i] >= 0) {
+                ioctl(this->fds[i], PERF_EVENT_IOC_DISABLE, 0);
+                if (read(this->fds[i], &value, sizeof(value)) == (ssize_t) sizeof(value)) {
+                    this->values[i] = (int64_t) value;
+                }
+            }
+        }
+#endif
+    }
+
+    // 每次操作的计数，格式化为字符串；计数器不可用时为 n/a
+    std::string PerOp(int32_t i, uint64_t ops) const {
+        if (this->values[i] < 0 || ops == 0) {
+            return "n/a";
+        }
+        char text[32];
+        snprintf(text, sizeof(text), "%.2f", (double) this->values[i] / (double) ops);
+        return text;
+    }
+
+private:
+    int32_t fds[COUNTER_NUM] = { -1, -1, -1 };
+    int64_t values[COUNTER_NUM] = { -1, -1, -1 };
+};
+
+// 进程峰值常驻内存（MB）
+double PeakRSSMB() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024.0;
+}
+
+// 计时执行：每次操作记录延迟，ops 次或超过时间预算后停止；样本过多时按步长采样
+template<typename Op>
+void TimeOps(const std::string &name, uint64_t ops, double budgetSeconds, Op &&op) {
+    using Clock = std::chrono::steady_clock;
+    LatencyRecorder recorder(name);
+    uint64_t stride = std::max<uint64_t>(1, ops / 1000000);
+    auto start = Clock::now();
+    uint64_t done = 0;
+    for (; done < ops; done++) {
+        if (done % stride == 0) {
+            auto t0 = Clock::now();
+            op(done);
+            recorder.Add(std::chrono::duration<double, std::nano>(Clock::now() - t0).count());
+            if (std::chrono::duration<double>(Clock::now() - start).count() > budgetSeconds) {
+                done++;
+                break;
+            }
+        } else {
+            op(done);
+        }
+    }
+    recorder.Report(std::chrono::duration<double>(Clock::now() - start).count(), done);
+}
+
+// 单组基准测试：一种形状、一个规模
+void BenchForest(FOREST_SHAPE shape, int32_t n, uint64_t seed) {
+    const double budget = 5.0;      // 每项查询的时间预算（秒）
+    const int32_t queryNum = 100000;
+    printf("[%s n=%d]\n", ShapeName(shape), n);
+
+    std::vector<GraphAdjList::EdgeData> edges = GenerateForest(shape, n, seed);
+    std::mt19937_64 rng(seed + 1);
+    std::vector<Uid> randomIDs(queryNum);
+    for (auto &id : randomIDs) {
+        id = (Uid) (rng() % (uint64_t) (n + 1));
+    }
+    uint64_t sink = 0;
+
+    // 1.B+ 树
+    {
+        std::vector<int32_t> keys(n);
+        for (int32_t i = 0; i < n; i++) {
+            keys[i] = edges[i].Head;
+        }
+        std::shuffle(keys.begin(), keys.end(), rng);
+        BPlusTree<int32_t, int32_t> tree;
+        TimeOps("tree.insert", n, 1e9, [&](uint64_t i) {
+            tree.insert(keys[i], keys[i]);
+        });
+        TimeOps("tree.search", queryNum, budget, [&](uint64_t i) {
+            sink += tree.search(randomIDs[i]);
+        });
+        std::vector<int32_t> range;
+        TimeOps("tree.range100", queryNum, budget, [&](uint64_t i) {
+            range.clear();
+            tree.select(randomIDs[i], randomIDs[i] + 99, range);
+            sink += range.size();
+        });
+        TimeOps("tree.erase", n, 1e9, [&](uint64_t i) {
+            sink += tree.erase(keys[n - 1 - i]);
+        });
+
+        // 批量删除：每批 1000 个随机键值，批内升序
+        const int32_t batch = 1000;
+        for (int32_t i = 0; i < n; i++) {
+            tree.insert(keys[i], keys[i]);
+        }
+        for (int32_t i = 0; i < n; i += batch) {
+            std::sort(keys.begin() + i, keys.begin() + std::min(n, i + batch));
+        }
+        TimeOps("tree.erase1k", (n + batch - 1) / batch, 1e9, [&](uint64_t i) {
+            int32_t first = (int32_t) i * batch;
+            sink += tree.eraseSorted(std::span<const int32_t>(keys.data() + first, std::min(batch, n - first)));
+        });
+    }
+
+    // 2.图
+    GraphAdjList *graph = new GraphAdjList();
+    graph->Init();
+    TimeOps("graph.insert", n, 1e9, [&](uint64_t i) {
+        graph->addInviteRelationship(edges[i].Tail, edges[i].Head);
+    });
+    TimeOps("graph.ancestors", queryNum, budget, [&](uint64_t i) {
+        sink += graph->GetAncestors(randomIDs[i]).size();
+    });
+    TimeOps("graph.downline", queryNum, budget, [&](uint64_t i) {
+        sink += graph->GetDownline(randomIDs[i]).size();
+    });
+    TimeOps("graph.level3", queryNum, budget, [&](uint64_t i) {
+        sink += graph->GetNthLevel(randomIDs[i], 3).size();
+    });
+    TimeOps("graph.root.lv2", 100, budget, [&](uint64_t) {
+        sink += graph->GetNthLevel(0, 2).size();
+    });
+
+    // 深度分区索引：启用时构建，之后与逐层遍历对比同样的查询
+    auto buildStart = std::chrono::steady_clock::now();
+    graph->EnableDepthIndex(true);
+    double buildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - buildStart).count();
+    printf("  %-14s %10d vexs  total %9.3f ms  %12.1f MB\n", "index.build", graph->GetVexNum(), buildSeconds * 1000,
+           graph->GetDepthIndexBytes() / 1048576.0);
+    TimeOps("index.level3", queryNum, budget, [&](uint64_t i) {
+        sink += graph->GetNthLevel(randomIDs[i], 3).size();
+    });
+    TimeOps("index.root.lv2", 100, budget, [&](uint64_t) {
+        sink += graph->GetNthLevel(0, 2).size();
+    });
+
+    // 索引启用时插入新用户（增量加入索引），之后的查询仍使用索引
+    std::mt19937_64 inviterRng(seed + 2);
+    std::vector<Uid> inviters(n / 10);
+    for (auto &id : inviters) {
+        id = (Uid) (inviterRng() % (uint64_t) (n + 1));
+    }
+    TimeOps("index.insert", inviters.size(), 1e9, [&](uint64_t i) {
+        graph->addInviteRelationship(inviters[i], (Uid) (n + 1 + i));
+    });
+    TimeOps("index.level3", queryNum, budget, [&](uint64_t i) {
+        sink += graph->GetNthLevel(randomIDs[i], 3).size();
+    });
+    graph->EnableDepthIndex(false);
+
+    // 3.删除用户：随机 10^5 个（不超过一半用户），下级挂到被删除用户的邀请者下
+    std::vector<Uid> victims(n);
+    for (int32_t i = 0; i < n; i++) {
+        victims[i] = i + 1;
+    }
+    std::shuffle(victims.begin(), victims.end(), rng);
+    victims.resize(std::min(n / 2, 100000));
+    TimeOps("graph.delete", victims.size(), 1e9, [&](uint64_t i) {
+        sink += graph->DeleteUser(victims[i]);
+    });
+    delete graph;
+
+    graph = new GraphAdjList();
+    graph->Init();
+    graph->addInviteRelationships(edges);
+    auto start = std::chrono::steady_clock::now();
+    sink += graph->DeleteUsers(victims);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("  %-14s %10lu ops  total %9.3f ms  %12.0f ops/s\n", "graph.deleteAll",
+           (unsigned long) victims.size(), seconds * 1000, seconds > 0 ? victims.size() / seconds : 0.0);
+    delete graph;
+
+    printf("  peak RSS %.1f MB  (checksum %lu)\n", PeakRSSMB(), (unsigned long) sink);
+}
+
+// bench graph [powerlaw|chain|star|all] [规模...]
+int32_t RunGraphBench(int32_t argc, char *argv[]) {
+    std::vector<FOREST_SHAPE> shapes = { SHAPE_POWERLAW, SHAPE_CHAIN, SHAPE_STAR };
+    if (argc > 3 && std::string(argv[3]) != "all") {
+        std::string name = argv[3];
+        shapes = { name == "chain" ? SHAPE_CHAIN : name == "star" ? SHAPE_STAR : SHAPE_POWERLAW };
+    }
+    std::vector<int32_t> sizes;
+    for (int32_t i = 4; i < argc; i++) {
+        sizes.push_back(std::atoi(argv[i]));
+    }
+    if (sizes.empty()) {
+        sizes = { 1000, 10000, 100000 };
+    }
+
+    for (FOREST_SHAPE shape : shapes) {
+        for (int32_t n : sizes) {
+            BenchForest(shape, n, 42);
+        }
+    }
+    return 0;
+}
+
+// bench memory [规模...]：幂律邀请森林中按存储级别统计下级集合内存，并与每个邀请者都使用 B+ 树边表对比
+int32_t RunMemoryBench(int32_t argc, char *argv[]) {
+    const char *tierNames[] = { "inline", "array", "tree" };
+    std::vector<int32_t> sizes;
+    for (int32_t i = 3; i < argc; i++) {
+        sizes.push_back(std::atoi(argv[i]));
+    }
+    if (sizes.empty()) {
+        sizes = { 100000, 1000000 };
+    }
+
+    for (int32_t n : sizes) {
+        std::vector<GraphAdjList::EdgeData> edges = GenerateForest(SHAPE_POWERLAW, n, 42);
+        GraphAdjList *graph = new GraphAdjList();
+        graph->Init();
+        for (const auto &edge : edges) {
+            graph->addInviteRelationship(edge.Tail, edge.Head);
+        }
+        GraphAdjList::MemoryReport memory = graph->GetMemoryReport();
+        const GraphAdjList::ChildStorageReport &report = memory.children;
+        delete graph;
+
+        printf("[powerlaw n=%d] 用户 %ld，无下级 %ld，下级集合（顶点结点内）%zu B/用户\n",
+               n, (long) report.vertices, (long) report.leafVertices,
+               (size_t) (report.inlineBytes / std::max<int64_t>(1, report.vertices)));
+        int64_t total = report.inlineBytes;
+        for (int32_t t = 0; t < 3; t++) {
+            const GraphAdjList::ChildTierStats &tier = report.tiers[t];
+            int64_t bytes = tier.allocatedBytes;
+            total += bytes;
+            printf("  %-7s 顶点 %9ld  下级 %10ld  堆内存 %12ld B  分配器占用 %12ld B  %8.2f B/下级\n",
+                   tierNames[t], (long) tier.vertices, (long) tier.children, (long) tier.heapBytes, (long) bytes,
+                   tier.children > 0 ? (double) bytes / tier.children : 0.0);
+        }
+
+        // 对比：每个有下级的用户都使用一棵 B+ 树边表（分级前的存储方式）
+        std::vector<int32_t> fanout(n + 1, 0);
+        for (const auto &edge : edges) {
+            fanout[edge.Tail]++;
+        }
+        int64_t treeBytes = 0;
+        for (int32_t count : fanout) {
+            if (count == 0) {
+                continue;
+            }
+            BPlusTree<int32_t, int32_t> *tree = new BPlusTree<int32_t, int32_t>();
+            for (int32_t i = 0; i < count; i++) {
+                tree->insert(i, i);
+            }
+            treeBytes += (int64_t) AllocatedSize(tree, sizeof(*tree)) + tree->stats().allocatedBytes;
+            delete tree;
+        }
+        treeBytes += report.vertices * (int64_t) sizeof(void *);      // 顶点结点中的边表指针
+
+        printf("  分级存储：%8.2f B/用户    全部 B+ 树：%8.2f B/用户\n",
+               (double) total / std::max<int64_t>(1, report.vertices),
+               (double) treeBytes / std::max<int64_t>(1, report.vertices));
+        memory.Print(std::cout);
+    }
+    return 0;
+}
+
+// bench snapshot [规模...]：幂律邀请森林的压缩邻接表快照与在线图对比内存和遍历速度
+int32_t RunSnapshotBench(int32_t argc, char *argv[]) {
+    const double budget = 5.0;
+    const int32_t queryNum = 100000;
+    std::vector<int32_t> sizes;
+    for (int32_t i = 3; i < argc; i++) {
+        sizes.push_back(std::atoi(argv[i]));
+    }
+    if (sizes.empty()) {
+        sizes = { 1000000 };
     }
 
-    // 析构函数
-    ~GraphAdjList() {
+    for (int32_t n : sizes) {
+        printf("[powerlaw n=%d]\n", n);
+        std::vector<GraphAdjList::EdgeData> edges = GenerateForest(SHAPE_POWERLAW, n, 42);
+        GraphAdjList *graph = new GraphAdjList();
+        graph->Init();
+        graph->addInviteRelationships(edges);
+
+        // 1.内存：在线图为顶点表与下级集合
+        GraphAdjList::MemoryReport memory = graph->GetMemoryReport();
+        int64_t liveBytes = memory.vertexTable.allocatedBytes + memory.children.AllocatedBytes();
+        CompressedAdjacency snapshot;
+        auto start = std::chrono::steady_clock::now();
+        graph->Snapshot(snapshot);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        int64_t edgeNum = std::max<int64_t>(1, snapshot.GetEdgeNum());
+        printf("  在线图 %10.1f MB (%6.2f B/边)   快照 %10.1f MB (%6.2f B/边)   %5.1f%%   构建 %.3f s\n",
+               liveBytes / 1048576.0, (double) liveBytes / edgeNum, snapshot.Bytes() / 1048576.0,
+               (double) snapshot.Bytes() / edgeNum, 100.0 * snapshot.Bytes() / liveBytes, seconds);
+
+        // 2.遍历：同一批随机用户，结果逐一比对
+        std::mt19937_64 rng(43);
+        std::vector<Uid> randomIDs(queryNum);
+        for (auto &id : randomIDs) {
+            id = (Uid) (rng() % (uint64_t) (n + 1));
+        }
+        int32_t mismatch = 0;
+        for (int32_t i = 0; i < 1000; i++) {
+            mismatch += graph->GetNthLevel(randomIDs[i], 3) != snapshot.GetNthLevel(randomIDs[i], 3);
+        }
+        uint64_t sink = 0;
+        TimeOps("graph.level3", queryNum, budget, [&](uint64_t i) {
+            sink += graph->GetNthLevel(randomIDs[i], 3).size();
+        });
+        TimeOps("snap.level3", queryNum, budget, [&](uint64_t i) {
+            sink += snapshot.GetNthLevel(randomIDs[i], 3).size();
+        });
+        TimeOps("graph.downline", queryNum, budget, [&](uint64_t i) {
+            sink += graph->GetDownline(randomIDs[i]).size();
+        });
+        TimeOps("snap.downline", queryNum, budget, [&](uint64_t i) {
+            sink += snapshot.GetDownline(randomIDs[i]).size();
+        });
+        TimeOps("graph.root.lv2", 100, budget, [&](uint64_t) {
+            sink += graph->GetNthLevel(0, 2).size();
+        });
+        TimeOps("snap.root.lv2", 100, budget, [&](uint64_t) {
+            sink += snapshot.GetNthLevel(0, 2).size();
+        });
+        printf("  结果不一致 %d / 1000  (checksum %lu)\n", mismatch, (unsigned long) sink);
+        delete graph;
+    }
+    return 0;
+}
 
+// bench instrument [规模] [text|json]：逐条插入幂律邀请森林并执行随机查询，输出埋点统计（需 -DINVITE_INSTRUMENT=1）
+int32_t RunInstrumentBench(int32_t argc, char *argv[]) {
+    int32_t n = argc > 3 ? std::atoi(argv[3]) : 1000000;
+    bool json = argc > 4 && std::string(argv[4]) == "json";
+    const int32_t queryNum = 100000;
+
+    std::vector<GraphAdjList::EdgeData> edges = GenerateForest(SHAPE_POWERLAW, n, 42);
+    GraphAdjList *graph = new GraphAdjList();
+    graph->Init();
+    Instrumentation::Reset();
+    for (const GraphAdjList::EdgeData &edge : edges) {
+        graph->addInviteRelationship(edge.Tail, edge.Head);
     }
 
-    // 初始化顶点、边数据为 图|网
-    void Init() {
-        // 1.创建顶点集
-        VertexNode vertexNode = { 0, -1, nullptr };
-        this->vexs.insert(0, vertexNode);
+    std::mt19937_64 rng(43);
+    uint64_t sink = 0;
+    for (int32_t i = 0; i < queryNum; i++) {
+        int32_t id = (int32_t) (rng() % (uint64_t) (n + 1));
+        sink += graph->GetAncestors(id).size();
+        sink += graph->GetDownline(id).size();
+        sink += graph->GetNthLevel(id, 3).size();
     }
 
-//    //插入边
-//    void InsertEdge(const EdgeData &edgeData) {
-//        // 初始化 Tail Head 顶点下标索引
-//        int32_t tail = 0, head = 0;
-//        tail = _Locate(edgeData.Tail);
-//        head = _Locate(edgeData.Head);
-//        // 根据图类型，插入边
-//        _InsertEdge(tail, head);
-//    }
-//
-//    // 删除边
-//    void DeleteEdge(const EdgeData &edgeData) {
-//        // 初始化 Tail Head 顶点下标索引
-//        int32_t tail = 0, head = 0;
-//        tail = _Locate(edgeData.Tail);
-//        head = _Locate(edgeData.Head);
-//
-//        // 根据图类型，删除边
-//        _DeleteEdge(tail, head);
-//    }
+    // 删除部分用户，触发顶点表与边表的借用、合并
+    std::vector<Uid> victims(queryNum / 10);
+    for (auto &id : victims) {
+        id = 1 + (Uid) (rng() % (uint64_t) n);
+    }
+    graph->DeleteUsers(victims, GraphAdjList::CHILDREN_REATTACH);
+
+    Instrumentation::Snapshot snapshot = Instrumentation::Collect();
+    if (json) {
+        snapshot.PrintJson(std::cout);
+    } else {
+        printf("[powerlaw n=%d] (checksum %lu)\n", n, (unsigned long) sink);
+        snapshot.PrintText(std::cout);
+    }
+    delete graph;
+    return 0;
+}
 
-    // 显示 图
-    void Display() {
-        // 初始化边表结点指针
-        std::cout << std::endl << "邻接表：" << std::endl;
+// bench export [规模] [输出文件]：导出根用户的全部下级（广度优先），比较逐个刷新的输出流与各输出端
+int32_t RunExportBench(int32_t argc, char *argv[]) {
+    int32_t n = argc > 3 ? std::atoi(argv[3]) : 10000000;
+    std::string path = argc > 4 ? argv[4] : "downline.txt";
+
+    std::vector<GraphAdjList::EdgeData> edges = GenerateForest(SHAPE_POWERLAW, n, 42);
+    GraphAdjList *graph = new GraphAdjList();
+    graph->Init();
+    graph->addInviteRelationships(edges);
+    std::vector<GraphAdjList::EdgeData>().swap(edges);
+    printf("[powerlaw n=%d] 导出用户 0 的全部下级到 %s\n", n, path.c_str());
+
+    auto measure = [&](const char *name, auto &&traverse) {
+        auto start = std::chrono::steady_clock::now();
+        std::pair<int64_t, uint64_t> result = traverse();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        printf("  %-28s %10ld 用户  %8.3f s  %12.0f 用户/s  %8.1f MB/s\n", name, (long) result.first, seconds,
+               result.first / seconds, result.second / 1048576.0 / seconds);
+    };
+
+    // 1.原实现：每个ID后刷新输出流
+    measure("ostream + flush", [&]() {
+        std::ofstream out(path);
+        int64_t visited = graph->TraverseBFS(0, [&](int32_t id) {
+            out << id << "\n" << std::flush;
+        });
+        return std::make_pair(visited, (uint64_t) out.tellp());
+    });
+
+    // 2.输出流，不逐个刷新
+    measure("ConsoleSink(ofstream)", [&]() {
+        std::ofstream out(path);
+        int64_t visited = graph->TraverseBFS(0, ConsoleSink(out, '\n'));
+        out.flush();
+        return std::make_pair(visited, (uint64_t) out.tellp());
+    });
+
+    // 3.缓冲文件输出
+    measure("BufferedFileSink", [&]() {
+        BufferedFileSink sink(path.c_str());
+        int64_t visited = graph->TraverseBFS(0, sink);
+        sink.Close();
+        return std::make_pair(visited, sink.Bytes());
+    });
+
+    // 4.只写内存：遍历本身的代价
+    auto toVector = [&]() {
+        std::vector<Uid> ids;
+        ids.reserve((size_t) n + 1);
+        int64_t visited = graph->TraverseBFS(0, IteratorSink(std::back_inserter(ids)));
+        return std::make_pair(visited, (uint64_t) ids.size() * sizeof(Uid));
+    };
+    measure("IteratorSink(vector)", toVector);
+
+    // 5.启用深度分区索引：每一级为连续区间，遍历为顺序读
+    auto buildStart = std::chrono::steady_clock::now();
+    graph->EnableDepthIndex(true);
+    printf("  深度分区索引构建 %.3f s\n",
+           std::chrono::duration<double>(std::chrono::steady_clock::now() - buildStart).count());
+    measure("index + BufferedFileSink", [&]() {
+        BufferedFileSink sink(path.c_str());
+        int64_t visited = graph->TraverseBFS(0, sink);
+        sink.Close();
+        return std::make_pair(visited, sink.Bytes());
+    });
+    measure("index + IteratorSink(vector)", toVector);
+
+    delete graph;
+    return 0;
+}
 
-        // 遍历顶点表
-        auto vertexList = this->vexs.select(0, BE);
+// bench paged [规模] [页框数] [文件前缀]：邀请关系写入页式 B+ 树（用户→邀请者、(邀请者, 下级)→下级），
+// 重新打开后在远小于数据的缓冲池上查询，输出每次查询的读页数，并与内存中的图比对结果
+int32_t RunPagedBench(int32_t argc, char *argv[]) {
+    const double budget = 5.0;
+    const int32_t queryNum = 100000;
+    int32_t n = argc > 3 ? std::atoi(argv[3]) : 1000000;
+    int32_t frameNum = argc > 4 ? std::atoi(argv[4]) : 256;
+    std::string prefix = argc > 5 ? argv[5] : "invite";
+    std::string parentPath = prefix + ".parent.db", childPath = prefix + ".child.db";
+    auto edgeKey = [](int32_t preID, int32_t id) {
+        return (int64_t) ((uint64_t) (uint32_t) preID << 32 | (uint32_t) id);
+    };
 
-        if (vertexList.empty()) {
-            return;
+    printf("[powerlaw n=%d] 缓冲池 %d 页（%.1f MB）\n", n, frameNum, frameNum * (double) PAGE_SIZE / 1048576.0);
+    std::vector<GraphAdjList::EdgeData> edges = GenerateForest(SHAPE_POWERLAW, n, 42);
+
+    // 1.建树后关闭，模拟重启
+    {
+        auto start = std::chrono::steady_clock::now();
+        PagedBPlusTree<int32_t, int32_t> parents(frameNum);
+        PagedBPlusTree<int64_t, int32_t> children(frameNum);
+        if (!parents.open(parentPath.c_str(), true) || !children.open(childPath.c_str(), true)) {
+            std::cout << "无法创建页文件：" << prefix << std::endl;
+            return 1;
         }
+        parents.insert(0, -1);
+        for (const GraphAdjList::EdgeData &edge : edges) {
+            parents.insert(edge.Head, edge.Tail);
+            children.insert(edgeKey(edge.Tail, edge.Head), edge.Head);
+        }
+        parents.close();
+        children.close();
+        printf("  建树 %.3f s   用户表 %u 页（%.1f MB，树高 %d）  下级表 %u 页（%.1f MB，树高 %d）\n",
+               std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(),
+               parents.pageNum(), parents.pageNum() * (double) PAGE_SIZE / 1048576.0, parents.height(),
+               children.pageNum(), children.pageNum() * (double) PAGE_SIZE / 1048576.0, children.height());
+    }
+
+    PagedBPlusTree<int32_t, int32_t> parents(frameNum);
+    PagedBPlusTree<int64_t, int32_t> children(frameNum);
+    if (!parents.open(parentPath.c_str(), false) || !children.open(childPath.c_str(), false)) {
+        std::cout << "无法打开页文件：" << prefix << std::endl;
+        return 1;
+    }
+    auto getAncestors = [&](int32_t id) {
+        std::vector<Uid> ancestors;
+        int32_t preID;
+        while (parents.find(id, preID) && preID != -1) {
+            ancestors.push_back(preID);
+            id = preID;
+        }
+        return ancestors;
+    };
+    auto getNthLevel = [&](int32_t id, int32_t level) {
+        std::vector<int32_t> frontier;
+        if (!parents.search(id)) {
+            return std::vector<Uid>();
+        }
+        frontier.push_back(id);
+        for (int32_t i = 0; i < level && !frontier.empty(); i++) {
+            std::vector<int32_t> next;
+            for (int32_t v : frontier) {
+                children.select(edgeKey(v, 0), edgeKey(v, INT32_MAX), next);
+            }
+            frontier.swap(next);
+        }
+        return std::vector<Uid>(frontier.begin(), frontier.end());
+    };
 
-        for (auto vex : vertexList) {
-            // 输出顶点
-            std::cout << "[" << vex.id << "]" << vex.id << " ";
+    std::mt19937_64 rng(43);
+    std::vector<int32_t> randomIDs(queryNum);
+    for (auto &id : randomIDs) {
+        id = (int32_t) (rng() % (uint64_t) (n + 1));
+    }
 
-            // 遍历输出边顶点
-            auto pEdges = vex.pEdgeTable;
+    // 2.与内存中的图比对
+    {
+        GraphAdjList *graph = new GraphAdjList();
+        graph->Init();
+        graph->addInviteRelationships(edges);
+        int32_t mismatch = 0;
+        for (int32_t i = 0; i < 1000; i++) {
+            mismatch += getAncestors(randomIDs[i]) != graph->GetAncestors(randomIDs[i]);
+            mismatch += getNthLevel(randomIDs[i], 3) != graph->GetNthLevel(randomIDs[i], 3);
+        }
+        printf("  结果不一致 %d / 2000\n", mismatch);
+        delete graph;
+    }
 
-            if (pEdges == nullptr) {
-                std::cout << std::endl;
-                continue;
-            }
+    // 3.冷启动后的查询：每项之后输出平均读页数
+    uint64_t sink = 0;
+    auto measure = [&](const char *name, uint64_t ops, auto &&op) {
+        parents.bufferPool().ResetStats();
+        children.bufferPool().ResetStats();
+        uint64_t done = 0;
+        TimeOps(name, ops, budget, [&](uint64_t i) {
+            op(i);
+            done++;
+        });
+        uint64_t reads = parents.bufferPool().GetStats().reads + children.bufferPool().GetStats().reads;
+        uint64_t fetches = parents.bufferPool().GetStats().hits + parents.bufferPool().GetStats().misses +
+                           children.bufferPool().GetStats().hits + children.bufferPool().GetStats().misses;
+        printf("  %-14s 读页 %8.3f 次/查询   命中率 %6.2f%%\n", name, (double) reads / std::max<uint64_t>(1, done),
+               fetches > 0 ? 100.0 * (double) (fetches - reads) / (double) fetches : 0.0);
+    };
+    measure("paged.search", queryNum, [&](uint64_t i) {
+        sink += parents.search(randomIDs[i]);
+    });
+    measure("paged.ancestors", queryNum, [&](uint64_t i) {
+        sink += getAncestors(randomIDs[i]).size();
+    });
+    measure("paged.level3", queryNum, [&](uint64_t i) {
+        sink += getNthLevel(randomIDs[i], 3).size();
+    });
+    printf("  (checksum %lu)\n", (unsigned long) sink);
+    return 0;
+}
 
-            // 遍历顶点表
-            auto edgeList = pEdges->select(0, BE);
+// bench cache [规模...]：随机键值 B+ 树上的点查询、范围扫描、全表扫描，输出每次操作的耗时与缓存未命中数
+// 以 -DBPLUS_PREFETCH=0 编译可对比关闭预取时的结果
+int32_t RunCacheBench(int32_t argc, char *argv[]) {
+    const int32_t queryNum = 1000000;
+    std::vector<int32_t> sizes;
+    for (int32_t i = 3; i < argc; i++) {
+        sizes.push_back(std::atoi(argv[i]));
+    }
+    if (sizes.empty()) {
+        sizes = { 1000000, 10000000 };
+    }
 
-            if (edgeList.empty()) {
-                continue;
-            }
+    PerfCounters counters;
+    printf("预取：%s，InternalNode %zu B，LeafNode<int32_t, int32_t> %zu B\n", BPLUS_PREFETCH ? "开启" : "关闭",
+           sizeof(InternalNode<int32_t>), sizeof(LeafNode<int32_t, int32_t>));
+    for (int32_t n : sizes) {
+        printf("[random n=%d]\n", n);
+        std::mt19937_64 rng(42);
+        std::vector<int32_t> keys(n);
+        for (int32_t i = 0; i < n; i++) {
+            keys[i] = i * 2;
+        }
+        std::shuffle(keys.begin(), keys.end(), rng);
+        BPlusTree<int32_t, int32_t> tree;
+        for (int32_t key : keys) {
+            tree.insert(key, key);
+        }
+        std::vector<int32_t> randomKeys(queryNum);
+        for (auto &key : randomKeys) {
+            key = (int32_t) (rng() % (uint64_t) (2 * n));
+        }
 
-            for (auto edge : edgeList) {
-                std::cout << "[" << edge.adjVex << "] ";
+        uint64_t sink = 0;
+        auto measure = [&](const char *name, uint64_t ops, auto &&op) {
+            auto start = std::chrono::steady_clock::now();
+            counters.Start();
+            for (uint64_t i = 0; i < ops; i++) {
+                op(i);
             }
-
-            std::cout << std::endl;
+            counters.Stop();
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            printf("  %-21s %9lu ops  %9.1f ns/op   LLC miss %8s   L1D miss %8s   dTLB miss %8s  /op\n", name,
+                   (unsigned long) ops, seconds * 1e9 / (double) ops, counters.PerOp(0, ops).c_str(),
+                   counters.PerOp(1, ops).c_str(), counters.PerOp(2, ops).c_str());
+        };
+        measure("tree.search", queryNum, [&](uint64_t i) {
+            sink += tree.search(randomKeys[i]);
+        });
+        measure("tree.find", queryNum, [&](uint64_t i) {
+            int32_t *data = tree.find(randomKeys[i]);
+            sink += data != nullptr ? *data : 0;
+        });
+        // 每 batch 个键值一次批量查找，按键值计算每次操作耗时
+        const int32_t batch = 256;
+        std::vector<int32_t *> found(batch);
+        measure("tree.multiFind", queryNum, [&](uint64_t i) {
+            if (i % batch == 0) {
+                int32_t num = (int32_t) std::min<uint64_t>(batch, queryNum - i);
+                tree.multiFind(randomKeys.data() + i, num, found.data());
+                for (int32_t j = 0; j < num; j++) {
+                    sink += found[j] != nullptr ? *found[j] : 0;
+                }
+            }
+        });
+        std::vector<int32_t> range;
+        measure("tree.range100", queryNum / 10, [&](uint64_t i) {
+            range.clear();
+            tree.select(randomKeys[i], randomKeys[i] + 199, range);
+            sink += range.size();
+        });
+        measure("tree.forEach", 1, [&](uint64_t) {
+            tree.forEach([&](int32_t key, int32_t) {
+                sink += key;
+            });
+        });
+        tree.clear();
+
+        // 随机邀请森林（每个用户的邀请者在已有用户中均匀选取）：逐个与批量查找上级，按层遍历全部用户
+        GraphAdjList *graph = new GraphAdjList();
+        graph->Init();
+        for (int32_t id = 1; id <= n; id++) {
+            graph->addInviteRelationship((int32_t) (rng() % (uint64_t) id), id);
+        }
+        std::vector<Uid> randomIDs(queryNum / 10);
+        for (auto &id : randomIDs) {
+            id = (Uid) (rng() % (uint64_t) (n + 1));
         }
+        measure("graph.ancestors", randomIDs.size(), [&](uint64_t i) {
+            sink += graph->GetAncestors(randomIDs[i]).size();
+        });
+        measure("graph.ancestors.batch", randomIDs.size(), [&](uint64_t i) {
+            if (i % batch == 0) {
+                size_t end = std::min<size_t>(randomIDs.size(), i + batch);
+                std::vector<Uid> ids(randomIDs.begin() + (ptrdiff_t) i, randomIDs.begin() + (ptrdiff_t) end);
+                for (const auto &ancestors : graph->GetAncestors(ids)) {
+                    sink += ancestors.size();
+                }
+            }
+        });
+        measure("graph.bfs", 1, [&](uint64_t) {
+            sink += graph->TraverseBFS(0, [&](int32_t id) {
+                sink += id;
+            });
+        });
+        delete graph;
+        printf("  (checksum %lu)\n", (unsigned long) sink);
+    }
+    return 0;
+}
 
+// bench static [规模...]：同一组随机键值上，动态 B+ 树与由其叶子链构建的静态搜索树的构建耗时、内存与查询速度
+int32_t RunStaticBench(int32_t argc, char *argv[]) {
+    const int32_t queryNum = 1000000;
+    const int32_t batch = 256;
+    std::vector<int32_t> sizes;
+    for (int32_t i = 3; i < argc; i++) {
+        sizes.push_back(std::atoi(argv[i]));
+    }
+    if (sizes.empty()) {
+        sizes = { 1000000, 10000000 };
     }
 
-    // 从指定顶点开始，深度优先 递归 遍历
-    void Display_DFS_R(int32_t vertex) {
-        // 1.判断顶点是否存在
-        int32_t index = _Locate(vertex);
-        if (index == -1)
-            return;
+    for (int32_t n : sizes) {
+        printf("[random n=%d]\n", n);
+        std::mt19937_64 rng(42);
+        BPlusTree<int32_t, int32_t> tree;
+        {
+            std::vector<int32_t> keys(n);
+            for (int32_t i = 0; i < n; i++) {
+                keys[i] = i * 2;
+            }
+            std::shuffle(keys.begin(), keys.end(), rng);
+            for (int32_t key : keys) {
+                tree.insert(key, key);
+            }
+        }
+        auto start = std::chrono::steady_clock::now();
+        StaticSearchTree<int32_t, int32_t> index;
+        index.build(tree);
+        double buildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        TreeStats stats = tree.stats();
+        printf("  动态 B+ 树   树高 %d   %8.2f B/键值\n", stats.height, (double) stats.allocatedBytes / n);
+        printf("  静态搜索树   树高 %d   %8.2f B/键值   构建 %.1f ms\n", index.height(), (double) index.bytes() / n,
+               buildSeconds * 1000);
+
+        std::vector<int32_t> randomKeys(queryNum);
+        for (auto &key : randomKeys) {
+            key = (int32_t) (rng() % (uint64_t) (2 * (int64_t) n));
+        }
+        uint64_t sink = 0;
+        auto measure = [&](const char *name, uint64_t ops, auto &&op) {
+            auto begin = std::chrono::steady_clock::now();
+            for (uint64_t i = 0; i < ops; i++) {
+                op(i);
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+            printf("  %-18s %9lu ops  %9.1f ns/op\n", name, (unsigned long) ops, seconds * 1e9 / (double) ops);
+        };
+        std::vector<int32_t *> found(batch);
+        std::vector<const int32_t *> staticFound(batch);
+        std::vector<int32_t> range;
+        measure("tree.find", queryNum, [&](uint64_t i) {
+            int32_t *data = tree.find(randomKeys[i]);
+            sink += data != nullptr ? *data : 0;
+        });
+        measure("static.find", queryNum, [&](uint64_t i) {
+            const int32_t *data = index.find(randomKeys[i]);
+            sink += data != nullptr ? *data : 0;
+        });
+        // 每 batch 个键值一次批量查找，按键值计算每次操作耗时
+        measure("tree.multiFind", queryNum, [&](uint64_t i) {
+            if (i % batch == 0) {
+                int32_t num = (int32_t) std::min<uint64_t>(batch, queryNum - i);
+                tree.multiFind(randomKeys.data() + i, num, found.data());
+                for (int32_t j = 0; j < num; j++) {
+                    sink += found[j] != nullptr ? *found[j] : 0;
+                }
+            }
+        });
+        measure("static.multiFind", queryNum, [&](uint64_t i) {
+            if (i % batch == 0) {
+                int32_t num = (int32_t) std::min<uint64_t>(batch, queryNum - i);
+                index.multiFind(randomKeys.data() + i, num, staticFound.data());
+                for (int32_t j = 0; j < num; j++) {
+                    sink += staticFound[j] != nullptr ? *staticFound[j] : 0;
+                }
+            }
+        });
+        measure("tree.range100", queryNum / 10, [&](uint64_t i) {
+            range.clear();
+            tree.select(randomKeys[i], randomKeys[i] + 199, range);
+            sink += range.size();
+        });
+        measure("static.range100", queryNum / 10, [&](uint64_t i) {
+            range.clear();
+            index.select(randomKeys[i], randomKeys[i] + 199, range);
+            sink += range.size();
+        });
+        printf("  (checksum %lu)\n", (unsigned long) sink);
+    }
+    return 0;
+}
 
-        auto vertexList = this->vexs.select(0, BE);
+// bench shard [规模] [子树根深度] [分片数...]：幂律邀请森林上，单个图与按顶层子树分片的图的插入、批量查询吞吐量，以及分片大小的均衡程度
+int32_t RunShardBench(int32_t argc, char *argv[]) {
+    int32_t n = argc > 3 ? std::atoi(argv[3]) : 1000000;
+    int32_t splitDepth = argc > 4 ? std::atoi(argv[4]) : 3;
+    std::vector<int32_t> shardNums;
+    for (int32_t i = 5; i < argc; i++) {
+        shardNums.push_back(std::atoi(argv[i]));
+    }
+    if (shardNums.empty()) {
+        shardNums = { 1, 2, 4, 8 };
+    }
+    const int32_t queryNum = 100000;
+    const int32_t batch = 1024;
+    printf("[powerlaw n=%d  子树根深度 %d  硬件线程 %u]\n", n, splitDepth, std::thread::hardware_concurrency());
+
+    std::vector<GraphAdjList::EdgeData> edges = GenerateForest(SHAPE_POWERLAW, n, 42);
+    std::mt19937_64 rng(43);
+    std::vector<Uid> randomIDs(queryNum);
+    for (auto &id : randomIDs) {
+        id = (Uid) (rng() % (uint64_t) (n + 1));
+    }
+    auto report = [](const char *name, uint64_t ops, double seconds) {
+        printf("  %-22s %9lu ops  total %9.3f ms  %12.0f ops/s\n", name, (unsigned long) ops, seconds * 1000,
+               ops / seconds);
+    };
+    auto since = [](std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
 
-        if (vertexList.empty()) {
-            return;
+    // 1.单个图：保存每个查询的结果作为分片结果的参照（第 N 级下级排序后比较）
+    std::vector<std::vector<Uid>> expectedLevels(queryNum), expectedAncestors(queryNum);
+    {
+        GraphAdjList graph;
+        graph.Init();
+        auto start = std::chrono::steady_clock::now();
+        graph.addInviteRelationships(edges);
+        report("graph.insert", edges.size(), since(start));
+        start = std::chrono::steady_clock::now();
+        for (int32_t i = 0; i < queryNum; i++) {
+            expectedLevels[i] = graph.GetNthLevel(randomIDs[i], 3);
         }
+        report("graph.level3", queryNum, since(start));
+        start = std::chrono::steady_clock::now();
+        for (int32_t i = 0; i < queryNum; i += batch) {
+            std::vector<Uid> ids(randomIDs.begin() + i, randomIDs.begin() + std::min(queryNum, i + batch));
+            std::vector<std::vector<Uid>> results = graph.GetAncestors(ids);
+            std::move(results.begin(), results.end(), expectedAncestors.begin() + i);
+        }
+        report("graph.ancestors.batch", queryNum, since(start));
+        for (auto &level : expectedLevels) {
+            std::sort(level.begin(), level.end());
+        }
+    }
 
-        // 2.初始化顶点访问数组
-        for (auto vex : vertexList) {
-            this->vexs_visited.insert(vex.id, 0);
+    // 2.分片：查询每 batch 个用户一批，由各分片并行执行
+    for (int32_t shardNum : shardNums) {
+        printf(" 分片数 %d\n", shardNum);
+        ShardedGraph graph(shardNum, splitDepth);
+        auto start = std::chrono::steady_clock::now();
+        graph.addInviteRelationships(edges);
+        graph.Sync();
+        report("sharded.insert", edges.size(), since(start));
+        std::vector<std::vector<Uid>> levels(queryNum), ancestors(queryNum);
+        start = std::chrono::steady_clock::now();
+        for (int32_t i = 0; i < queryNum; i += batch) {
+            std::vector<Uid> ids(randomIDs.begin() + i, randomIDs.begin() + std::min(queryNum, i + batch));
+            std::vector<std::vector<Uid>> results = graph.GetNthLevel(ids, 3);
+            std::move(results.begin(), results.end(), levels.begin() + i);
+        }
+        report("sharded.level3.batch", queryNum, since(start));
+        start = std::chrono::steady_clock::now();
+        for (int32_t i = 0; i < queryNum; i += batch) {
+            std::vector<Uid> ids(randomIDs.begin() + i, randomIDs.begin() + std::min(queryNum, i + batch));
+            std::vector<std::vector<Uid>> results = graph.GetAncestors(ids);
+            std::move(results.begin(), results.end(), ancestors.begin() + i);
         }
+        report("sharded.ancestors.batch", queryNum, since(start));
 
-        // 3.深度优先遍历 递归
-        std::cout << "深度优先遍历（递归）：（从顶点" << vertex << "开始）" << std::endl;
-        _DFS_R(index);
+        // 逐个查询与单个图的结果比对
+        int32_t mismatch = 0;
+        for (int32_t i = 0; i < queryNum; i++) {
+            std::sort(levels[i].begin(), levels[i].end());
+            mismatch += levels[i] != expectedLevels[i] || ancestors[i] != expectedAncestors[i];
+        }
+        int32_t largest = 0;
+        for (int32_t s = 0; s < shardNum; s++) {
+            largest = std::max(largest, graph.GetShardVexNum(s));
+        }
+        printf("  最大分片 %d 用户（平均的 %.2f 倍）  结果不一致 %d / %d\n", largest,
+               (double) largest * shardNum / std::max(1, graph.GetVexNum() - 1), mismatch, queryNum);
     }
+    return 0;
+}
 
-//    // 从指定顶点开始，深度优先 非递归 遍历
-//    void Display_DFS(int32_t vertex) {
-//        // 1.判断顶点是否存在
-//        int32_t index = _Locate(vertex);
-//        if (index == -1)
-//            return;
-//
-//        auto vertexList = this->vexs.select(0, BE);
-//
-//        if (vertexList.empty()) {
-//            return;
-//        }
-//
-//        // 2.初始化顶点访问数组
-//        for (auto vex : vertexList) {
-//            this->vexs_visited.remove(vex.id);
-//            this->vexs_visited.insert(vex.id, 0);
-//        }
-//
-//        // 3.深度优先遍历 递归
-//        std::cout << "深度优先遍历（非递归）：（从顶点" << vertex << "开始）" << std::endl;
-//        _DFS(index);
-//    }
+// bench distributed [规模] [子树根深度] [分片数...]：幂律邀请森林上，分片为独立进程（经 Unix 套接字通信）时的插入、批量查询吞吐量、消息量与分片进程内存
+int32_t RunDistributedBench(int32_t argc, char *argv[]) {
+    int32_t n = argc > 3 ? std::atoi(argv[3]) : 1000000;
+    int32_t splitDepth = argc > 4 ? std::atoi(argv[4]) : 3;
+    std::vector<int32_t> shardNums;
+    for (int32_t i = 5; i < argc; i++) {
+        shardNums.push_back(std::atoi(argv[i]));
+    }
+    if (shardNums.empty()) {
+        shardNums = { 1, 2, 4, 8 };
+    }
+    // 分片进程的内存取自已回收子进程的最大 RSS，从多到少依次运行，每次的最大值即本次的最大分片
+    std::sort(shardNums.rbegin(), shardNums.rend());
+    const int32_t queryNum = 100000;
+    const int32_t downlineNum = 1000;
+    const int32_t batch = 1024;
+    printf("[powerlaw n=%d  子树根深度 %d  硬件线程 %u]\n", n, splitDepth, std::thread::hardware_concurrency());
+
+    // 在生成数据之前创建全部分片进程，避免子进程继承路由进程的内存
+    std::vector<std::unique_ptr<DistributedGraph>> graphs;
+    for (int32_t shardNum : shardNums) {
+        graphs.push_back(std::make_unique<DistributedGraph>(splitDepth));
+        if (!graphs.back()->SpawnLocalShards(shardNum)) {
+            printf("创建分片进程失败\n");
+            return 1;
+        }
+    }
 
-    // 从指定顶点开始，广度优先遍历
-    void Display_BFS(int32_t vertex) {
-        // 1.判断顶点是否存在
-        int32_t index = _Locate(vertex);
-        if (index == -1)
-            return;
+    std::vector<GraphAdjList::EdgeData> edges = GenerateForest(SHAPE_POWERLAW, n, 42);
+    std::mt19937_64 rng(43);
+    std::vector<Uid> randomIDs(queryNum);
+    for (auto &id : randomIDs) {
+        id = (Uid) (rng() % (uint64_t) (n + 1));
+    }
+    auto report = [](const char *name, uint64_t ops, double seconds) {
+        printf("  %-26s %9lu ops  total %9.3f ms  %12.0f ops/s\n", name, (unsigned long) ops, seconds * 1000,
+               ops / seconds);
+    };
+    auto since = [](std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
 
-        {
-            auto vertexList = this->vexs.select(0, BE);
+    // 1.单个图：保存每个查询的结果作为分片结果的参照（下级按级排序后比较）
+    std::vector<std::vector<Uid>> expectedLevels(queryNum), expectedAncestors(queryNum);
+    std::vector<std::vector<std::vector<Uid>>> expectedDownlines(downlineNum);
+    {
+        GraphAdjList graph;
+        graph.Init();
+        auto start = std::chrono::steady_clock::now();
+        graph.addInviteRelationships(edges);
+        report("graph.insert", edges.size(), since(start));
+        start = std::chrono::steady_clock::now();
+        for (int32_t i = 0; i < queryNum; i++) {
+            expectedLevels[i] = graph.GetNthLevel(randomIDs[i], 3);
+        }
+        report("graph.level3", queryNum, since(start));
+        start = std::chrono::steady_clock::now();
+        for (int32_t i = 0; i < queryNum; i += batch) {
+            std::vector<Uid> ids(randomIDs.begin() + i, randomIDs.begin() + std::min(queryNum, i + batch));
+            std::vector<std::vector<Uid>> results = graph.GetAncestors(ids);
+            std::move(results.begin(), results.end(), expectedAncestors.begin() + i);
+        }
+        report("graph.ancestors.batch", queryNum, since(start));
+        start = std::chrono::steady_clock::now();
+        for (int32_t i = 0; i < downlineNum; i++) {
+            expectedDownlines[i] = graph.GetDownline(randomIDs[i]);
+        }
+        report("graph.downline", downlineNum, since(start));
+        for (auto &level : expectedLevels) {
+            std::sort(level.begin(), level.end());
+        }
+        for (auto &downline : expectedDownlines) {
+            for (auto &level : downline) {
+                std::sort(level.begin(), level.end());
+            }
+        }
+    }
 
-            if (vertexList.empty()) {
-                return;
+    // 2.多进程分片：查询每 batch 个用户一批，一轮消息
+    for (size_t g = 0; g < graphs.size(); g++) {
+        printf(" 分片数 %d\n", shardNums[g]);
+        int32_t mismatch = 0;
+        {
+            DistributedGraph &graph = *graphs[g];
+            auto start = std::chrono::steady_clock::now();
+            graph.addInviteRelationships(edges);
+            graph.Flush();
+            report("distributed.insert", edges.size(), since(start));
+            std::vector<std::vector<Uid>> levels(queryNum), ancestors(queryNum);
+            std::vector<std::vector<std::vector<Uid>>> downlines(downlineNum);
+            start = std::chrono::steady_clock::now();
+            for (int32_t i = 0; i < queryNum; i += batch) {
+                std::vector<Uid> ids(randomIDs.begin() + i, randomIDs.begin() + std::min(queryNum, i + batch));
+                std::vector<std::vector<Uid>> results = graph.GetNthLevel(ids, 3);
+                std::move(results.begin(), results.end(), levels.begin() + i);
+            }
+            report("distributed.level3.batch", queryNum, since(start));
+            start = std::chrono::steady_clock::now();
+            for (int32_t i = 0; i < queryNum; i += batch) {
+                std::vector<Uid> ids(randomIDs.begin() + i, randomIDs.begin() + std::min(queryNum, i + batch));
+                std::vector<std::vector<Uid>> results = graph.GetAncestors(ids);
+                std::move(results.begin(), results.end(), ancestors.begin() + i);
+            }
+            report("distributed.ancestors.batch", queryNum, since(start));
+            start = std::chrono::steady_clock::now();
+            for (int32_t i = 0; i < downlineNum; i++) {
+                downlines[i] = graph.GetDownline(randomIDs[i]);
+            }
+            report("distributed.downline", downlineNum, since(start));
+            const DistributedGraph::TransportStats &stats = graph.GetTransportStats();
+            printf("  消息 %lu 条  轮数 %lu  发送 %.1f MB  接收 %.1f MB\n", (unsigned long) stats.messages,
+                   (unsigned long) stats.rounds, stats.bytesSent / 1048576.0, stats.bytesReceived / 1048576.0);
+            for (int32_t shard : graph.GetFailedShards()) {
+                printf("  分片 %d 失败，其上的查询结果为空\n", shard);
             }
 
-            // 2.初始化顶点访问数组
-            for (auto vex : vertexList) {
-                this->vexs_visited.remove(vex.id);
-                this->vexs_visited.insert(vex.id, 0);
+            // 逐个查询与单个图的结果比对
+            for (int32_t i = 0; i < queryNum; i++) {
+                std::sort(levels[i].begin(), levels[i].end());
+                mismatch += levels[i] != expectedLevels[i] || ancestors[i] != expectedAncestors[i];
+            }
+            for (int32_t i = 0; i < downlineNum; i++) {
+                for (auto &level : downlines[i]) {
+                    std::sort(level.begin(), level.end());
+                }
+                mismatch += downlines[i] != expectedDownlines[i];
             }
         }
+        graphs[g].reset();
+        struct rusage usage;
+        getrusage(RUSAGE_CHILDREN, &usage);
+        printf("  最大分片进程 RSS %.1f MB  结果不一致 %d / %d\n", usage.ru_maxrss / 1024.0, mismatch,
+               queryNum + downlineNum);
+    }
+    return 0;
+}
 
-        // 3.广度优先遍历
-        std::cout << "广度优先遍历：（从顶点" << vertex << "开始）" << std::endl;
-
-        // 3.1.初始化队列
-        LinkQueue<int32_t> * vexQ = new LinkQueue<int32_t>();
+// 计时的异步上级查询：从发出到完成的延迟（纳秒）
+QueryTask<double> TimedAncestors(AsyncGraph &graph, Uid vertex) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<Uid> ancestors = co_await graph.GetAncestors(vertex);
+    co_return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
 
-        // 3.2.访问开始顶点，并标记访问、入队
-        auto vertexList = this->vexs.select(index, EQ);
+// bench async [规模] [工作线程数] [让出间隔...]：幂律邀请森林上，先发出一个全图下级查询，再发出大量上级查询，比较不同让出间隔下小查询的延迟
+int32_t RunAsyncBench(int32_t argc, char *argv[]) {
+    int32_t n = argc > 3 ? std::atoi(argv[3]) : 1000000;
+    int32_t threadNum = argc > 4 ? std::atoi(argv[4]) : 1;
+    std::vector<int32_t> yieldEverys;
+    for (int32_t i = 5; i < argc; i++) {
+        yieldEverys.push_back(std::atoi(argv[i]));
+    }
+    if (yieldEverys.empty()) {
+        yieldEverys = { std::numeric_limits<int32_t>::max(), 65536, 4096, 256 };
+    }
+    const int32_t queryNum = 10000;
+    printf("[powerlaw n=%d  工作线程 %d  硬件线程 %u]\n", n, threadNum, std::thread::hardware_concurrency());
+
+    GraphAdjList graph;
+    graph.Init();
+    graph.addInviteRelationships(GenerateForest(SHAPE_POWERLAW, n, 42));
+    std::mt19937_64 rng(43);
+    std::vector<Uid> randomIDs(queryNum);
+    for (auto &id : randomIDs) {
+        id = (Uid) (rng() % (uint64_t) (n + 1));
+    }
+    auto start = std::chrono::steady_clock::now();
+    size_t expected = 0;
+    for (const auto &level : graph.GetDownline(0)) {
+        expected += level.size();
+    }
+    printf("  同步全图下级查询 %.3f ms\n",
+           std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
 
-        if (vertexList.empty()) {
-            return;
+    for (int32_t yieldEvery : yieldEverys) {
+        if (yieldEvery == std::numeric_limits<int32_t>::max()) {
+            printf(" 不让出\n");
+        } else {
+            printf(" 每 %d 个用户让出\n", yieldEvery);
         }
+        QueryScheduler scheduler(threadNum, yieldEvery);
+        AsyncGraph async(graph, scheduler);
+        start = std::chrono::steady_clock::now();
+        QueryTask<std::vector<std::vector<Uid>>> downline = async.GetDownline(0);
+        downline.Start();
+        std::vector<QueryTask<double>> lookups;
+        lookups.reserve(queryNum);
+        for (Uid id : randomIDs) {
+            lookups.push_back(TimedAncestors(async, id));
+            lookups.back().Start();
+        }
+        LatencyRecorder recorder("ancestors");
+        for (QueryTask<double> &lookup : lookups) {
+            recorder.Add(lookup.Get());
+        }
+        double lookupSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        size_t downlineNum = 0;
+        for (const auto &level : downline.Get()) {
+            downlineNum += level.size();
+        }
+        double totalSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        recorder.Report(lookupSeconds, queryNum);
+        printf("  全图下级查询完成 %.3f ms  让出 %lu 次  结果%s\n", totalSeconds * 1000,
+               (unsigned long) scheduler.GetYieldNum(), downlineNum == expected ? "一致" : "不一致");
+    }
+    return 0;
+}
 
-        VertexNode vertexNode = vertexList[0];
-
-        std::cout << vertexNode.id << " " << std::flush;
+// bench querycache [规模] [容量MB]：幂律邀请森林上模拟看板负载（反复查询少数头部邀请者的第 N 级与全部下级，同时持续插入新用户、偶尔删除用户或移动子树），对比有无查询结果缓存
+int32_t RunQueryCacheBench(int32_t argc, char *argv[]) {
+    int32_t n = argc > 3 ? std::atoi(argv[3]) : 1000000;
+    size_t capacity = (size_t) ((argc > 4 ? std::atof(argv[4]) : 64) * 1048576);
+    const int32_t rounds = 200000;
+    const int32_t insertEvery = 4;      // 每 4 次查询插入 1 个用户
+    const int32_t changeEvery = 64;     // 每 64 次查询删除 1 个用户或移动 1 棵子树（交替）
+    const int32_t hotNum = 10000;       // 查询对象：ID 最小的 hotNum 个用户（幂律森林中邀请最多），按对数均匀分布抽取
+    const int32_t segment = 4096;       // 两个图交替执行的每段查询数，无缓存的一段结果留作有缓存一段的参照
+    printf("[powerlaw n=%d  缓存容量 %.0f MB  查询 %d 次  每 %d 次查询插入 1 个用户  每 %d 次查询删除或移动 1 个用户]\n", n,
+           capacity / 1048576.0, rounds, insertEvery, changeEvery);
+
+    std::vector<GraphAdjList::EdgeData> edges = GenerateForest(SHAPE_POWERLAW, n + rounds / insertEvery, 42);
+    std::span<const GraphAdjList::EdgeData> initial(edges.data(), n);
+    std::mt19937_64 rng(43);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::vector<std::pair<Uid, int32_t>> queries(rounds);     // (用户, 等级)，等级 0 为全部下级
+    for (auto &query : queries) {
+        query.first = (Uid) (std::pow((double) hotNum, uniform(rng)) - 1);
+        query.second = rng() % 10 == 0 ? 0 : (int32_t) (1 + rng() % 3);
+        if (query.second == 0 && query.first < 100) {
+            query.first += 100;     // 全部下级只查较小的子树
+        }
+    }
+    // 删除或移动的用户取自头部以外，移动到一个头部用户下（形成环时失败，两个图相同）
+    std::vector<std::pair<Uid, Uid>> changes(rounds / changeEvery);     // (用户, 新邀请者)，新邀请者为 NO_UID 表示删除
+    for (size_t i = 0; i < changes.size(); i++) {
+        changes[i].first = (Uid) (hotNum + rng() % (uint64_t) (n - hotNum));
+        changes[i].second = i % 2 == 0 ? NO_UID : (Uid) (rng() % (uint64_t) hotNum);
+    }
 
-        this->vexs_visited.remove(index);
-        this->vexs_visited.insert(index, 1);
-        vexQ->EnQueue(new int32_t(index));
+    // 两个图按段交替执行同一操作序列，逐个查询比对结果；计时只包含各次操作本身
+    const size_t capacities[2] = { 0, capacity };
+    GraphAdjList graphs[2];
+    double querySeconds[2] = {}, insertSeconds[2] = {}, changeSeconds[2] = {};
+    for (int32_t g = 0; g < 2; g++) {
+        graphs[g].Init();
+        graphs[g].addInviteRelationships(initial);
+        graphs[g].EnableQueryCache(capacities[g]);
+    }
+    auto since = [](std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+    std::vector<std::vector<std::vector<Uid>>> expected(segment);
+    std::vector<std::vector<Uid>> levels;
+    int32_t mismatch = 0;
+    for (int32_t begin = 0; begin < rounds; begin += segment) {
+        int32_t end = std::min(rounds, begin + segment);
+        for (int32_t g = 0; g < 2; g++) {
+            GraphAdjList &graph = graphs[g];
+            for (int32_t i = begin; i < end; i++) {
+                if (i % insertEvery == 0) {
+                    auto start = std::chrono::steady_clock::now();
+                    const GraphAdjList::EdgeData &edge = edges[n + i / insertEvery];
+                    graph.addInviteRelationship(edge.Tail, edge.Head);
+                    insertSeconds[g] += since(start);
+                }
+                if (i % changeEvery == changeEvery - 1) {
+                    auto start = std::chrono::steady_clock::now();
+                    const std::pair<Uid, Uid> &change = changes[i / changeEvery];
+                    if (change.second == NO_UID) {
+                        graph.DeleteUser(change.first);
+                    } else {
+                        graph.MoveSubtree(change.first, change.second);
+                    }
+                    changeSeconds[g] += since(start);
+                }
+                auto start = std::chrono::steady_clock::now();
+                if (queries[i].second == 0) {
+                    levels = graph.GetDownline(queries[i].first);
+                } else {
+                    levels.assign(1, graph.GetNthLevel(queries[i].first, queries[i].second));
+                }
+                querySeconds[g] += since(start);
+                if (g == 0) {
+                    expected[i - begin].swap(levels);
+                } else {
+                    mismatch += levels != expected[i - begin];
+                }
+            }
+        }
+    }
 
-        // 3.3.出队，并遍历邻接顶点（下一层次），访问后入队
-        BPlusTree<int32_t, EdgeNode> *pEdges = nullptr;
-        int32_t adjVex = 0;
-        while (vexQ->GetHead() != nullptr) {
-            {
-                index = *vexQ->DeQueue();
-                auto vertexList = this->vexs.select(index, EQ);
+    int32_t inserts = rounds / insertEvery, changeNum = (int32_t) changes.size();
+    for (int32_t g = 0; g < 2; g++) {
+        printf(g == 0 ? " 无缓存\n" : " 缓存\n");
+        printf("  查询 %12.0f ops/s  插入 %12.0f ops/s（%.0f ns/次）  删除/移动 %.1f µs/次\n", rounds / querySeconds[g],
+               inserts / insertSeconds[g], insertSeconds[g] * 1e9 / inserts, changeSeconds[g] * 1e6 / changeNum);
+    }
+    QueryCache::Metrics metrics = graphs[1].GetQueryCacheMetrics();
+    uint64_t checks = std::max<uint64_t>(1, metrics.invalidations);
+    printf("  命中率 %.1f%%  结果 %lu 个  占用 %.1f MB  淘汰 %lu  结果不一致 %d / %d\n", metrics.HitRate() * 100,
+           (unsigned long) metrics.entryCount, metrics.bytes / 1048576.0, (unsigned long) metrics.evictions, mismatch,
+           rounds);
+    printf("  失效检查 %lu 次（平均上溯 %.1f 级、%.0f ns）  失效结果 %lu 个\n", (unsigned long) metrics.invalidations,
+           (double) metrics.invalidationSteps / checks, metrics.invalidationSeconds * 1e9 / checks,
+           (unsigned long) metrics.invalidatedEntries);
+    return 0;
+}
 
-                if (vertexList.empty()) {
-                    return;
-                }
+// 基准用的用户统计数据：64 字节，最近邀请列表在堆上，复制需要分配内存；复制次数计入 copies
+struct UserStats {
+    static inline uint64_t copies = 0;
 
-                VertexNode vertexNode = vertexList[0];
+    int64_t invites = 0;            // 邀请人数
+    int64_t downline = 0;           // 下级总数
+    int64_t activeDays = 0;         // 活跃天数
+    int64_t lastActive = 0;         // 最后活跃时间
+    int64_t score = 0;              // 积分
+    std::vector<Uid> recent;        // 最近邀请的用户
 
-                pEdges = vertexNode.pEdgeTable;
+    UserStats() = default;
 
-                if (pEdges == nullptr) {
-                    continue;
-                }
-            }
+    explicit UserStats(int64_t id) : invites(id & 7), downline(id), activeDays(id % 365), lastActive(id), score(id * 3),
+                                     recent(4, (Uid) id) {}
 
-            // 遍历邻接顶点
-            auto edgeList = pEdges->select(0, BE);
+    UserStats(const UserStats &other) : invites(other.invites), downline(other.downline), activeDays(other.activeDays),
+                                        lastActive(other.lastActive), score(other.score), recent(other.recent) {
+        copies++;
+    }
 
-            if (edgeList.empty()) {
-                return;
-            }
+    UserStats(UserStats &&) noexcept = default;
 
-            for (auto edge : edgeList) {
-                // 未访问过的邻接顶点
-                adjVex = edge.adjVex;
-                auto visited = this->vexs_visited.select(adjVex, EQ);
+    UserStats &operator=(const UserStats &other) {
+        UserStats copy(other);
+        return *this = std::move(copy);
+    }
 
-                if (visited.empty()) {
-                    continue;
-                }
+    UserStats &operator=(UserStats &&) noexcept = default;
+};
 
-                if (visited[0] != true) {
-                    // 访问顶点，并标记访问、入队
-                    auto vertexSetTemp = this->vexs.select(adjVex, EQ);
+// bench payload [规模...]：64 字节非平凡数据的 B+ 树，按复制、移动、原地构造三种方式插入，以及删除、跨叶子修改键值、范围读取时的复制次数与耗时
+int32_t RunPayloadBench(int32_t argc, char *argv[]) {
+    static_assert(sizeof(UserStats) == 64, "基准数据应为 64 字节");
+    std::vector<int32_t> sizes;
+    for (int32_t i = 3; i < argc; i++) {
+        sizes.push_back(std::atoi(argv[i]));
+    }
+    if (sizes.empty()) {
+        sizes = { 100000, 1000000 };
+    }
 
-                    if (vertexSetTemp.empty()) {
-                        return;
-                    }
+    for (int32_t n : sizes) {
+        printf("[random n=%d]\n", n);
+        std::mt19937_64 rng(42);
+        std::vector<int64_t> keys(n);
+        for (int32_t i = 0; i < n; i++) {
+            keys[i] = i * 2;
+        }
+        std::shuffle(keys.begin(), keys.end(), rng);
+        uint64_t sink = 0;
+        auto measure = [&](const char *name, uint64_t ops, auto &&op) {
+            UserStats::copies = 0;
+            auto begin = std::chrono::steady_clock::now();
+            op();
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+            printf("  %-16s %9lu ops  %9.1f ns/op  %6.2f 次复制/op\n", name, (unsigned long) ops, seconds * 1e9 / (double) ops,
+                   (double) UserStats::copies / (double) ops);
+        };
+
+        BPlusTree<int64_t, UserStats> copied, moved, emplaced;
+        measure("insert(copy)", n, [&]() {
+            for (int64_t key : keys) {
+                UserStats stats(key);
+                copied.insert(key, stats);
+            }
+        });
+        measure("insert(move)", n, [&]() {
+            for (int64_t key : keys) {
+                UserStats stats(key);
+                moved.insert(key, std::move(stats));
+            }
+        });
+        measure("emplace", n, [&]() {
+            for (int64_t key : keys) {
+                emplaced.emplace(key, key);
+            }
+        });
+        copied.clear();
+        moved.clear();
+
+        // 跨叶子修改键值：旧键值删除后以新键值重新插入，数据随之移动
+        measure("update", n / 10, [&]() {
+            for (int32_t i = 0; i < n / 10; i++) {
+                sink += emplaced.update(keys[i], keys[i] + 1);
+            }
+        });
+        measure("select(range100)", n / 10, [&]() {
+            std::vector<UserStats> results;
+            for (int32_t i = 0; i < n / 10; i++) {
+                results.clear();
+                emplaced.select(keys[i], keys[i] + 199, results);
+                sink += results.size();
+            }
+        });
+        measure("forEach(range100)", n / 10, [&]() {
+            for (int32_t i = 0; i < n / 10; i++) {
+                emplaced.forEach(keys[i], keys[i] + 199, [&](int64_t, const UserStats &stats) {
+                    sink += stats.recent.size();
+                });
+            }
+        });
+        measure("erase", n, [&]() {
+            UserStats removed;
+            for (int64_t key : keys) {
+                sink += emplaced.erase(key, &removed) || emplaced.erase(key + 1, &removed);
+            }
+        });
+        printf("  (checksum %lu)\n", (unsigned long) sink);
+    }
+    return 0;
+}
 
-                    VertexNode vertexNode = vertexSetTemp[0];
+// 队列吞吐量：链队列（每次入队分配结点与元素）对比循环队列（元素按值存储）
+int32_t RunQueueBench(int32_t argc, char *argv[]) {
+    int32_t n = argc > 3 ? std::atoi(argv[3]) : 10000000;
+    int64_t checksum = 0;
 
-                    std::cout << vertexNode.id << " " << std::flush;
+    auto measure = [&](const char *name, auto &&body) {
+        auto start = std::chrono::steady_clock::now();
+        body();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << name << "：" << seconds * 1000 << " ms，" << 2.0 * n / seconds / 1e6 << " M ops/s" << std::endl;
+    };
 
-                    this->vexs_visited.remove(adjVex);
-                    this->vexs_visited.insert(adjVex, 1);
+    std::cout << "队列吞吐量（" << n << " 次入队 + " << n << " 次出队）" << std::endl;
 
-                    vexQ->EnQueue(new int32_t(adjVex));
-                }
-            }
+    // 1.先全部入队再全部出队
+    measure("LinkQueue  先入后出", [&]() {
+        LinkQueue<int32_t> q;
+        for (int32_t i = 0; i < n; i++) {
+            q.EnQueue(new int32_t(i));
         }
-
-        // 4.释放队列
-        int32_t * e;
-        while (vexQ->GetHead() != nullptr)
-        {
-            e = vexQ->DeQueue();
+        int32_t *e;
+        while ((e = q.DeQueue()) != nullptr) {
+            checksum += *e;
             delete e;
         }
-        delete vexQ;
-    }
-};
+    });
+    measure("ArrayQueue 先入后出", [&]() {
+        ArrayQueue<int32_t> q;
+        for (int32_t i = 0; i < n; i++) {
+            q.EnQueue(i);
+        }
+        int32_t e;
+        while (q.DeQueue(e)) {
+            checksum += e;
+        }
+    });
+
+    // 2.稳态出入：队列保持 64 个元素，每出队一个元素入队一个新元素
+    measure("LinkQueue  稳态出入", [&]() {
+        LinkQueue<int32_t> q;
+        int32_t pushed = 0;
+        for (; pushed < 64 && pushed < n; pushed++) {
+            q.EnQueue(new int32_t(pushed));
+        }
+        int32_t *e;
+        while ((e = q.DeQueue()) != nullptr) {
+            checksum += *e;
+            delete e;
+            if (pushed < n) {
+                q.EnQueue(new int32_t(pushed++));
+            }
+        }
+    });
+    measure("ArrayQueue 稳态出入", [&]() {
+        ArrayQueue<int32_t> q;
+        int32_t pushed = 0;
+        for (; pushed < 64 && pushed < n; pushed++) {
+            q.EnQueue(pushed);
+        }
+        int32_t e;
+        while (q.DeQueue(e)) {
+            checksum += e;
+            if (pushed < n) {
+                q.EnQueue(pushed++);
+            }
+        }
+    });
+
+    std::cout << "校验和：" << checksum << std::endl;
+    return 0;
+}
 
-int32_t main() {
+int32_t main(int32_t argc, char *argv[]) {
+    if (argc > 1 && std::string(argv[1]) == "import") {
+        return RunImport(argc, argv);
+    }
+    if (argc > 2 && std::string(argv[1]) == "bench" && std::string(argv[2]) == "queue") {
+        return RunQueueBench(argc, argv);
+    }
+    if (argc > 2 && std::string(argv[1]) == "bench" && std::string(argv[2]) == "graph") {
+        return RunGraphBench(argc, argv);
+    }
+    if (argc > 2 && std::string(argv[1]) == "bench" && std::string(argv[2]) == "memory") {
+        return RunMemoryBench(argc, argv);
+    }
+    if (argc > 2 && std::string(argv[1]) == "bench" && std::string(argv[2]) == "snapshot") {
+        return RunSnapshotBench(argc, argv);
+    }
+    if (argc > 2 && std::string(argv[1]) == "bench" && std::string(argv[2]) == "instrument") {
+        return RunInstrumentBench(argc, argv);
+    }
+    if (argc > 2 && std::string(argv[1]) == "bench" && std::string(argv[2]) == "export") {
+        return RunExportBench(argc, argv);
+    }
+    if (argc > 2 && std::string(argv[1]) == "bench" && std::string(argv[2]) == "paged") {
+        return RunPagedBench(argc, argv);
+    }
+    if (argc > 2 && std::string(argv[1]) == "bench" && std::string(argv[2]) == "cache") {
+        return RunCacheBench(argc, argv);
+    }
+    if (argc > 2 && std::string(argv[1]) == "bench" && std::string(argv[2]) == "static") {
+        return RunStaticBench(argc, argv);
+    }
+    if (argc > 2 && std::string(argv[1]) == "bench" && std::string(argv[2]) == "payload") {
+        return RunPayloadBench(argc, argv);
+    }
+    if (argc > 2 && std::string(argv[1]) == "bench" && std::string(argv[2]) == "shard") {
+        return RunShardBench(argc, argv);
+    }
+    if (argc > 2 && std::string(argv[1]) == "bench" && std::string(argv[2]) == "distributed") {
+        return RunDistributedBench(argc, argv);
+    }
+    if (argc > 2 && std::string(argv[1]) == "bench" && std::string(argv[2]) == "async") {
+        return RunAsyncBench(argc, argv);
+    }
+    if (argc > 2 && std::string(argv[1]) == "bench" && std::string(argv[2]) == "querycache") {
+        return RunQueryCacheBench(argc, argv);
+    }
 
     // 测试1：无向图
     std::cout << std::endl << "图初始化：" << std::endl;
@@ -1634,7 +8961,7 @@ int32_t main() {
     int32_t * id1 = new int32_t (4);
 
     // 1.1.深度优先遍历
-    std::cout << std::endl << "图深度优先遍历序列：（递归）" << std::endl;
+    std::cout << std::endl << "图深度优先遍历序列：" << std::endl;
     dg->Display_DFS_R(*id0);
 
     // 1.2.广度优先遍历